@@ -0,0 +1,173 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Adaptive Sampling.  The Sampler runs Fast while the load is stepping, Normal while it is noisy, and backs off to Idle
+// once it has been steady for a while, so SPI and CPU load drop when nothing is happening.  Activity is judged on the raw
+// capture, before the Filters, so a step seen at the Idle rate switches to Fast on the very next sample.
+// Energy is accumulated by the ATM90E26 itself, so a slower rate never loses Import or Export Energy.
+boolean EnableAdaptiveRate = true; // Set to true to vary the Sampler rate with load activity
+
+enum SampleTier
+{
+  TIER_Idle,
+  TIER_Normal,
+  TIER_Fast,
+  TIER_Count
+};
+
+const char *SampleTierName[TIER_Count] = {"Idle", "Normal", "Fast"};
+int SampleTierRate[TIER_Count] = {1, 10, 50}; // Hz.  Normal is set from SnapshotRate when initialised
+
+float AdaptiveStepPower = 25;             // W.  A change this large between samples is a step
+float AdaptiveStepCurrent = 0.1;          // A.  As above, for loads with a poor Power Factor
+float AdaptiveNoisePower = 5;             // W.  Power Standard Deviation above this keeps the Normal rate
+const float AdaptiveNoiseAlpha = 0.2;     // Weight of each sample in the Power Mean and Variance
+const uint32_t AdaptiveFastHold = 5000;   // ms at the Fast rate after the last step
+const uint32_t AdaptiveIdleAfter = 30000; // ms steady before dropping to the Idle rate
+
+// Activity State
+struct AdaptiveState
+{
+  boolean Primed;      // Previous values held
+  float Power;         // Previous Active Power
+  float Current;       // Previous Line Current
+  float Mean;          // Active Power Mean (EWMA)
+  float Variance;      // Active Power Variance (EWMA)
+  uint32_t LastSample; // millis() of previous sample
+  uint32_t LastStep;   // millis() of last step
+  uint32_t LastActive; // millis() of last step or noisy sample
+  SampleTier Tier;     // Current tier
+};
+
+AdaptiveState Adaptive = {};
+portMUX_TYPE AdaptiveMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Statistics
+uint64_t SampleTierTime[TIER_Count] = {}; // ms spent in each tier
+uint32_t SampleTierChanges = 0;           // Tier changes
+uint32_t SampleSteps = 0;                 // Steps detected
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Choose the Sampler interval from a raw capture.  Snapshot Pacer, runs in the Sampler Task.  Returns interval in ms.
+uint32_t AdaptiveSnapshotInterval(const GTEM_Snapshot &snap)
+{
+  uint32_t Now = snap.Timestamp;
+
+  portENTER_CRITICAL(&AdaptiveMux);
+  AdaptiveState &s = Adaptive;
+
+  if (!s.Primed)
+  {
+    s.Mean = snap.ActivePower;
+    s.LastSample = s.LastActive = Now;
+    s.LastStep = Now - AdaptiveFastHold;
+    s.Primed = true;
+  }
+  else
+  {
+    // Time since the previous sample was spent in the current tier
+    SampleTierTime[s.Tier] += Now - s.LastSample;
+    s.LastSample = Now;
+
+    if (fabsf(snap.ActivePower - s.Power) > AdaptiveStepPower || fabsf(snap.LineCurrent - s.Current) > AdaptiveStepCurrent)
+    {
+      s.LastStep = s.LastActive = Now;
+      SampleSteps++;
+    }
+
+    // Exponentially weighted Mean and Variance of Active Power
+    float Delta = snap.ActivePower - s.Mean;
+    s.Mean += AdaptiveNoiseAlpha * Delta;
+    s.Variance = (1 - AdaptiveNoiseAlpha) * (s.Variance + AdaptiveNoiseAlpha * Delta * Delta);
+    if (s.Variance > AdaptiveNoisePower * AdaptiveNoisePower)
+      s.LastActive = Now;
+  }
+  s.Power = snap.ActivePower;
+  s.Current = snap.LineCurrent;
+
+  SampleTier Tier = TIER_Idle;
+  if (Now - s.LastStep < AdaptiveFastHold)
+    Tier = TIER_Fast;
+  else if (Now - s.LastActive < AdaptiveIdleAfter)
+    Tier = TIER_Normal;
+
+  if (Tier != s.Tier)
+  {
+    s.Tier = Tier;
+    SampleTierChanges++;
+  }
+  portEXIT_CRITICAL(&AdaptiveMux);
+
+  return 1000 / SampleTierRate[Tier];
+}
+
+// Current Sampler Rate in Hz
+int GetSampleRate()
+{
+  portENTER_CRITICAL(&AdaptiveMux);
+  SampleTier Tier = Adaptive.Tier;
+  portEXIT_CRITICAL(&AdaptiveMux);
+  return SampleTierRate[Tier];
+}
+
+// Initialise Adaptive Sampling.  Start before the Sampler Task, after SnapshotRate is set.
+void InitialiseAdaptiveRate()
+{
+  SampleTierRate[TIER_Normal] = constrain(SnapshotRate, 1, 20);
+  Adaptive.Tier = TIER_Normal;
+  SnapshotPacer = AdaptiveSnapshotInterval;
+}
+
+// Adaptive Sampling as JSON.  {"hz":10,"tier":"Normal","steps":3,"changes":7,"ms":{"Idle":120000,"Normal":35000,"Fast":5000}}
+int FormatAdaptiveRateJSON(char *Out, size_t Size)
+{
+  uint64_t Time[TIER_Count];
+
+  portENTER_CRITICAL(&AdaptiveMux);
+  SampleTier Tier = Adaptive.Tier;
+  uint32_t Steps = SampleSteps;
+  uint32_t Changes = SampleTierChanges;
+  memcpy(Time, SampleTierTime, sizeof(Time));
+  portEXIT_CRITICAL(&AdaptiveMux);
+
+  int Length = snprintf(Out, Size, "{\"hz\":%d,\"tier\":\"%s\",\"steps\":%u,\"changes\":%u,\"ms\":{\"%s\":%llu,\"%s\":%llu,\"%s\":%llu}}",
+                        SampleTierRate[Tier], SampleTierName[Tier], (unsigned)Steps, (unsigned)Changes,
+                        SampleTierName[TIER_Idle], (unsigned long long)Time[TIER_Idle],
+                        SampleTierName[TIER_Normal], (unsigned long long)Time[TIER_Normal],
+                        SampleTierName[TIER_Fast], (unsigned long long)Time[TIER_Fast]);
+
+  return Length < (int)Size ? Length : 0;
+}
+
+// Display Adaptive Sampling Statistics
+void DisplayAdaptiveRateStatistics(Print &Out = Serial)
+{
+  uint64_t Time[TIER_Count];
+  uint64_t Total = 0;
+
+  portENTER_CRITICAL(&AdaptiveMux);
+  SampleTier Tier = Adaptive.Tier;
+  memcpy(Time, SampleTierTime, sizeof(Time));
+  portEXIT_CRITICAL(&AdaptiveMux);
+
+  for (int t = 0; t < TIER_Count; t++)
+    Total += Time[t];
+
+  Out.printf("Sample Rate \t\t\t%d Hz (%s) | Steps %u | Changes %u\n", SampleTierRate[Tier], SampleTierName[Tier], (unsigned)SampleSteps, (unsigned)SampleTierChanges);
+  for (int t = 0; t < TIER_Count; t++)
+    Out.printf("Sample Tier %-6s \t\t%d Hz\t%.1f s\t%.1f %%\n", SampleTierName[t], SampleTierRate[t], Time[t] / 1000.0, Total ? Time[t] * 100.0 / Total : 0.0);
+}
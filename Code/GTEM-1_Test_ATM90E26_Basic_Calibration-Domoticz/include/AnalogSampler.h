@@ -0,0 +1,183 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Analog Sampler.  The ESP32 ADC1 runs continuously, DMA filling a buffer with DCV_IN and NTC_IN samples in turn.  A background
+// task averages each channel over AnalogPeriod, converts the mean to mV with the eFuse calibration (esp_adc_cal), and smooths
+// it with an EMA.  ReadADCVoltage() and ReadTemperature() then just take the latest value, with no analogRead() on the main path.
+boolean EnableAnalogSampler = true; // Set to true to oversample DCV_IN and NTC_IN in the background.  false uses analogRead()
+
+enum AnalogInput
+{
+  ANALOG_DCV, // DCV_IN GPIO 36 (ADC 1 CH0)
+  ANALOG_NTC, // NTC_IN GPIO 39 (ADC 1 CH3)
+  ANALOG_Count
+};
+
+const adc1_channel_t AnalogChannel[ANALOG_Count] = {ADC1_CHANNEL_0, ADC1_CHANNEL_3};
+const char *AnalogName[ANALOG_Count] = {"DCV_IN", "NTC_IN"};
+
+const uint32_t AnalogSampleRate = 20000; // Hz, both channels together.  20 kHz is the ESP32 minimum in continuous mode
+const uint32_t AnalogPeriod = 100;       // ms averaged into each value, so values update at 10 Hz
+const float AnalogAlpha = 0.25;          // EMA weight of each new value
+const uint32_t AnalogFrameBytes = 256;   // DMA frame.  2 bytes per sample
+
+// Channel State
+struct AnalogState
+{
+  uint32_t Sum;     // Raw sample sum, this Period
+  uint32_t Count;   // Samples, this Period
+  boolean Primed;   // Millivolts holds a value
+  float Millivolts; // Calibrated and smoothed
+  uint32_t Samples; // Total samples
+};
+
+AnalogState Analog[ANALOG_Count] = {};
+portMUX_TYPE AnalogMux = portMUX_INITIALIZER_UNLOCKED;
+esp_adc_cal_characteristics_t AnalogCalibration;
+esp_adc_cal_value_t AnalogCalibrationType;
+TaskHandle_t AnalogTaskHandle = NULL;
+
+// Statistics
+uint32_t AnalogValues = 0;   // Values produced (per channel)
+uint32_t AnalogOverruns = 0; // DMA buffer filled before it was read.  Samples lost, values still good
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Latest calibrated and smoothed value of an input, mV.  0 until the first Period is complete.
+float GetAnalogMillivolts(int Input)
+{
+  portENTER_CRITICAL(&AnalogMux);
+  float mV = Analog[Input].Millivolts;
+  portEXIT_CRITICAL(&AnalogMux);
+  return mV;
+}
+
+// Close a Period.  Mean of each channel, calibrated, into its EMA.
+void AnalogDecimate()
+{
+  for (int i = 0; i < ANALOG_Count; i++)
+  {
+    if (Analog[i].Count == 0)
+      continue;
+    uint32_t Raw = (Analog[i].Sum + Analog[i].Count / 2) / Analog[i].Count;
+    float mV = esp_adc_cal_raw_to_voltage(Raw, &AnalogCalibration);
+
+    portENTER_CRITICAL(&AnalogMux);
+    Analog[i].Millivolts = Analog[i].Primed ? Analog[i].Millivolts + AnalogAlpha * (mV - Analog[i].Millivolts) : mV;
+    Analog[i].Primed = true;
+    portEXIT_CRITICAL(&AnalogMux);
+
+    Analog[i].Sum = 0;
+    Analog[i].Count = 0;
+  }
+  AnalogValues++;
+}
+
+// Analog Task.  Drains the DMA frames as they complete, and decimates every AnalogPeriod.
+void AnalogTask(void *parameter)
+{
+  uint8_t Frame[AnalogFrameBytes];
+  uint32_t PeriodStart = millis();
+
+  for (;;)
+  {
+    uint32_t Length = 0;
+    esp_err_t Result = adc_digi_read_bytes(Frame, sizeof(Frame), &Length, AnalogPeriod);
+    if (Result == ESP_ERR_INVALID_STATE)
+      AnalogOverruns++;
+
+    for (uint32_t b = 0; b + sizeof(adc_digi_output_data_t) <= Length; b += sizeof(adc_digi_output_data_t))
+    {
+      adc_digi_output_data_t *Sample = (adc_digi_output_data_t *)&Frame[b];
+      for (int i = 0; i < ANALOG_Count; i++)
+      {
+        if (Sample->type1.channel == AnalogChannel[i])
+        {
+          Analog[i].Sum += Sample->type1.data;
+          Analog[i].Count++;
+          Analog[i].Samples++;
+        }
+      }
+    }
+
+    if (millis() - PeriodStart >= AnalogPeriod)
+    {
+      PeriodStart += AnalogPeriod;
+      AnalogDecimate();
+    }
+  }
+}
+
+// Start Analog Sampler (Once).  ADC1 continuous mode, 12 bit, 11 dB (to about 3.1 V) on both channels.
+void InitialiseAnalogSampler()
+{
+  if (AnalogTaskHandle != NULL)
+    return;
+
+  AnalogCalibrationType = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &AnalogCalibration);
+
+  adc_digi_init_config_t Init = {};
+  Init.max_store_buf_size = 4 * AnalogFrameBytes;
+  Init.conv_num_each_intr = AnalogFrameBytes;
+  for (int i = 0; i < ANALOG_Count; i++)
+    Init.adc1_chan_mask |= 1 << AnalogChannel[i];
+
+  adc_digi_pattern_config_t Pattern[ANALOG_Count] = {};
+  for (int i = 0; i < ANALOG_Count; i++)
+  {
+    Pattern[i].atten = ADC_ATTEN_DB_11;
+    Pattern[i].channel = AnalogChannel[i];
+    Pattern[i].unit = 0; // ADC 1
+    Pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_digi_configuration_t Digi = {};
+  Digi.conv_limit_en = true; // Required on the ESP32
+  Digi.conv_limit_num = 250;
+  Digi.pattern_num = ANALOG_Count;
+  Digi.adc_pattern = Pattern;
+  Digi.sample_freq_hz = AnalogSampleRate;
+  Digi.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  Digi.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+  if (adc_digi_initialize(&Init) != ESP_OK || adc_digi_controller_configure(&Digi) != ESP_OK || adc_digi_start() != ESP_OK)
+  {
+    LogWarn("Analog Sampler failed to start.  Using analogRead()");
+    adc_digi_deinitialize();
+    EnableAnalogSampler = false;
+    return;
+  }
+
+  xTaskCreatePinnedToCore(AnalogTask, "Analog", 3072, NULL, 1, &AnalogTaskHandle, 0);
+}
+
+// Display Analog Sampler Statistics
+void DisplayAnalogStatistics(Print &Out = Serial)
+{
+  const char *Calibration = AnalogCalibrationType == ESP_ADC_CAL_VAL_EFUSE_TP     ? "eFuse Two Point"
+                            : AnalogCalibrationType == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref"
+                                                                                  : "Default Vref";
+
+  Out.printf("Analog Sampler \t\t\t%u Hz | %u ms Period | %s | Values %u | Overruns %u\n", (unsigned)AnalogSampleRate, (unsigned)AnalogPeriod,
+                Calibration, (unsigned)AnalogValues, (unsigned)AnalogOverruns);
+  for (int i = 0; i < ANALOG_Count; i++)
+    Out.printf("Analog %-8s \t\t%.1f mV | Samples %u\n", AnalogName[i], GetAnalogMillivolts(i), (unsigned)Analog[i].Samples);
+}
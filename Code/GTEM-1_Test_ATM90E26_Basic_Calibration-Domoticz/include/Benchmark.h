@@ -0,0 +1,204 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// On Device Benchmark.  Times the register, filter, statistics, formatting and EEPROM paths, and prints one line of JSON
+// so results can be saved and compared between builds.  i.e.
+// {"benchmark":"GTEM","version":"GTEM Test 230510","cpu_mhz":240,"results":[{"name":"filter_median5","iterations":60000,"us":10980,"ns_per_op":183.0,"per_s":5464480},...]}
+// The Sampler is paused while it runs, so SPI timings are not disturbed and the Energy totals are not read twice at once.
+// Outputs are encoded into local buffers, so Modbus Masters and the Live Stream never see benchmark values.
+boolean EnableBenchmark = false; // Set to true to run the Benchmark once at boot
+
+volatile float BenchmarkSink; // Results are stored here, so the compiler cannot remove the work
+
+// Each case repeats its batch until at least BenchmarkMinTime has passed, so even the fastest is timed over thousands of
+// timer ticks.  ns_per_op and per_s are from the total time and total operations.
+const int64_t BenchmarkMinTime = 10000; // us
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Print one Result
+void BenchmarkResult(const char *Name, int64_t Iterations, int64_t Time, boolean &First)
+{
+  double NsPerOp = Iterations > 0 ? Time * 1000.0 / Iterations : 0;
+  Serial.printf("%s{\"name\":\"%s\",\"iterations\":%lld,\"us\":%lld,\"ns_per_op\":%.1f,\"per_s\":%lld}", First ? "" : ",", Name,
+                (long long)Iterations, (long long)Time, NsPerOp, (long long)(Time > 0 ? Iterations * 1000000LL / Time : 0));
+  First = false;
+}
+
+// Time one case.  Work(i) is one operation, i counting up from 0 across batches.  Batch operations run between clock reads.
+template <class Operation>
+void BenchmarkRun(const char *Name, int Batch, Operation Work, boolean &First)
+{
+  int64_t Iterations = 0;
+  int64_t Start = esp_timer_get_time();
+  int64_t Time;
+  do
+  {
+    for (int i = 0; i < Batch; i++)
+      Work(Iterations + i);
+    Iterations += Batch;
+    Time = esp_timer_get_time() - Start;
+  } while (Time < BenchmarkMinTime);
+  BenchmarkResult(Name, Iterations, Time, First);
+}
+
+// Firmware paths, without the board.  The Energy IC may be the ATM90E26 or a simulated one (the Replay Transport), so the
+// same paths are timed on the host by the native build (native/main.cpp).  Nothing live is written.
+template <class EnergyIC>
+void BenchmarkPaths(EnergyIC &ic, boolean &First)
+{
+  GTEM_Snapshot Snap;
+  GTEM_Snapshot Last = {};
+  static char Buffer[1600];
+  static uint16_t Registers[MB_RegisterCount];
+
+  // ATM90E26 Registers, read and scaled
+  BenchmarkRun("register_read_scaled", 200, [&](int64_t i) { BenchmarkSink = ic.GetLineVoltage(); }, First);
+  BenchmarkRun("energy_accumulation", 100, [&](int64_t i) { BenchmarkSink = ic.GetImportEnergy() + ic.GetExportEnergy(); }, First);
+  BenchmarkRun("snapshot_capture", 50, [&](int64_t i) { CaptureSnapshot(ic, Snap); }, First);
+
+  // Filters, on local state
+  FilterConfig Median = {5, 1.0, 0.0, 0.0};
+  FilterConfig Chain = {FILTER_MEDIAN_MAX, 0.2, 5.0, 2.0};
+  FilterState State = {};
+
+  BenchmarkRun("filter_median5", 10000, [&](int64_t i) { BenchmarkSink = FilterApply(Median, State, Snap.ActivePower + (i & 7)); }, First);
+  memset(&State, 0, sizeof(State));
+  BenchmarkRun("filter_chain9", 10000, [&](int64_t i) { BenchmarkSink = FilterApply(Chain, State, Snap.ActivePower + (i & 7)); }, First);
+
+  // Statistics, on a local window
+  StatsWindow Window = {};
+  BenchmarkRun(
+      "statistics_add", 10000, [&](int64_t i) { StatsWindowAdd(Window, StatsWindowTime[STATS_1min] / StatsBuckets, i, Snap.LineVoltage + (i & 7)); },
+      First);
+  BenchmarkSink = Window.Buckets[Window.Current].Mean;
+
+  // Statistics per Metric, each sample into every Window as the Sampler adds them.  per_s is samples per second.
+  const float Typical[STATS_Metrics] = {240.0, 5.0, 1200.0, 50.0, 0.95};
+  static StatsWindow Windows[STATS_Windows];
+  for (int m = 0; m < STATS_Metrics; m++)
+  {
+    char Name[32];
+    snprintf(Name, sizeof(Name), "statistics_%s", StatsMetricKey[m]);
+    memset(Windows, 0, sizeof(Windows));
+    BenchmarkRun(
+        Name, 5000,
+        [&](int64_t i)
+        {
+          for (int w = 0; w < STATS_Windows; w++)
+            StatsWindowAdd(Windows[w], StatsWindowTime[w] / StatsBuckets, i * 100, Typical[m] * (1 + (i & 7) * 0.001f));
+        },
+        First);
+    BenchmarkSink = Windows[STATS_15min].Buckets[Windows[STATS_15min].Current].Mean;
+  }
+
+  // PCB NTC Temperature.  Table lookup, and the Steinhart-Hart equation it replaced
+  BenchmarkRun("ntc_table", 10000, [&](int64_t i) { BenchmarkSink = NTCTemperature(1000 + (i & 2047)); }, First);
+  BenchmarkRun("ntc_steinhart_hart", 10000, [&](int64_t i) { BenchmarkSink = NTCSteinhartHart(log(NTCResistance(1000 + (i & 2047)))); }, First);
+
+  // Output Formatting
+  BenchmarkRun(
+      "live_frame_encode", 2000,
+      [&](int64_t i)
+      {
+        Last.LineVoltage = i; // A changed value, so every frame is a delta
+        BenchmarkSink = EncodeLiveFrame(Buffer, sizeof(Buffer), Snap, Last, (i & 15) == 0);
+      },
+      First);
+
+  // Modbus Register Map, into a local copy.  The map Masters read is left alone.
+  BenchmarkRun(
+      "modbus_encode", 2000,
+      [&](int64_t i)
+      {
+        Snap.Sequence = i;
+        ModbusEncodeRegisters(Snap, Registers);
+      },
+      First);
+  BenchmarkSink = Registers[MB_Sequence + 1];
+
+  BenchmarkRun("statistics_json", 100, [&](int64_t i) { BenchmarkSink = FormatStatisticsJSON(Buffer, sizeof(Buffer)); }, First);
+
+  // InfluxDB batch and gzip use the writer's buffers, so only while it is not running
+  if (EnableInfluxDB == false)
+  {
+    for (int i = 0; i < InfluxBatchPoints; i++)
+    {
+      InfluxBatch[i].Timestamp = Snap.Timestamp + i * 100;
+      InfluxBatch[i].LineVoltage = Snap.LineVoltage;
+      InfluxBatch[i].LineCurrent = Snap.LineCurrent;
+      InfluxBatch[i].ActivePower = Snap.ActivePower + i;
+      InfluxBatch[i].LineFrequency = Snap.LineFrequency;
+      InfluxBatch[i].PowerFactor = Snap.PowerFactor;
+      InfluxBatch[i].Range = Snap.Range;
+      InfluxBatch[i].Flags = Snap.Flags;
+    }
+
+    int Length = 0;
+    uint32_t SavedLatency = InfluxLatencyLast;
+    BenchmarkRun(
+        "influx_format_batch", 20,
+        [&](int64_t i)
+        {
+          InfluxLatencyLast = millis(); // Points only
+          Length = InfluxFormatBatch(InfluxBatchPoints, 1700000000000LL, Snap.Timestamp + InfluxBatchPoints * 100);
+        },
+        First);
+    InfluxLatencyLast = SavedLatency;
+
+    BenchmarkRun(
+        "influx_gzip_batch", 20,
+        [&](int64_t i) { BenchmarkSink = GzipCompress((const uint8_t *)InfluxBody, Length, InfluxGzipBody, sizeof(InfluxGzipBody)); }, First);
+  }
+
+  // Config Journal Records, in RAM.  One Filter setting, as the filter command saves it.
+  uint8_t Record[7 + CONFIG_RECORD_MAX];
+  uint16_t Offset = (const uint8_t *)&Config.Filters[0] - (const uint8_t *)&Config;
+  uint16_t DecodedOffset;
+  uint8_t DecodedLength;
+  unsigned int RecordLength = 0;
+
+  BenchmarkRun(
+      "config_record_encode", 2000, [&](int64_t i) { RecordLength = ConfigEncodeRecord(Record, Offset, &Config.Filters[0], sizeof(FilterConfig)); },
+      First);
+  BenchmarkRun(
+      "config_record_decode", 2000, [&](int64_t i) { BenchmarkSink = ConfigDecodeRecord(Record, RecordLength, DecodedOffset, DecodedLength); },
+      First);
+  BenchmarkRun(
+      "config_crc32", 200, [&](int64_t i) { BenchmarkSink = crc32_le(ConfigSeed(), (const uint8_t *)&Config, sizeof(GTEM_Config)); }, First);
+}
+
+// Run all Benchmarks
+void RunBenchmarks(ATM90E26_SPI &ic, const char *Version)
+{
+  boolean First = true;
+
+  PauseSampler();
+
+  Serial.printf("{\"benchmark\":\"GTEM\",\"version\":\"%s\",\"cpu_mhz\":%u,\"results\":[", Version, (unsigned)ESP.getCpuFreqMHz());
+
+  // ATM90E26 Registers, over SPI
+  BenchmarkRun("spi_register_read", 20, [&](int64_t i) { BenchmarkSink = ic.GetSysStatus(); }, First);
+
+  BenchmarkPaths(ic, First);
+
+  // EEPROM, read only to spare write cycles
+  BenchmarkRun("eeprom_read16", 20, [&](int64_t i) { BenchmarkSink = readEEPROM16(0x1C); }, First);
+
+  Serial.println("]}");
+
+  ResumeSampler();
+}
@@ -0,0 +1,527 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <Arduino.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// On Device Calibration.  With a reference Voltage and Current on the input (i.e. a calibrated meter and a resistive load),
+// 'calibrate <volts> [amps]' measures, corrects the gains and measures again until the readings agree with the reference:
+//   Ugain  - Urms scales with Ugain, so Ugain x Reference / Measured
+//   IgainL - Irms scales with IgainL, as Ugain
+//   Lgain  - Active Power scales with 1 + Lgain / 32768 (signed), corrected to Reference V x A x Power Factor
+// Each step is written live in calibration mode, with the checksum the ATM90E26 calculates (see ApplyMeasurementCalibration()),
+// so there is no reflash or reboot.  Once within CalibrationTolerance, the gains are saved in the Config and the checksums in
+// the EEPROM, as they would be after a CRC Error, so the next boot uses them.  Without amps, only Ugain is calibrated.
+// A run takes several seconds, so is stepped by its One Shot Job, one reading a step, with progress logged.  The Console and
+// the other Jobs carry on meanwhile.  The Sampler is paused until it ends.
+const int CalibrationSamples = 10;         // Readings averaged per measurement
+const uint32_t CalibrationSampleTime = 100; // ms between readings
+const uint32_t CalibrationSettle = 1000;    // ms after new gains, before measuring
+const int CalibrationIterations = 6;       // Measure and correct, at most
+const float CalibrationTolerance = 0.002;  // Relative error accepted (0.2%)
+const float CalibrationMinCurrent = 0.1;   // A.  Less and the load is taken to be missing
+
+// Offset Calibration.  With the AC input on and no current ('calibrate offset'), per Application Note 46102:
+//   IoffsetL - Irms read, x IgainL / 2^16 x 2^8, complemented
+//   PoffsetL - Pmean read in Small-Power Mode, complemented.  QoffsetL the same, from Qmean.
+// The Offsets are zeroed first, so each reading is the whole offset, and averaged over CalibrationOffsetSamples.
+// Uoffset is not calibrated, as the GTEM-1 is powered from the same AC input (can be set with 'set uoffset').
+const int CalibrationOffsetSamples = 50;        // Readings averaged per Offset (5 seconds)
+const float CalibrationOffsetMaxCurrent = 0.05; // A.  More and a load is taken to be on
+
+// Phase Calibration.  With a resistive load (PF 1.0) on ('calibrate phase'), any angle between Voltage and Current is the
+// CT Clamp phase shift.  Measured from Qmean / Pmean, so finer than Pangle (0.1 degree).  Lphi is signed (MSB), per
+// Application Note 46102 Lphi = error x 3763.74 at PF 0.5L, which is -113.78 per degree.
+const float CalibrationLPhiPerDegree = -113.78; // Lphi per degree of lag measured
+const float CalibrationPhaseTolerance = 0.05;   // Degrees accepted
+
+// Averaged Measurement
+struct CalibrationReading
+{
+  float LineVoltage;
+  float LineCurrent;
+  float ActivePower;
+  float ReactivePower;
+  float PowerFactor;
+};
+
+// Calibration Run in progress
+enum CalibrationKind
+{
+  CAL_Idle,
+  CAL_Gains,
+  CAL_Offset,
+  CAL_Phase
+};
+
+// Offset Calibration steps, each a measurement
+enum CalibrationOffsetStep
+{
+  CALSTEP_NoLoad,   // Irms, Offsets zeroed
+  CALSTEP_Power,    // Pmean, in Small-Power Mode
+  CALSTEP_Reactive, // Qmean, in Small-Power Mode
+  CALSTEP_After     // Irms, Offsets applied
+};
+
+struct CalibrationRun
+{
+  uint8_t Kind;               // CalibrationKind
+  uint8_t Step;               // CalibrationOffsetStep
+  int Iteration;              // Measure and correct, from 1
+  int Samples;                // Readings taken of the current measurement
+  CalibrationReading Reading; // Mean, once all are taken
+  float Mean;                 // Raw Register mean, once all are taken (Offset)
+  float Voltage;              // Reference V.  Measured, for Offset
+  float Current;              // Reference A.  0 for Ugain only
+  float Before;               // mA at no load, Offsets zeroed
+  float PSmall;               // Small-Power Mode Pmean
+  uint16_t Original[3];       // In use before, put back if not saved
+};
+
+CalibrationRun Calibrating = {};
+ATM90E26_SPI *CalibrationEnergyIC = NULL;
+int CalibrationJobId = -1;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Add one reading to the mean of CalibrationSamples.  Returns true once all are taken, ready for the next measurement.
+boolean CalibrationSample(ATM90E26_SPI &ic, CalibrationReading &r, int &Count)
+{
+  if (Count == 0)
+    memset(&r, 0, sizeof(r));
+  r.LineVoltage += ic.GetLineVoltage() / CalibrationSamples;
+  r.LineCurrent += ic.GetLineCurrent() / CalibrationSamples;
+  r.ActivePower += ic.GetActivePower() / CalibrationSamples;
+  r.ReactivePower += ic.ReadRegister<Qmean>() / CalibrationSamples;
+  r.PowerFactor += ic.GetPowerFactor() / CalibrationSamples;
+  if (++Count < CalibrationSamples)
+    return false;
+  Count = 0;
+  return true;
+}
+
+// Add one raw reading of a Register to the mean of CalibrationOffsetSamples.  Signed as two's complement (Pmean, Qmean), if
+// Signed.  Returns true once all are taken, ready for the next measurement.
+boolean CalibrationSampleRaw(ATM90E26_SPI &ic, uint8_t Address, boolean Signed, float &Mean, int &Count)
+{
+  if (Count == 0)
+    Mean = 0;
+  uint16_t Raw = ic.GetRegister(Address);
+  Mean += (Signed ? (int16_t)Raw : Raw) / (float)CalibrationOffsetSamples;
+  if (++Count < CalibrationOffsetSamples)
+    return false;
+  Count = 0;
+  return true;
+}
+
+// Complement of a mean offset, in the 16 bit register range
+uint16_t CalibrationOffset(float Mean)
+{
+  return (uint16_t)(int16_t)constrain(-lroundf(Mean), -32768L, 32767L);
+}
+
+// Lphi in degrees, and back.  Sign and magnitude, with 10 bits of magnitude.
+float CalibrationLPhiDegrees(uint16_t LPhi)
+{
+  return (LPhi & 0x8000 ? -(int)(LPhi & 0x03FF) : (int)(LPhi & 0x03FF)) / CalibrationLPhiPerDegree;
+}
+
+uint16_t CalibrationLPhi(float Degrees)
+{
+  long Value = constrain(lroundf(Degrees * CalibrationLPhiPerDegree), -0x03FFL, 0x03FFL);
+  return Value < 0 ? 0x8000 | (uint16_t)-Value : (uint16_t)Value;
+}
+
+// Gain scaled by Ratio, in the 16 bit register range
+uint16_t CalibrationScaleGain(uint16_t Gain, float Ratio)
+{
+  return (uint16_t)constrain(lroundf(Gain * Ratio), 1L, 0xFFFFL);
+}
+
+// Lgain correcting Active Power by Ratio.  Never 0, as a saved 0 means the default.
+uint16_t CalibrationScaleLGain(uint16_t Gain, float Ratio)
+{
+  float Factor = (1 + (int16_t)Gain / 32768.0) * Ratio;
+  int16_t Result = (int16_t)constrain(lroundf((Factor - 1) * 32768), -32768L, 32767L);
+  return Result == 0 ? 1 : (uint16_t)Result;
+}
+
+// Save Gains, Phase, Offsets and Checksums, so the next boot starts calibrated.
+// In the Low Current Range (CurrentRange.h), its own set is saved instead, with Ugain and Uoffset, which both ranges share.
+// CS2 covers those two, so the Normal set's CS2 is saved again with them.
+void SaveCalibration(ATM90E26_SPI &ic)
+{
+  if (SaveCurrentRangeSet(ic))
+  {
+    Config.UGain = ic.GetUGain();
+    Config.UOffset = ic.GetUOffset();
+    SaveConfigField(&Config.UGain, sizeof(uint16_t));
+    SaveConfigField(&Config.UOffset, sizeof(uint16_t));
+    WriteEEPROM16(0x1E, NormalRangeCS2(ic));
+    return;
+  }
+
+  Config.UGain = ic.GetUGain();
+  Config.IGain = ic.GetIGain();
+  Config.LGain = ic.GetLGain();
+  Config.LPhi = ic.GetLPhi();
+  Config.UOffset = ic.GetUOffset();
+  Config.IOffset = ic.GetIOffset();
+  Config.POffset = ic.GetPOffset();
+  Config.QOffset = ic.GetQOffset();
+  SaveConfigField(&Config.UGain, 3 * sizeof(uint16_t));
+  SaveConfigField(&Config.LPhi, 5 * sizeof(uint16_t));
+  WriteEEPROM16(0x1C, ic.GetCS1Status());
+  WriteEEPROM16(0x1E, ic.GetCS2Status());
+}
+
+// True while a Calibration Run is in progress
+boolean CalibrationActive()
+{
+  return Calibrating.Kind != CAL_Idle;
+}
+
+// End the Calibration Run.  Saves if Done, otherwise puts back the settings in use before.
+void EndCalibration(ATM90E26_SPI &ic, boolean Done)
+{
+  CalibrationRun &c = Calibrating;
+
+  if (Done)
+  {
+    SaveCalibration(ic);
+    if (c.Kind == CAL_Gains)
+      LogInfo("Calibrated \t Ugain 0x%04X IgainL 0x%04X Lgain 0x%04X, saved", ic.GetUGain(), ic.GetIGain(), ic.GetLGain());
+    else if (c.Kind == CAL_Offset)
+      LogInfo("Calibrated \t IoffsetL 0x%04X PoffsetL 0x%04X QoffsetL 0x%04X, saved", ic.GetIOffset(), ic.GetPOffset(), ic.GetQOffset());
+    else
+      LogInfo("Calibrated \t Lphi 0x%04X, saved", ic.GetLPhi());
+  }
+  else if (c.Kind == CAL_Gains)
+  {
+    ic.SetUGain(c.Original[0]);
+    ic.SetIGain(c.Original[1]);
+    ic.SetLGain(c.Original[2]);
+    ic.ApplyMeteringCalibration();
+    ic.ApplyMeasurementCalibration();
+    LogWarn("Calibration not saved.  Gains restored");
+  }
+  else if (c.Kind == CAL_Offset)
+  {
+    if (c.Step == CALSTEP_Power || c.Step == CALSTEP_Reactive)
+      ic.SetSmallPowerMode(false);
+    ic.SetIOffset(c.Original[0]);
+    ic.SetPOffset(c.Original[1]);
+    ic.SetQOffset(c.Original[2]);
+    ic.ApplyMeasurementCalibration();
+    LogWarn("Offset Calibration not applied.  Offsets restored");
+  }
+  else
+  {
+    ic.SetLPhi(c.Original[0]);
+    ic.ApplyMeteringCalibration();
+    LogWarn("Phase Calibration not saved.  Lphi restored");
+  }
+
+  c.Kind = CAL_Idle;
+  CancelJob(CalibrationJobId);
+  ResumeSampler();
+}
+
+// Ugain (and IgainL, Lgain with a Current) step.  One reading, then once averaged, check and correct.  Returns ms to the next step.
+uint32_t StepGainCalibration(ATM90E26_SPI &ic)
+{
+  CalibrationRun &c = Calibrating;
+  if (!CalibrationSample(ic, c.Reading, c.Samples))
+    return CalibrationSampleTime;
+
+  const CalibrationReading &r = c.Reading;
+  boolean WithCurrent = c.Current > 0;
+  if (r.LineVoltage < 1 || (WithCurrent && r.LineCurrent < CalibrationMinCurrent))
+  {
+    LogWarn("Calibrate \t No Voltage or Current measured.  Check the AC input, CT Clamp and load");
+    EndCalibration(ic, false);
+    return 0;
+  }
+
+  float Power = c.Voltage * c.Current * fabsf(r.PowerFactor);
+  float VoltageError = r.LineVoltage / c.Voltage - 1;
+  float CurrentError = WithCurrent ? r.LineCurrent / c.Current - 1 : 0;
+  float PowerError = WithCurrent && Power > 0 ? fabsf(r.ActivePower) / Power - 1 : 0;
+  LogInfo("Calibrate %d \t %.2f V (%+.2f%%) | %.3f A (%+.2f%%)", c.Iteration, r.LineVoltage, VoltageError * 100, r.LineCurrent, CurrentError * 100);
+  LogInfo("Calibrate %d \t %.1f W (%+.2f%%) | PF %.3f", c.Iteration, r.ActivePower, PowerError * 100, r.PowerFactor);
+
+  if (fabsf(VoltageError) < CalibrationTolerance && fabsf(CurrentError) < CalibrationTolerance && fabsf(PowerError) < CalibrationTolerance)
+  {
+    EndCalibration(ic, true);
+    return 0;
+  }
+  if (c.Iteration >= CalibrationIterations)
+  {
+    LogWarn("Calibrate \t Did not converge in %d", CalibrationIterations);
+    EndCalibration(ic, false);
+    return 0;
+  }
+
+  // Correct, and write live
+  ic.SetUGain(CalibrationScaleGain(ic.GetUGain(), c.Voltage / r.LineVoltage));
+  if (WithCurrent)
+  {
+    ic.SetIGain(CalibrationScaleGain(ic.GetIGain(), c.Current / r.LineCurrent));
+    if (fabsf(r.ActivePower) > 0)
+      ic.SetLGain(CalibrationScaleLGain(ic.GetLGain(), Power / fabsf(r.ActivePower)));
+    ic.ApplyMeteringCalibration();
+  }
+  ic.ApplyMeasurementCalibration();
+  LogInfo("Calibrate %d \t Ugain 0x%04X | IgainL 0x%04X | Lgain 0x%04X | CS1 0x%04X | CS2 0x%04X", c.Iteration, ic.GetUGain(), ic.GetIGain(),
+          ic.GetLGain(), ic.GetCS1Status(), ic.GetCS2Status());
+
+  if (ic.GetSysStatus() & 0xF000)
+  {
+    LogWarn("Calibrate \t Checksum Error after writing.  Stopped");
+    EndCalibration(ic, false);
+    return 0;
+  }
+
+  c.Iteration++;
+  return CalibrationSettle + CalibrationSampleTime;
+}
+
+// IoffsetL, PoffsetL and QoffsetL step.  One reading, then once averaged, on to the next measurement.  Returns ms to the next step.
+uint32_t StepOffsetCalibration(ATM90E26_SPI &ic)
+{
+  CalibrationRun &c = Calibrating;
+
+  switch (c.Step)
+  {
+  case CALSTEP_NoLoad:
+    if (c.Samples == 0)
+      c.Voltage = ic.GetLineVoltage();
+    if (!CalibrationSampleRaw(ic, Irms, false, c.Mean, c.Samples))
+      return CalibrationSampleTime;
+
+    c.Before = c.Mean; // mA
+    LogInfo("Calibrate Offset \t %.2f V | %.1f mA with no load", c.Voltage, c.Before);
+    if (c.Voltage < 1 || c.Before > CalibrationOffsetMaxCurrent * 1000)
+    {
+      LogWarn("Calibrate Offset \t Needs the AC input on, and no current.  Remove the load or CT Clamp");
+      EndCalibration(ic, false);
+      return 0;
+    }
+
+    // Power, in Small-Power Mode
+    ic.SetSmallPowerMode(true);
+    c.Step = CALSTEP_Power;
+    return CalibrationSettle + CalibrationSampleTime;
+
+  case CALSTEP_Power:
+    if (!CalibrationSampleRaw(ic, Pmean, true, c.Mean, c.Samples))
+      return CalibrationSampleTime;
+    c.PSmall = c.Mean;
+    c.Step = CALSTEP_Reactive;
+    return CalibrationSampleTime;
+
+  case CALSTEP_Reactive:
+  {
+    if (!CalibrationSampleRaw(ic, Qmean, true, c.Mean, c.Samples))
+      return CalibrationSampleTime;
+    ic.SetSmallPowerMode(false);
+    float Scale = (float)ic.GetUGain() * ic.GetIGain() / (100000.0 * 4194304.0); // Small-Power Mode to W, var
+    LogInfo("Calibrate Offset \t Small-Power Mode Pmean %.1f (%.1f mW) | Qmean %.1f (%.1f mvar)", c.PSmall, c.PSmall * Scale * 1000, c.Mean,
+            c.Mean * Scale * 1000);
+
+    ic.SetIOffset(CalibrationOffset(c.Before * ic.GetIGain() / 256.0)); // x IgainL / 2^16 x 2^8
+    ic.SetPOffset(CalibrationOffset(c.PSmall));
+    ic.SetQOffset(CalibrationOffset(c.Mean));
+    ic.ApplyMeasurementCalibration();
+    c.Step = CALSTEP_After;
+    return CalibrationSettle + CalibrationSampleTime;
+  }
+
+  default:
+    if (!CalibrationSampleRaw(ic, Irms, false, c.Mean, c.Samples))
+      return CalibrationSampleTime;
+    LogInfo("Calibrate Offset \t IoffsetL 0x%04X | PoffsetL 0x%04X | QoffsetL 0x%04X | CS2 0x%04X | %.1f mA after", ic.GetIOffset(), ic.GetPOffset(),
+            ic.GetQOffset(), ic.GetCS2Status(), c.Mean);
+
+    if (ic.GetSysStatus() & 0x3000)
+    {
+      LogWarn("Calibrate Offset \t Checksum Error after writing");
+      EndCalibration(ic, false);
+    }
+    else
+    {
+      if (c.Mean > c.Before)
+        LogWarn("Calibrate Offset \t Current reads higher after");
+      EndCalibration(ic, c.Mean <= c.Before);
+    }
+    return 0;
+  }
+}
+
+// Lphi step.  One reading, then once averaged, check and correct.  Returns ms to the next step.
+uint32_t StepPhaseCalibration(ATM90E26_SPI &ic)
+{
+  CalibrationRun &c = Calibrating;
+  if (!CalibrationSample(ic, c.Reading, c.Samples))
+    return CalibrationSampleTime;
+
+  const CalibrationReading &r = c.Reading;
+  if (r.LineCurrent < CalibrationMinCurrent || fabsf(r.ActivePower) < 1)
+  {
+    LogWarn("Calibrate Phase \t No Current measured.  Check the CT Clamp and resistive load");
+    EndCalibration(ic, false);
+    return 0;
+  }
+
+  // Lagging positive.  Either way round of the CT Clamp.
+  float Angle = atan2f(r.ActivePower < 0 ? -r.ReactivePower : r.ReactivePower, fabsf(r.ActivePower)) * RAD_TO_DEG;
+  LogInfo("Calibrate Phase %d \t %.1f W | %.1f var | %+.3f deg | PF %.3f", c.Iteration, r.ActivePower, r.ReactivePower, Angle, r.PowerFactor);
+
+  if (fabsf(Angle) < CalibrationPhaseTolerance)
+  {
+    EndCalibration(ic, true);
+    return 0;
+  }
+  if (c.Iteration >= CalibrationIterations)
+  {
+    LogWarn("Calibrate Phase \t Did not converge in %d", CalibrationIterations);
+    EndCalibration(ic, false);
+    return 0;
+  }
+
+  // Correct, and write live
+  ic.SetLPhi(CalibrationLPhi(CalibrationLPhiDegrees(ic.GetLPhi()) + Angle));
+  ic.ApplyMeteringCalibration();
+  LogInfo("Calibrate Phase %d \t Lphi 0x%04X | CS1 0x%04X", c.Iteration, ic.GetLPhi(), ic.GetCS1Status());
+
+  if (ic.GetSysStatus() & 0xC000)
+  {
+    LogWarn("Calibrate Phase \t Checksum Error after writing.  Stopped");
+    EndCalibration(ic, false);
+    return 0;
+  }
+
+  c.Iteration++;
+  return CalibrationSettle + CalibrationSampleTime;
+}
+
+// Calibration Job.  Runs the next step, then re-arms for the one after.
+void CalibrationJob()
+{
+  if (!CalibrationActive())
+    return;
+
+  ATM90E26_SPI &ic = *CalibrationEnergyIC;
+  PauseSampler(); // Again, as a Benchmark or Replay meanwhile resumes it
+  uint32_t Next;
+  if (Calibrating.Kind == CAL_Gains)
+    Next = StepGainCalibration(ic);
+  else if (Calibrating.Kind == CAL_Offset)
+    Next = StepOffsetCalibration(ic);
+  else
+    Next = StepPhaseCalibration(ic);
+  if (CalibrationActive())
+    ScheduleJob(CalibrationJobId, Next);
+}
+
+// Start calibrating Ugain (and IgainL, Lgain with a Current) to the Reference.  Returns false if a Run is already in progress.
+// Once converged the gains are saved.  The gains in use before are put back if it does not converge.
+boolean StartCalibration(ATM90E26_SPI &ic, float Voltage, float Current)
+{
+  if (CalibrationActive() || CalibrationJobId < 0)
+    return false;
+
+  CalibrationRun &c = Calibrating;
+  memset(&c, 0, sizeof(c));
+  c.Kind = CAL_Gains;
+  c.Iteration = 1;
+  c.Voltage = Voltage;
+  c.Current = Current;
+  c.Original[0] = ic.GetUGain();
+  c.Original[1] = ic.GetIGain();
+  c.Original[2] = ic.GetLGain();
+
+  PauseSampler();
+  LogInfo("Calibrate \t Started.  %.2f V | %.3f A reference", Voltage, Current);
+  ScheduleJob(CalibrationJobId, CalibrationSampleTime);
+  return true;
+}
+
+// Start calibrating IoffsetL, PoffsetL and QoffsetL at no load.  Returns false if a Run is already in progress.
+// The Offsets are applied and saved once measured.  Those in use before are put back if a load is on, or the Current reads
+// no lower after.
+boolean StartOffsetCalibration(ATM90E26_SPI &ic)
+{
+  if (CalibrationActive() || CalibrationJobId < 0)
+    return false;
+
+  CalibrationRun &c = Calibrating;
+  memset(&c, 0, sizeof(c));
+  c.Kind = CAL_Offset;
+  c.Step = CALSTEP_NoLoad;
+  c.Original[0] = ic.GetIOffset();
+  c.Original[1] = ic.GetPOffset();
+  c.Original[2] = ic.GetQOffset();
+
+  PauseSampler();
+
+  // Zero, so the readings are the whole offset
+  ic.SetIOffset(0);
+  ic.SetPOffset(0);
+  ic.SetQOffset(0);
+  ic.ApplyMeasurementCalibration();
+
+  LogInfo("Calibrate Offset \t Started");
+  ScheduleJob(CalibrationJobId, CalibrationSettle);
+  return true;
+}
+
+// Start calibrating Lphi with a resistive load.  Returns false if a Run is already in progress.
+// Once converged Lphi is saved.  The Lphi in use before is put back if it does not converge.
+boolean StartPhaseCalibration(ATM90E26_SPI &ic)
+{
+  if (CalibrationActive() || CalibrationJobId < 0)
+    return false;
+
+  CalibrationRun &c = Calibrating;
+  memset(&c, 0, sizeof(c));
+  c.Kind = CAL_Phase;
+  c.Iteration = 1;
+  c.Original[0] = ic.GetLPhi();
+
+  PauseSampler();
+  LogInfo("Calibrate Phase \t Started");
+  ScheduleJob(CalibrationJobId, CalibrationSampleTime);
+  return true;
+}
+
+// Stop a Calibration Run, putting back the settings in use before.  Returns false if none was in progress.
+boolean StopCalibration()
+{
+  if (!CalibrationActive())
+    return false;
+  LogWarn("Calibration stopped");
+  EndCalibration(*CalibrationEnergyIC, false);
+  return true;
+}
+
+// Initialise Calibration, with its One Shot Job.  Armed by each Start.
+void InitialiseCalibration(ATM90E26_SPI &ic)
+{
+  CalibrationEnergyIC = &ic;
+  CalibrationJobId = AddOneShotJob("Calibration", CalibrationJob);
+}
@@ -0,0 +1,358 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <rom/crc.h> // ESP32 ROM CRC32
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Configuration Store.  Board settings are held in RAM in one struct, Config, and saved in the EEPROM.  One firmware
+// image can then be flashed to every board, and each board set up from the serial console ('set wifi_ssid ...').
+//
+// EEPROM Layout
+//   0x100  Image Slot A  ConfigHeader, then GTEM_Config
+//   0x300  Image Slot B
+//   0x500  Journal       Records of Offset (16 bit), Length (8 bit), Data and CRC32, one after another
+//
+// At boot the whole area is read in one pass.  The valid Slot with the highest Generation is loaded over the defaults,
+// then each Journal Record is applied in turn, up to the first that fails its CRC.  A Record CRC is seeded with the
+// Generation, so Records left from an earlier Generation are never applied.
+// A change writes a single Record, so a power cut can only lose that change.  When the Journal is full, the whole Config
+// is written to the other Slot with the next Generation, which empties the Journal.  Until that Slot is complete, the
+// old Slot and Journal still load.
+//
+// Add new fields at the end of GTEM_Config.  Shorter saved Images still load, and the new fields keep their defaults.
+// Change CONFIG_VERSION if fields are moved or removed.  Saved settings are then dropped.
+#define CONFIG_VERSION 1
+#define CONFIG_MAGIC 0x46435447 // "GTCF"
+#define CONFIG_SLOT_A 0x100
+#define CONFIG_SLOT_B 0x300
+#define CONFIG_SLOT_SIZE 0x200
+#define CONFIG_JOURNAL 0x500
+#define CONFIG_JOURNAL_SIZE 0x400
+#define CONFIG_AREA_SIZE (CONFIG_JOURNAL + CONFIG_JOURNAL_SIZE - CONFIG_SLOT_A)
+#define CONFIG_RECORD_MAX 128 // Largest Record Data.  Larger fields save the whole Config.
+
+#define FILTER_MEDIAN_MAX 9 // Largest Median window
+#define CONFIG_FILTERS 5    // One per Statistics Metric
+
+// Filter Settings.  See Filters.h
+struct FilterConfig
+{
+  uint8_t Median;   // Window size, 1 (off) to FILTER_MEDIAN_MAX.  Odd sizes give a true median.
+  float Alpha;      // EMA weight of the new sample, 0 to 1 (1 = off)
+  float Deadzone;   // Magnitude below which the value reads zero (0 = off)
+  float Hysteresis; // Extra magnitude needed to leave zero
+};
+
+// Domoticz Devices Indexes (IDX).  If Zero, then entry is ignored.
+struct DomoticzIndexes
+{
+  int LineVoltage;    // Urms - Line Voltage RMS
+  int LineCurrent;    // Irms - Line Current RMS
+  int ActivePower;    // Pmean - Line Mean Active Power
+  int ImportPower;    // Pmean - Line Mean Active Import Power
+  int ExportPower;    // Pmean - Line Mean Active Export Power
+  int LineFrequency;  // Freq - Line Voltage Frequency
+  int ImportEnergy;   // APenergy - Forward Active Energy
+  int ExportEnergy;   // ANenergy - Reverse Active Energy
+  int PowerFactor;    // PowerF - Line Power Factor
+  int DCVoltage;      // PCB DC Input (Derived from AC)
+  int PCBTemperature; // PCB NTC
+};
+
+// Low Current Range Calibration (CurrentRange.h).  Used once LowRangeSaved.  Until then the Low set follows the Normal set, with
+// the Normal IGain scaled to the PGA.
+struct RangeCalibration
+{
+  uint16_t IGain;
+  uint16_t LGain;
+  uint16_t LPhi;
+  uint16_t IOffset;
+  uint16_t POffset;
+  uint16_t QOffset;
+};
+
+struct GTEM_Config
+{
+  char WiFiSSID[33];       // network SSID - Case Sensitive
+  char WiFiPassword[65];   // network password - Case Sensitive
+  char DomoticzServer[40]; // IP Address
+  int DomoticzPort;        // Domoticz port
+  boolean EnableDomoticz;  // Read Loop and send data to Domoticz
+  DomoticzIndexes Idx;
+  int LoopDelay;           // Loop Delay in Seconds
+  boolean EnableBasicInfo; // Display basic loop readings
+  boolean EnableAveraging; // Display filtered Snapshot values
+  float ADCConstant;       // VDC_IN calibration
+  uint16_t UGain;          // Calibration Gains.  0 uses the defaults in GTEM-1_Defaults.h, applied at boot.
+  uint16_t IGain;
+  uint16_t LGain;
+  FilterConfig Filters[CONFIG_FILTERS];
+  uint16_t LPhi;           // Calibration Phase and Offsets.  0 uses the defaults, as the Gains.
+  uint16_t UOffset;
+  uint16_t IOffset;
+  uint16_t POffset;
+  uint16_t QOffset;
+  RangeCalibration LowRange; // Low Current Range Calibration
+  int DomoticzWindow;        // Domoticz publishes the mean over this Statistics Window (0 1s, 1 1min, 2 15min).  -1 the latest Snapshot
+  boolean LowRangeSaved;     // LowRange holds a saved Calibration, so any value in it, 0 too, is used
+};
+
+struct ConfigHeader
+{
+  uint32_t Magic;
+  uint16_t Version;
+  uint16_t Length;     // Bytes of GTEM_Config saved
+  uint32_t Generation; // Highest is newest
+  uint32_t Crc;        // CRC32 of the fields above, then the saved GTEM_Config
+};
+
+static_assert(sizeof(GTEM_Config) <= CONFIG_SLOT_SIZE - sizeof(ConfigHeader), "GTEM_Config must fit a Config Slot");
+
+GTEM_Config Config;
+uint32_t ConfigGeneration = 0;           // Generation loaded or last saved.  0 if none.
+unsigned int ConfigSlot = CONFIG_SLOT_B; // Slot of that Generation.  The next full save goes to the other.
+unsigned int ConfigJournalEnd = 0;       // Journal bytes used
+
+// Statistics
+uint32_t ConfigRecords = 0;     // Journal Records applied at boot, or written since
+uint32_t ConfigCompactions = 0; // Full saves
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Defaults.  Setup with your Wireless, Domoticz and Device Index Information.  Used until changed from the console.
+void ConfigDefaults(GTEM_Config &c)
+{
+  memset(&c, 0, sizeof(GTEM_Config)); // Padding too, so the CRC is repeatable
+
+  // WiFi.  Setup with your Wireless Information
+  strlcpy(c.WiFiSSID, "xxxx", sizeof(c.WiFiSSID));         // network SSID - Case Sensitive
+  strlcpy(c.WiFiPassword, "xxxx", sizeof(c.WiFiPassword)); // network password - Case Sensitive
+
+  // Domoticz Server info.  Setup with your Domoticz IP and Port
+  strlcpy(c.DomoticzServer, "0.0.0.0", sizeof(c.DomoticzServer)); // IP Address
+  c.DomoticzPort = 8080;                                          // Domoticz port
+  c.EnableDomoticz = false;                                       // Change to true to enable read Loop and sending data to Domoticz.
+
+  // Set these values to the Domoticz Devices Indexes (IDX).  If Zero, then entry is ignored. Device needs to be created in Domoticz.
+  c.Idx.LineVoltage = 34;    // Urms - Line Voltage RMS
+  c.Idx.LineCurrent = 35;    // Irms - Line Current RMS
+  c.Idx.ActivePower = 37;    // Pmean - Line Mean Active Power
+  c.Idx.ImportPower = 38;    // Pmean - Line Mean Active Import Power
+  c.Idx.ExportPower = 39;    // Pmean - Line Mean Active Export Power
+  c.Idx.LineFrequency = 36;  // Freq - Line Voltage Frequency
+  c.Idx.ImportEnergy = 40;   // APenergy - Forward Active Energy
+  c.Idx.ExportEnergy = 41;   // ANenergy - Reverse Active Energy
+  c.Idx.PowerFactor = 44;    // PowerF - Line Power Factor
+  c.Idx.DCVoltage = 0;       // PCB DC Input (Derived from AC)
+  c.Idx.PCBTemperature = 43; // PCB NTC
+
+  c.LoopDelay = 1;           // Loop Delay in Seconds
+  c.EnableBasicInfo = false; // Set to true to display basic loop readings
+  c.EnableAveraging = true;  // Set to true to display filtered Snapshot values (See Filters.h)
+  c.ADCConstant = 31.340;    // Adjust as needed for calibration of VDC_IN.
+
+  // Calibration Gains.  0 uses the defaults in GTEM-1_Defaults.h
+  c.UGain = 0;
+  c.IGain = 0;
+  c.LGain = 0;
+
+  // Filters, per Statistics Metric
+  c.Filters[0] = {5, 1.0, 10.0, 2.0}; // Line Voltage.  Reads zero below 10 V (no AC input)
+  c.Filters[1] = {5, 1.0, 0.0, 0.0};  // Line Current
+  c.Filters[2] = {5, 1.0, 5.0, 2.0};  // Active Power.  Reads zero between -5 W and +5 W, so small export is still seen
+  c.Filters[3] = {5, 1.0, 0.0, 0.0};  // Line Frequency
+  c.Filters[4] = {5, 1.0, 0.0, 0.0};  // Power Factor
+
+  // Calibration Phase and Offsets.  0 uses the defaults in ATM90E26_Profile, which are 0
+  c.LPhi = 0;
+  c.UOffset = 0;
+  c.IOffset = 0;
+  c.POffset = 0;
+  c.QOffset = 0;
+  memset(&c.LowRange, 0, sizeof(RangeCalibration));
+
+  c.DomoticzWindow = 0; // 1 s mean (Statistics.h)
+  c.LowRangeSaved = false;
+}
+
+// Journal Record CRC seed.  Records from another Generation or Version never match.
+uint32_t ConfigSeed()
+{
+  return ConfigGeneration ^ ((uint32_t)CONFIG_VERSION << 24);
+}
+
+// Image Slot valid?  Returns the saved Length, or 0
+uint16_t ConfigImageValid(const uint8_t *Slot)
+{
+  ConfigHeader Header;
+  memcpy(&Header, Slot, sizeof(ConfigHeader));
+
+  if (Header.Magic != CONFIG_MAGIC || Header.Version != CONFIG_VERSION || Header.Length == 0 ||
+      Header.Length > CONFIG_SLOT_SIZE - sizeof(ConfigHeader))
+    return 0;
+
+  uint32_t Crc = crc32_le(0, Slot, offsetof(ConfigHeader, Crc));
+  Crc = crc32_le(Crc, Slot + sizeof(ConfigHeader), Header.Length);
+  return Crc == Header.Crc ? Header.Length : 0;
+}
+
+// Encode one Journal Record, Offset (16 bit LE), Length, Data then CRC32.  Returns the Record length.
+unsigned int ConfigEncodeRecord(uint8_t *Record, uint16_t Offset, const void *Data, uint8_t Length)
+{
+  Record[0] = Offset & 0xFF;
+  Record[1] = Offset >> 8;
+  Record[2] = Length;
+  memcpy(Record + 3, Data, Length);
+  uint32_t Crc = crc32_le(ConfigSeed(), Record, 3 + Length);
+  memcpy(Record + 3 + Length, &Crc, 4);
+  return 7 + Length;
+}
+
+// Decode one Journal Record, from at most Space bytes.  Returns the Record length, or 0 if it is not valid.
+unsigned int ConfigDecodeRecord(const uint8_t *Record, unsigned int Space, uint16_t &Offset, uint8_t &Length)
+{
+  if (Space < 7)
+    return 0;
+  Offset = Record[0] | (Record[1] << 8);
+  Length = Record[2];
+  if (Length == 0 || Length > CONFIG_RECORD_MAX || Offset + Length > sizeof(GTEM_Config) || 7u + Length > Space)
+    return 0;
+
+  uint32_t Crc;
+  memcpy(&Crc, Record + 3 + Length, 4);
+  if (crc32_le(ConfigSeed(), Record, 3 + Length) != Crc)
+    return 0;
+  return 7 + Length;
+}
+
+// Apply Journal Records, up to the first that is not valid.  Returns the Journal bytes used.
+unsigned int ConfigReplay(const uint8_t *Journal)
+{
+  unsigned int Position = 0;
+  unsigned int Used;
+  uint16_t Offset;
+  uint8_t Length;
+
+  while ((Used = ConfigDecodeRecord(Journal + Position, CONFIG_JOURNAL_SIZE - Position, Offset, Length)) > 0)
+  {
+    memcpy((uint8_t *)&Config + Offset, Journal + Position + 3, Length);
+    Position += Used;
+    ConfigRecords++;
+  }
+
+  return Position;
+}
+
+// Load Config.  Defaults, then the newest saved Image and Journal.  Once, at boot, after InitializeEEPROM().
+void LoadConfig()
+{
+  ConfigDefaults(Config);
+
+  uint8_t *Area = (uint8_t *)malloc(CONFIG_AREA_SIZE);
+  if (Area == NULL)
+  {
+    LogError("Config \t\t Defaults (Out of Memory)");
+    return;
+  }
+  readEEPROMBlock(CONFIG_SLOT_A, Area, CONFIG_AREA_SIZE);
+
+  // Newest valid Image
+  uint8_t *SlotA = Area;
+  uint8_t *SlotB = Area + (CONFIG_SLOT_B - CONFIG_SLOT_A);
+  uint16_t LengthA = ConfigImageValid(SlotA);
+  uint16_t LengthB = ConfigImageValid(SlotB);
+  uint32_t GenerationA = LengthA ? ((const ConfigHeader *)SlotA)->Generation : 0;
+  uint32_t GenerationB = LengthB ? ((const ConfigHeader *)SlotB)->Generation : 0;
+
+  if (LengthA > 0 && (LengthB == 0 || GenerationA > GenerationB))
+  {
+    memcpy(&Config, SlotA + sizeof(ConfigHeader), min((size_t)LengthA, sizeof(GTEM_Config)));
+    ConfigGeneration = GenerationA;
+    ConfigSlot = CONFIG_SLOT_A;
+  }
+  else if (LengthB > 0)
+  {
+    memcpy(&Config, SlotB + sizeof(ConfigHeader), min((size_t)LengthB, sizeof(GTEM_Config)));
+    ConfigGeneration = GenerationB;
+    ConfigSlot = CONFIG_SLOT_B;
+  }
+
+  ConfigJournalEnd = ConfigReplay(Area + (CONFIG_JOURNAL - CONFIG_SLOT_A));
+  free(Area);
+
+  if (ConfigGeneration == 0 && ConfigRecords == 0)
+    LogInfo("Config \t\t Defaults");
+  else
+    LogInfo("Config \t\t Generation %u, %u Changes Loaded from EEPROM", ConfigGeneration, ConfigRecords);
+}
+
+// Save the whole Config to the other Slot, with the next Generation.  The Journal is then empty.
+void SaveConfig()
+{
+  unsigned int Slot = ConfigSlot == CONFIG_SLOT_A ? CONFIG_SLOT_B : CONFIG_SLOT_A;
+  ConfigHeader Header = {CONFIG_MAGIC, CONFIG_VERSION, sizeof(GTEM_Config), ConfigGeneration + 1, 0};
+
+  Header.Crc = crc32_le(0, (const uint8_t *)&Header, offsetof(ConfigHeader, Crc));
+  Header.Crc = crc32_le(Header.Crc, (const uint8_t *)&Config, sizeof(GTEM_Config));
+
+  // Header last, so the Slot only becomes valid once complete
+  WriteEEPROMBlock(Slot + sizeof(ConfigHeader), (const uint8_t *)&Config, sizeof(GTEM_Config));
+  WriteEEPROMBlock(Slot, (const uint8_t *)&Header, sizeof(ConfigHeader));
+
+  ConfigSlot = Slot;
+  ConfigGeneration = Header.Generation;
+  ConfigJournalEnd = 0;
+  ConfigCompactions++;
+}
+
+// Save one field of Config, once changed in RAM.  Appends one Journal Record, or saves the whole Config when the
+// Journal is full.  Returns false if Field is not part of Config.  i.e. SaveConfigField(&Config.LoopDelay, sizeof(int))
+boolean SaveConfigField(const void *Field, size_t Size)
+{
+  const uint8_t *Data = (const uint8_t *)Field;
+  const uint8_t *Base = (const uint8_t *)&Config;
+  if (Size == 0 || Data < Base || Data + Size > Base + sizeof(GTEM_Config))
+    return false;
+
+  if (Size > CONFIG_RECORD_MAX || ConfigJournalEnd + 7 + Size > CONFIG_JOURNAL_SIZE)
+  {
+    SaveConfig();
+    return true;
+  }
+
+  uint8_t Record[7 + CONFIG_RECORD_MAX];
+  ConfigEncodeRecord(Record, Data - Base, Data, Size);
+
+  WriteEEPROMBlock(CONFIG_JOURNAL + ConfigJournalEnd, Record, 7 + Size);
+  ConfigJournalEnd += 7 + Size;
+  ConfigRecords++;
+  return true;
+}
+
+// Back to the Defaults, saved
+void ResetConfig()
+{
+  ConfigDefaults(Config);
+  SaveConfig();
+}
+
+// Display Configuration Store
+void DisplayConfig()
+{
+  Serial.printf("Config \t\t\t\tGeneration %u | Slot 0x%03X | Journal %u of %u bytes | Changes %u | Full Saves %u\n", (unsigned)ConfigGeneration,
+                ConfigGeneration ? ConfigSlot : 0, ConfigJournalEnd, (unsigned)CONFIG_JOURNAL_SIZE, (unsigned)ConfigRecords, (unsigned)ConfigCompactions);
+}
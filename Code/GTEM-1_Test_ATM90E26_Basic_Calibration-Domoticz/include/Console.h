@@ -0,0 +1,489 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// Libraries
+#include <rom/crc.h> // ESP32 ROM CRC32
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Serial Command Console.  Type 'help' in the serial monitor.  Characters are collected as they arrive by a Scheduler Job,
+// and a command runs when Enter is pressed, so the console never waits on the serial port.
+boolean EnableConsole = true; // Set to true to accept serial commands
+
+const int ConsoleLineSize = 96;     // Longest command
+const uint32_t ConsolePollTime = 20; // Serial polled this often (ms)
+
+// Settings.  Registered with AddConsoleSetting() and changed with 'set <name> <value>'.  Settings in Config are saved
+// to the EEPROM (ConfigStore.h).
+enum ConsoleSettingType
+{
+  SETTING_Bool,  // boolean
+  SETTING_Int,   // int
+  SETTING_Hex,   // uint16_t, shown in hex
+  SETTING_Float, // float
+  SETTING_Text,  // char[Max].  Min is the shortest allowed.
+  SETTING_Secret // As Text, never shown
+};
+
+struct ConsoleSetting
+{
+  const char *Name;
+  ConsoleSettingType Type;
+  void *Value;
+  int32_t Min;
+  int32_t Max;
+  void (*Changed)(); // Called after a change, or NULL
+};
+
+// Commands.  Registered with AddConsoleCommand().  Args is the rest of the line, after the command name.
+typedef void (*ConsoleHandler)(char *Args);
+
+struct ConsoleCommand
+{
+  const char *Name;
+  const char *Help;
+  ConsoleHandler Handler;
+};
+
+// Binary Dump Sources.  Registered with AddConsoleDump().  Read copies up to Size bytes from Offset, and returns the count.
+typedef size_t (*ConsoleDumpReader)(uint32_t Offset, uint8_t *Buffer, size_t Size);
+
+struct ConsoleDump
+{
+  const char *Name;
+  uint32_t (*Length)();
+  ConsoleDumpReader Read;
+};
+
+const int ConsoleSettingsMax = 32;
+const int ConsoleCommandsMax = 16;
+const int ConsoleDumpsMax = 4;
+ConsoleSetting ConsoleSettings[ConsoleSettingsMax];
+ConsoleCommand ConsoleCommands[ConsoleCommandsMax];
+ConsoleDump ConsoleDumps[ConsoleDumpsMax];
+int ConsoleSettingCount = 0;
+int ConsoleCommandCount = 0;
+int ConsoleDumpCount = 0;
+
+char ConsoleLine[ConsoleLineSize];
+int ConsoleLength = 0;
+boolean ConsoleOverflow = false;
+ATM90E26_SPI *ConsoleEnergyIC = NULL;
+
+// Registers shown by 'regs' and dumped.  Table indexes of those that read back without side effects.
+int ConsoleRegisterList[ATM90E26RegisterCount];
+int ConsoleRegisterCount = 0;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Register a Setting, before InitialiseConsole()
+void AddConsoleSetting(const char *Name, ConsoleSettingType Type, void *Value, int32_t Min, int32_t Max, void (*Changed)() = NULL)
+{
+  if (ConsoleSettingCount < ConsoleSettingsMax)
+    ConsoleSettings[ConsoleSettingCount++] = {Name, Type, Value, Min, Max, Changed};
+  else
+    LogError("Console Setting %s not added.  Raise ConsoleSettingsMax (%d)", Name, ConsoleSettingsMax);
+}
+
+// Register a Command
+void AddConsoleCommand(const char *Name, const char *Help, ConsoleHandler Handler)
+{
+  if (ConsoleCommandCount < ConsoleCommandsMax)
+    ConsoleCommands[ConsoleCommandCount++] = {Name, Help, Handler};
+  else
+    LogError("Console Command %s not added.  Raise ConsoleCommandsMax (%d)", Name, ConsoleCommandsMax);
+}
+
+// Register a Binary Dump Source
+void AddConsoleDump(const char *Name, uint32_t (*Length)(), ConsoleDumpReader Read)
+{
+  if (ConsoleDumpCount < ConsoleDumpsMax)
+    ConsoleDumps[ConsoleDumpCount++] = {Name, Length, Read};
+  else
+    LogError("Console Dump %s not added.  Raise ConsoleDumpsMax (%d)", Name, ConsoleDumpsMax);
+}
+
+int32_t GetSettingValue(const ConsoleSetting &Setting)
+{
+  if (Setting.Type == SETTING_Bool)
+    return *(boolean *)Setting.Value ? 1 : 0;
+  if (Setting.Type == SETTING_Hex)
+    return *(uint16_t *)Setting.Value;
+  return *(int *)Setting.Value;
+}
+
+void SetSettingValue(const ConsoleSetting &Setting, int32_t Value)
+{
+  if (Setting.Type == SETTING_Bool)
+    *(boolean *)Setting.Value = Value != 0;
+  else if (Setting.Type == SETTING_Hex)
+    *(uint16_t *)Setting.Value = Value;
+  else
+    *(int *)Setting.Value = Value;
+}
+
+// Bytes held by a Setting
+size_t GetSettingSize(const ConsoleSetting &Setting)
+{
+  switch (Setting.Type)
+  {
+  case SETTING_Bool:
+    return sizeof(boolean);
+  case SETTING_Hex:
+    return sizeof(uint16_t);
+  case SETTING_Float:
+    return sizeof(float);
+  case SETTING_Text:
+  case SETTING_Secret:
+    return Setting.Max;
+  default:
+    return sizeof(int);
+  }
+}
+
+// Print one Setting
+void PrintSetting(const ConsoleSetting &Setting)
+{
+  if (Setting.Type == SETTING_Float)
+    Serial.printf("%-16s %.4f\n", Setting.Name, *(float *)Setting.Value);
+  else if (Setting.Type == SETTING_Text)
+    Serial.printf("%-16s %s\n", Setting.Name, (const char *)Setting.Value);
+  else if (Setting.Type == SETTING_Secret)
+    Serial.printf("%-16s %s\n", Setting.Name, *(const char *)Setting.Value ? "********" : "");
+  else if (Setting.Type == SETTING_Bool)
+    Serial.printf("%-16s %s\n", Setting.Name, GetSettingValue(Setting) ? "true" : "false");
+  else if (Setting.Type == SETTING_Hex)
+    Serial.printf("%-16s 0x%04X\n", Setting.Name, (unsigned)GetSettingValue(Setting));
+  else
+    Serial.printf("%-16s %d\n", Setting.Name, (int)GetSettingValue(Setting));
+}
+
+int FindSetting(const char *Name)
+{
+  for (int i = 0; i < ConsoleSettingCount; i++)
+  {
+    if (strcasecmp(ConsoleSettings[i].Name, Name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+// get [name]
+void ConsoleGet(char *Args)
+{
+  if (*Args == 0)
+  {
+    for (int i = 0; i < ConsoleSettingCount; i++)
+      PrintSetting(ConsoleSettings[i]);
+    return;
+  }
+
+  int Index = FindSetting(Args);
+  if (Index < 0)
+    Serial.printf("Unknown Setting '%s'\n", Args);
+  else
+    PrintSetting(ConsoleSettings[Index]);
+}
+
+// Check and store a Setting from its text.  Returns false, with the reason shown, if not valid.
+boolean ParseSetting(const ConsoleSetting &Setting, const char *Value)
+{
+  char *End;
+
+  if (Setting.Type == SETTING_Text || Setting.Type == SETTING_Secret)
+  {
+    int32_t Length = strlen(Value);
+    if (Length < Setting.Min || Length >= Setting.Max)
+    {
+      Serial.printf("%s must be %d to %d characters\n", Setting.Name, (int)Setting.Min, (int)Setting.Max - 1);
+      return false;
+    }
+    memset(Setting.Value, 0, Setting.Max);
+    memcpy(Setting.Value, Value, Length);
+    return true;
+  }
+
+  if (Setting.Type == SETTING_Float)
+  {
+    float Decimal = strtof(Value, &End);
+    if (*End != 0 || Decimal < Setting.Min || Decimal > Setting.Max)
+    {
+      Serial.printf("%s must be %d to %d\n", Setting.Name, (int)Setting.Min, (int)Setting.Max);
+      return false;
+    }
+    *(float *)Setting.Value = Decimal;
+    return true;
+  }
+
+  int32_t Number;
+  if (strcasecmp(Value, "true") == 0 || strcasecmp(Value, "on") == 0)
+    Number = 1;
+  else if (strcasecmp(Value, "false") == 0 || strcasecmp(Value, "off") == 0)
+    Number = 0;
+  else
+  {
+    Number = strtol(Value, &End, 0);
+    if (*End != 0)
+    {
+      Serial.printf("Not a Number '%s'\n", Value);
+      return false;
+    }
+  }
+
+  if (Number < Setting.Min || Number > Setting.Max)
+  {
+    Serial.printf("%s must be %d to %d\n", Setting.Name, (int)Setting.Min, (int)Setting.Max);
+    return false;
+  }
+  SetSettingValue(Setting, Number);
+  return true;
+}
+
+// set <name> <value>
+void ConsoleSet(char *Args)
+{
+  char *Value = strchr(Args, ' ');
+  if (Value == NULL)
+  {
+    Serial.println("Usage: set <name> <value>");
+    return;
+  }
+  *Value++ = 0;
+
+  int Index = FindSetting(Args);
+  if (Index < 0)
+  {
+    Serial.printf("Unknown Setting '%s'\n", Args);
+    return;
+  }
+
+  const ConsoleSetting &Setting = ConsoleSettings[Index];
+  if (!ParseSetting(Setting, Value))
+    return;
+
+  if (!SaveConfigField(Setting.Value, GetSettingSize(Setting)))
+    Serial.println("Not saved.  Lost at reboot");
+  if (Setting.Changed != NULL)
+    Setting.Changed();
+  PrintSetting(Setting);
+}
+
+// regs.  ATM90E26 Register values
+void ConsoleRegisters(char *Args)
+{
+  if (ConsoleEnergyIC == NULL)
+    return;
+
+  for (int i = 0; i < ConsoleRegisterCount; i++)
+  {
+    const RegisterInfo &Info = ATM90E26Registers[ConsoleRegisterList[i]];
+    uint16_t Value = ConsoleEnergyIC->GetRegister(Info.Address);
+    Serial.printf("0x%02X %-10s 0x%04X%s", Info.Address, Info.Name, Value, i % 4 == 3 ? "\n" : "\t");
+  }
+  Serial.println();
+}
+
+// stats.  Statistics and Histograms
+void ConsoleStatistics(char *Args)
+{
+  if (EnableStatistics == true)
+    DisplayStatistics();
+  DisplayLatencyStatistics();
+  DisplaySchedulerStatistics();
+  if (EnableHealthCheck == true)
+    DisplayHealthStatistics();
+  if (EnableAnalogSampler == true)
+    DisplayAnalogStatistics();
+  if (SnapshotTaskHandle != NULL)
+  {
+    DisplayPipelineStatistics();
+    if (EnableAdaptiveRate == true)
+      DisplayAdaptiveRateStatistics();
+    DisplayCurrentRangeStatistics();
+  }
+  if (EnableDirectionEvents == true)
+    DisplayDirectionStatistics();
+  if (EnableInfluxDB == true)
+    DisplayInfluxStatistics();
+  if (EnableModbus == true)
+    DisplayModbusStatistics();
+  DisplaySerialWriterStatistics();
+  DisplayLoggerStatistics();
+  DisplayTraceStatistics();
+}
+
+// dump <source>.  Binary Bulk Dump.  "GTEMDUMP", 32 bit length, the data, then CRC32 of the data, all little endian.
+void ConsoleBinaryDump(char *Args)
+{
+  int Source = -1;
+  for (int i = 0; i < ConsoleDumpCount; i++)
+  {
+    if (strcasecmp(ConsoleDumps[i].Name, Args) == 0)
+      Source = i;
+  }
+
+  if (Source < 0)
+  {
+    Serial.print("Usage: dump <source>.  Sources:");
+    for (int i = 0; i < ConsoleDumpCount; i++)
+      Serial.printf(" %s", ConsoleDumps[i].Name);
+    Serial.println();
+    return;
+  }
+
+  uint8_t Buffer[128];
+  uint32_t Length = ConsoleDumps[Source].Length();
+  uint32_t Crc = 0;
+
+  HoldLog(); // Until after the CRC
+  Serial.write((const uint8_t *)"GTEMDUMP", 8);
+  Serial.write((const uint8_t *)&Length, 4);
+  for (uint32_t Offset = 0; Offset < Length;)
+  {
+    size_t Read = ConsoleDumps[Source].Read(Offset, Buffer, min((uint32_t)sizeof(Buffer), Length - Offset));
+    if (Read == 0)
+    {
+      memset(Buffer, 0, sizeof(Buffer)); // Source shrank.  Pad, so the length stays true.
+      Read = min((uint32_t)sizeof(Buffer), Length - Offset);
+    }
+    Crc = crc32_le(Crc, Buffer, Read);
+    Serial.write(Buffer, Read);
+    Offset += Read;
+  }
+  Serial.write((const uint8_t *)&Crc, 4);
+  ReleaseLog();
+  Serial.println();
+}
+
+// Register Image Dump Source.  Address and value (little endian) of each register shown by 'regs'.
+uint32_t RegisterDumpLength()
+{
+  return ConsoleRegisterCount * 3;
+}
+
+size_t RegisterDumpRead(uint32_t Offset, uint8_t *Buffer, size_t Size)
+{
+  size_t Count = 0;
+  for (; Count + 3 <= Size && Offset + Count < RegisterDumpLength(); Count += 3)
+  {
+    const RegisterInfo &Info = ATM90E26Registers[ConsoleRegisterList[(Offset + Count) / 3]];
+    uint16_t Value = ConsoleEnergyIC != NULL ? ConsoleEnergyIC->GetRegister(Info.Address) : 0;
+    Buffer[Count] = Info.Address;
+    Buffer[Count + 1] = Value & 0xFF;
+    Buffer[Count + 2] = Value >> 8;
+  }
+  return Count;
+}
+
+// help
+void ConsoleHelp(char *Args)
+{
+  Serial.println("get [name]            Show Settings");
+  Serial.println("set <name> <value>    Change and save a Setting");
+  Serial.println("regs                  ATM90E26 Registers");
+  Serial.println("stats                 Statistics and Histograms");
+  Serial.println("dump <source>         Binary Dump");
+  for (int i = 0; i < ConsoleCommandCount; i++)
+    Serial.printf("%-21s %s\n", ConsoleCommands[i].Name, ConsoleCommands[i].Help);
+}
+
+// Run one Command Line
+void ConsoleExecute(char *Line)
+{
+  while (*Line == ' ')
+    Line++;
+  if (*Line == 0)
+    return;
+
+  char *Args = strchr(Line, ' ');
+  if (Args != NULL)
+  {
+    *Args++ = 0;
+    while (*Args == ' ')
+      Args++;
+  }
+  else
+    Args = Line + strlen(Line);
+
+  if (strcasecmp(Line, "help") == 0)
+    ConsoleHelp(Args);
+  else if (strcasecmp(Line, "get") == 0)
+    ConsoleGet(Args);
+  else if (strcasecmp(Line, "set") == 0)
+    ConsoleSet(Args);
+  else if (strcasecmp(Line, "regs") == 0)
+    ConsoleRegisters(Args);
+  else if (strcasecmp(Line, "stats") == 0)
+    ConsoleStatistics(Args);
+  else if (strcasecmp(Line, "dump") == 0)
+    ConsoleBinaryDump(Args);
+  else
+  {
+    for (int i = 0; i < ConsoleCommandCount; i++)
+    {
+      if (strcasecmp(Line, ConsoleCommands[i].Name) == 0)
+      {
+        ConsoleCommands[i].Handler(Args);
+        return;
+      }
+    }
+    Serial.printf("Unknown Command '%s'.  Type 'help'\n", Line);
+  }
+}
+
+// Console Job.  Collects whatever has arrived, and runs each complete line.
+void ConsoleJob()
+{
+  while (Serial.available() > 0)
+  {
+    char c = Serial.read();
+
+    if (c == '\r' || c == '\n')
+    {
+      if (ConsoleOverflow)
+        Serial.println("Command Too Long");
+      else if (ConsoleLength > 0)
+      {
+        SerialOut.flush(); // Finish any buffered report first, so it and the command's output never interleave
+        ConsoleLine[ConsoleLength] = 0;
+        Serial.printf("> %s\n", ConsoleLine);
+        ConsoleExecute(ConsoleLine);
+      }
+      ConsoleLength = 0;
+      ConsoleOverflow = false;
+    }
+    else if (c == '\b' || c == 0x7F)
+    {
+      if (ConsoleLength > 0)
+        ConsoleLength--;
+    }
+    else if (ConsoleLength < ConsoleLineSize - 1)
+      ConsoleLine[ConsoleLength++] = c;
+    else
+      ConsoleOverflow = true;
+  }
+}
+
+// Initialise Console
+void InitialiseConsole(ATM90E26_SPI &ic)
+{
+  ConsoleEnergyIC = &ic;
+  for (int i = 0; i < ATM90E26RegisterCount; i++)
+  {
+    if (!(ATM90E26Registers[i].Flags & (REG_READCLEAR | REG_WRITEONLY)))
+      ConsoleRegisterList[ConsoleRegisterCount++] = i;
+  }
+  AddConsoleDump("regs", RegisterDumpLength, RegisterDumpRead);
+  AddJob("Console", ConsoleJob, ConsolePollTime);
+}
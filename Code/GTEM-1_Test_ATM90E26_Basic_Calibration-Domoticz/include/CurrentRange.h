@@ -0,0 +1,258 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+
+// Libraries
+#include <Arduino.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Current Range.  The L line PGA gain (MMode Lgain[2:0]) follows the Line Current, so small loads use more of the ADC range.
+// With the GTEM-1 12R burden, an SCT-013-000 (100 A : 50 mA) gives 600 mV at 100 A, the full scale at PGA x1.
+//   Normal - PGA as the Calibration Profile (x1), to 100 A.  The Calibration in use at boot.
+//   Low    - PGA x8, to 12.5 A.  IgainL / 8 and PL Constant x 8 keep Irms and Power in scale (Application Note 46102).
+// Low is entered once the Current has stayed below RangeLowEnter, and left on the first capture above RangeLowExit, so a
+// load step never stays clipped for more than one capture.  Each range has its own Calibration set (IgainL, Lgain, Lphi and
+// Offsets), written live with the calculated checksums in a few ms.  Captures while the new range settles are flagged
+// SNAP_RangeSwitch.  Small-Power Mode is not used here, as the ATM90E26 only provides it for Power Offset calibration.
+// Calibrate each range with 'range normal' or 'range low' first, then 'calibrate'.  'range auto' to switch again.
+boolean EnableCurrentRange = false; // Set to true to switch the PGA gain with the Line Current.  Default for a 12R burden.
+
+enum CurrentRangeId
+{
+  RANGE_Normal,
+  RANGE_Low,
+  RANGE_Count
+};
+
+const char *CurrentRangeName[RANGE_Count] = {"Normal", "Low"};
+
+const uint16_t RangeLowPGA = 0x2000;   // MMode Lgain[2:0] 001, x8
+const float RangeLowEnter = 4.0;       // A.  Below, for RangeLowEnterCount captures, switches to Low
+const int RangeLowEnterCount = 5;      // Captures
+const float RangeLowExit = 6.0;        // A.  Above switches back to Normal.  Half the Low full scale, for the crest factor
+const uint32_t RangeSettleTime = 1000; // ms.  Captures flagged after a switch, while the mean registers refill
+
+// Calibration Set of a Range
+struct CurrentRangeSet
+{
+  uint16_t MeteringMode;
+  uint32_t PLConstant;
+  uint16_t IGain;
+  uint16_t LGain;
+  uint16_t LPhi;
+  uint16_t IOffset;
+  uint16_t POffset;
+  uint16_t QOffset;
+};
+
+CurrentRangeSet RangeSets[RANGE_Count] = {};
+ATM90E26_SPI *RangeEnergyIC = NULL;
+volatile int CurrentRange = RANGE_Normal;
+int RangeBelowCount = 0;      // Captures below RangeLowEnter in a row
+uint32_t RangeSwitchTime = 0; // millis() of the last switch
+
+// Statistics
+uint32_t RangeSwitches[RANGE_Count] = {}; // Switches into each range
+uint32_t RangeFlagged = 0;                // Captures flagged SNAP_RangeSwitch
+uint32_t RangeSwitchMicros = 0;           // us to write the last Calibration set
+uint64_t RangeTime[RANGE_Count] = {};     // ms spent in each range
+uint32_t RangeLastCapture = 0;            // millis() of the previous capture
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// PGA gain of MMode Lgain[2:0]
+int RangePGAGain(uint16_t Mode)
+{
+  const int Gain[4] = {4, 8, 16, 24};
+  return Mode & 0x8000 ? 1 : Gain[(Mode >> 13) & 0x03];
+}
+
+// Calibration in use on the ATM90E26
+void ReadCurrentRangeSet(ATM90E26_SPI &ic, CurrentRangeSet &Set)
+{
+  Set.MeteringMode = ic.GetMModeStatus();
+  Set.PLConstant = ic.GetPLConstant();
+  Set.IGain = ic.GetIGain();
+  Set.LGain = ic.GetLGain();
+  Set.LPhi = ic.GetLPhi();
+  Set.IOffset = ic.GetIOffset();
+  Set.POffset = ic.GetPOffset();
+  Set.QOffset = ic.GetQOffset();
+}
+
+// Low set, from the Normal set and the saved Low Range Calibration
+void BuildLowRangeSet()
+{
+  const CurrentRangeSet &Normal = RangeSets[RANGE_Normal];
+  CurrentRangeSet &Low = RangeSets[RANGE_Low];
+  uint32_t LowGain = RangePGAGain(RangeLowPGA);
+  uint32_t NormalGain = RangePGAGain(Normal.MeteringMode);
+  const RangeCalibration &Saved = Config.LowRange;
+
+  // Integer, as the PL Constant is 32 bit
+  Low.MeteringMode = (Normal.MeteringMode & 0x1FFF) | RangeLowPGA;
+  Low.PLConstant = (uint32_t)min((uint64_t)Normal.PLConstant * LowGain / NormalGain, (uint64_t)0xFFFFFFFF);
+  if (Config.LowRangeSaved)
+  {
+    Low.IGain = Saved.IGain;
+    Low.LGain = Saved.LGain;
+    Low.LPhi = Saved.LPhi;
+    Low.IOffset = Saved.IOffset;
+    Low.POffset = Saved.POffset;
+    Low.QOffset = Saved.QOffset;
+  }
+  else
+  {
+    Low.IGain = (uint16_t)constrain((Normal.IGain * NormalGain + LowGain / 2) / LowGain, (uint32_t)1, (uint32_t)0xFFFF);
+    Low.LGain = Normal.LGain;
+    Low.LPhi = Normal.LPhi;
+    Low.IOffset = Normal.IOffset;
+    Low.POffset = Normal.POffset;
+    Low.QOffset = Normal.QOffset;
+  }
+}
+
+// Replace register values in an ATM90E26 Checksum.  The low byte is the sum of the block's bytes, modulo 256, and the high
+// byte their XOR, so the old bytes are taken out and the new put in, without the rest of the block.
+uint16_t RangeChecksumReplace(uint16_t Checksum, const uint16_t *From, const uint16_t *To, int Count)
+{
+  uint8_t Sum = Checksum & 0xFF;
+  uint8_t Xor = Checksum >> 8;
+  for (int i = 0; i < Count; i++)
+  {
+    Sum += (To[i] & 0xFF) + (To[i] >> 8) - (From[i] & 0xFF) - (From[i] >> 8);
+    Xor ^= (To[i] & 0xFF) ^ (To[i] >> 8) ^ (From[i] & 0xFF) ^ (From[i] >> 8);
+  }
+  return (uint16_t)Xor << 8 | Sum;
+}
+
+// CS2 of the Normal set, from the CS2 of the Low set in use.  Ugain and Uoffset are shared, so only IgainL and the
+// Offsets differ.  Saved to the EEPROM, so the boot Calibration passes its check.
+uint16_t NormalRangeCS2(ATM90E26_SPI &ic)
+{
+  const CurrentRangeSet &Normal = RangeSets[RANGE_Normal];
+  const CurrentRangeSet &Low = RangeSets[RANGE_Low];
+  const uint16_t From[4] = {Low.IGain, Low.IOffset, Low.POffset, Low.QOffset};
+  const uint16_t To[4] = {Normal.IGain, Normal.IOffset, Normal.POffset, Normal.QOffset};
+  return RangeChecksumReplace(ic.GetCS2Status(), From, To, 4);
+}
+
+// Write a Range's Calibration set live, with the calculated checksums.  The Sampler must not be capturing meanwhile.
+void ApplyCurrentRange(int Range)
+{
+  const CurrentRangeSet &Set = RangeSets[Range];
+  ATM90E26_SPI &ic = *RangeEnergyIC;
+  int64_t Start = esp_timer_get_time();
+
+  ic.SetMMode(Set.MeteringMode);
+  ic.SetPLConstant(Set.PLConstant);
+  ic.SetIGain(Set.IGain);
+  ic.SetLGain(Set.LGain);
+  ic.SetLPhi(Set.LPhi);
+  ic.SetIOffset(Set.IOffset);
+  ic.SetPOffset(Set.POffset);
+  ic.SetQOffset(Set.QOffset);
+  ic.ApplyMeteringCalibration();
+  ic.ApplyMeasurementCalibration();
+
+  RangeSwitchMicros = (uint32_t)(esp_timer_get_time() - Start);
+  RangeSwitchTime = millis();
+  RangeSwitches[Range]++;
+  RangeBelowCount = 0;
+  CurrentRange = Range;
+}
+
+// Check a raw capture against the Current Range, and switch with hysteresis.  Snapshot Range, runs in the Sampler Task.
+void CurrentRangeCapture(GTEM_Snapshot &snap)
+{
+  if (RangeLastCapture != 0)
+    RangeTime[CurrentRange] += snap.Timestamp - RangeLastCapture;
+  RangeLastCapture = snap.Timestamp;
+
+  snap.Range = CurrentRange;
+  if (RangeSwitchTime != 0 && snap.Timestamp - RangeSwitchTime < RangeSettleTime)
+  {
+    snap.Flags |= SNAP_RangeSwitch;
+    RangeFlagged++;
+    return;
+  }
+
+  if (EnableCurrentRange == false)
+    return;
+
+  if (CurrentRange == RANGE_Normal)
+  {
+    RangeBelowCount = snap.LineCurrent < RangeLowEnter ? RangeBelowCount + 1 : 0;
+    if (RangeBelowCount >= RangeLowEnterCount)
+      ApplyCurrentRange(RANGE_Low);
+  }
+  else if (snap.LineCurrent > RangeLowExit)
+    ApplyCurrentRange(RANGE_Normal);
+}
+
+// Fix the Range (RANGE_Normal or RANGE_Low), or -1 to switch automatically.  i.e. to calibrate a range.
+void SetCurrentRange(int Range)
+{
+  EnableCurrentRange = Range < 0;
+  if (Range < 0 || Range == CurrentRange)
+    return;
+
+  PauseSampler();
+  ApplyCurrentRange(Range);
+  ResumeSampler();
+  LogInfo("Current Range \t %s", CurrentRangeName[Range]);
+}
+
+// Calibration just saved (Calibration.h).  Keeps it as the set of the Range in use.  Returns true if the Low range.
+// LowRange is saved before LowRangeSaved, so a power cut between leaves the Low set following the Normal set.
+boolean SaveCurrentRangeSet(ATM90E26_SPI &ic)
+{
+  ReadCurrentRangeSet(ic, RangeSets[CurrentRange]);
+  if (CurrentRange == RANGE_Normal)
+  {
+    BuildLowRangeSet();
+    return false;
+  }
+
+  const CurrentRangeSet &Low = RangeSets[RANGE_Low];
+  Config.LowRange = {Low.IGain, Low.LGain, Low.LPhi, Low.IOffset, Low.POffset, Low.QOffset};
+  Config.LowRangeSaved = true;
+  SaveConfigField(&Config.LowRange, sizeof(RangeCalibration));
+  SaveConfigField(&Config.LowRangeSaved, sizeof(boolean));
+  return true;
+}
+
+// Initialise Current Range, once InitEnergyIC() has written the boot Calibration.  Start before the Sampler Task.
+void InitialiseCurrentRange(ATM90E26_SPI &ic)
+{
+  RangeEnergyIC = &ic;
+  ReadCurrentRangeSet(ic, RangeSets[RANGE_Normal]);
+  BuildLowRangeSet();
+  CurrentRange = RANGE_Normal;
+  SnapshotRange = CurrentRangeCapture;
+}
+
+// Display Current Range Statistics
+void DisplayCurrentRangeStatistics(Print &Out = Serial)
+{
+  Out.printf("Current Range \t\t\t%s (%s) | Switches %u | Flagged %u | Last Switch %u us\n", CurrentRangeName[CurrentRange],
+             EnableCurrentRange ? "Auto" : "Fixed", (unsigned)(RangeSwitches[RANGE_Normal] + RangeSwitches[RANGE_Low]), (unsigned)RangeFlagged,
+             (unsigned)RangeSwitchMicros);
+  for (int r = 0; r < RANGE_Count; r++)
+    Out.printf("Current Range %-6s \t\tPGA x%d | IgainL 0x%04X | PL 0x%08X | Lgain 0x%04X | Lphi 0x%04X | %.1f s\n", CurrentRangeName[r],
+               RangePGAGain(RangeSets[r].MeteringMode), RangeSets[r].IGain, (unsigned)RangeSets[r].PLConstant, RangeSets[r].LGain, RangeSets[r].LPhi,
+               RangeTime[r] / 1000.0);
+}
@@ -0,0 +1,76 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// Live Dashboard.  Gzip of web/dashboard.html, served from flash with Content-Encoding: gzip.
+// If the HTML is changed, regenerate with:  gzip -9 -n -c web/dashboard.html | xxd -i
+
+const uint8_t Dashboard_html_gz[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x55, 0x6d, 0x6f, 0xdb, 0x36,
+    0x10, 0xfe, 0xae, 0x5f, 0xc1, 0x39, 0x1f, 0x44, 0xcd, 0x96, 0x64, 0x05, 0x5d, 0x11, 0xe8, 0x0d,
+    0xe8, 0x9c, 0x64, 0x2f, 0x68, 0xd7, 0x02, 0xce, 0x5a, 0x0c, 0x45, 0x3f, 0xd0, 0xe2, 0x49, 0x26,
+    0x2c, 0x91, 0x2a, 0x49, 0xd9, 0x71, 0xbd, 0xfc, 0xf7, 0x1d, 0x2b, 0x67, 0x49, 0x0c, 0x2c, 0xc8,
+    0x3e, 0x48, 0x7c, 0xbb, 0x7b, 0xee, 0xee, 0xb9, 0xe3, 0x31, 0xff, 0xe1, 0xf2, 0xfd, 0xe2, 0xe6,
+    0xaf, 0x0f, 0x57, 0x64, 0x6d, 0xbb, 0xb6, 0xf4, 0xf2, 0xfb, 0x01, 0x18, 0xc7, 0xa1, 0x03, 0xcb,
+    0x48, 0xb5, 0x66, 0xda, 0x80, 0x2d, 0x26, 0x83, 0xad, 0xc3, 0x8b, 0xc9, 0xfd, 0xb6, 0x64, 0x1d,
+    0x14, 0x93, 0xad, 0x80, 0x5d, 0xaf, 0xb4, 0x9d, 0x90, 0x4a, 0x49, 0x0b, 0x12, 0xc5, 0x76, 0x82,
+    0xdb, 0x75, 0xc1, 0x61, 0x2b, 0x2a, 0x08, 0xbf, 0x2f, 0x66, 0x44, 0x48, 0x61, 0x05, 0x6b, 0x43,
+    0x53, 0xb1, 0x16, 0x8a, 0xc4, 0x81, 0x58, 0x61, 0x5b, 0x28, 0x7f, 0xb9, 0xb9, 0x7a, 0x47, 0xde,
+    0x8a, 0x2d, 0xe4, 0xf1, 0xb8, 0xe1, 0xe5, 0xc6, 0xee, 0xdd, 0xb8, 0x52, 0x7c, 0x7f, 0xa8, 0x11,
+    0x34, 0xac, 0x59, 0x27, 0xda, 0x7d, 0x6a, 0x98, 0x34, 0xa1, 0x01, 0x2d, 0xea, 0x6c, 0xc5, 0xaa,
+    0x4d, 0xa3, 0xd5, 0x20, 0x79, 0x7a, 0x96, 0x24, 0x49, 0x56, 0xa9, 0x56, 0xe9, 0xf4, 0x0c, 0x00,
+    0xb2, 0x8e, 0xe9, 0x46, 0xc8, 0x34, 0x81, 0xee, 0xce, 0x5b, 0x27, 0x23, 0x80, 0x11, 0xdf, 0x20,
+    0x4d, 0xa2, 0x73, 0xb7, 0x17, 0x35, 0x07, 0x2e, 0x4c, 0xdf, 0xb2, 0x7d, 0xda, 0x68, 0xc1, 0x33,
+    0xf7, 0x0b, 0x2d, 0x74, 0xb8, 0x63, 0x21, 0x44, 0xa0, 0xa1, 0x93, 0x26, 0xd5, 0xd0, 0x03, 0xb3,
+    0x94, 0x0d, 0x56, 0x85, 0xb5, 0x68, 0xdb, 0x59, 0x27, 0x64, 0xc7, 0x6e, 0x69, 0x32, 0x87, 0x6e,
+    0x96, 0xd4, 0x3a, 0x08, 0xb2, 0x86, 0xf5, 0x69, 0xf4, 0xd3, 0x77, 0xc8, 0xea, 0xf0, 0xd8, 0xa1,
+    0xf3, 0xf3, 0xf3, 0x6c, 0xa5, 0x34, 0x07, 0x1d, 0x6a, 0xc6, 0xc5, 0x60, 0xd2, 0xe8, 0x15, 0x74,
+    0x59, 0xcf, 0x38, 0x17, 0xb2, 0x49, 0xa3, 0xd7, 0xa3, 0x0e, 0x59, 0xfd, 0xeb, 0xc8, 0xaa, 0x55,
+    0xd5, 0x26, 0x7b, 0xec, 0xea, 0xc5, 0x51, 0xc6, 0xf4, 0x4c, 0x1e, 0x8e, 0xd1, 0x5d, 0x5c, 0x5c,
+    0x3c, 0x92, 0x19, 0x45, 0xce, 0x8c, 0x7d, 0xee, 0x38, 0x8f, 0x8f, 0x64, 0xe6, 0xf1, 0x31, 0xa3,
+    0x8e, 0x55, 0x97, 0xdf, 0x64, 0x64, 0xfe, 0x4a, 0x82, 0x6e, 0xf6, 0xe4, 0x9d, 0xc2, 0xfc, 0x28,
+    0x4d, 0xc2, 0x63, 0x2a, 0xf0, 0xd8, 0xcb, 0xb9, 0xd8, 0x92, 0xaa, 0x65, 0xc6, 0x14, 0x93, 0x66,
+    0xf2, 0x74, 0x5d, 0x4d, 0xca, 0xdc, 0xb9, 0x56, 0xbe, 0x15, 0x12, 0xc8, 0x47, 0xd5, 0x5a, 0xd6,
+    0x00, 0xa1, 0x1f, 0x03, 0x34, 0xe8, 0xb6, 0xf3, 0x15, 0x11, 0x1c, 0x8b, 0x63, 0x52, 0x86, 0x79,
+    0xbc, 0x2a, 0xf3, 0x18, 0x75, 0x9f, 0x43, 0x58, 0x0c, 0x5a, 0x63, 0xed, 0x10, 0xfa, 0xe6, 0x04,
+    0x41, 0xbc, 0x00, 0xe1, 0x4d, 0x65, 0xd1, 0x69, 0xf2, 0x41, 0xed, 0x40, 0x13, 0xfa, 0xe9, 0x04,
+    0xa1, 0x7f, 0x01, 0xc2, 0xb5, 0x86, 0xaf, 0x03, 0xc8, 0x6a, 0x4f, 0xe8, 0xaf, 0xdf, 0x4e, 0xf4,
+    0xeb, 0x17, 0xe8, 0x8f, 0xa6, 0xaf, 0x59, 0x85, 0x1c, 0x9e, 0x58, 0x7f, 0x89, 0xfa, 0x72, 0x6f,
+    0x96, 0x96, 0xd9, 0xc1, 0x90, 0x18, 0x13, 0x32, 0x4e, 0x9f, 0xc2, 0x18, 0x73, 0x02, 0x73, 0x1c,
+    0xfa, 0xf1, 0xd4, 0x4e, 0xca, 0x85, 0x92, 0x12, 0x90, 0x08, 0xd9, 0x44, 0x51, 0x94, 0xc7, 0xbd,
+    0xbb, 0x47, 0x95, 0x16, 0xbd, 0x2d, 0xbd, 0x2d, 0xd3, 0xc4, 0x14, 0x87, 0xbb, 0x99, 0x2c, 0xe6,
+    0x33, 0x3b, 0x2f, 0x2e, 0xb1, 0xd0, 0x23, 0xa9, 0x76, 0x34, 0xc8, 0xbc, 0x7a, 0x90, 0xa8, 0xa4,
+    0x24, 0x59, 0xd3, 0xdb, 0xe0, 0xa0, 0xc1, 0x0e, 0x5a, 0x12, 0xea, 0xcf, 0xe7, 0x73, 0x7f, 0x4a,
+    0x6f, 0xcb, 0xb2, 0x9c, 0x07, 0x91, 0x55, 0x4b, 0xab, 0x11, 0x98, 0x26, 0xaf, 0xdd, 0xe2, 0xcf,
+    0xbe, 0x07, 0xbd, 0x60, 0x06, 0x68, 0x10, 0x44, 0xa6, 0xc5, 0x4b, 0x4e, 0xc3, 0x57, 0xc1, 0xdd,
+    0x03, 0x94, 0x59, 0x3b, 0xec, 0x83, 0x57, 0x2b, 0x4d, 0x9d, 0xed, 0x0d, 0x51, 0x35, 0xf9, 0xec,
+    0x6f, 0xfd, 0x99, 0x2f, 0xf0, 0xeb, 0xf1, 0xab, 0xdd, 0x58, 0xfb, 0x5f, 0x02, 0x51, 0xd3, 0x0d,
+    0x36, 0x07, 0x62, 0x02, 0xae, 0xaa, 0xa1, 0xc3, 0x1a, 0x88, 0x1a, 0xb0, 0x57, 0x2d, 0xb8, 0xe9,
+    0xcf, 0xfb, 0xdf, 0x38, 0xdd, 0xa0, 0x4d, 0xb8, 0xb5, 0x8b, 0x63, 0x77, 0x31, 0x9f, 0x37, 0x5f,
+    0x32, 0x0f, 0xd5, 0x7c, 0x63, 0xfc, 0xe7, 0x35, 0x9d, 0xc4, 0x53, 0xe5, 0x35, 0x35, 0x91, 0x31,
+    0xc1, 0xd4, 0x47, 0xa2, 0xfd, 0xa9, 0x5b, 0x75, 0x06, 0x49, 0x78, 0xe4, 0x7b, 0xa3, 0x9c, 0xe7,
+    0xce, 0xeb, 0x5d, 0x21, 0x61, 0x47, 0x3e, 0xc1, 0x6a, 0x89, 0x77, 0x13, 0x2c, 0xf5, 0x77, 0x26,
+    0x8d, 0x63, 0x7f, 0x8a, 0x57, 0x95, 0x39, 0xd1, 0x68, 0xad, 0x8c, 0x9d, 0xfa, 0xf1, 0x0e, 0x8d,
+    0x64, 0xde, 0x2e, 0x52, 0xb2, 0x03, 0x63, 0xf0, 0x1a, 0x14, 0xf7, 0x60, 0x14, 0x82, 0x83, 0x43,
+    0xe2, 0xc5, 0xef, 0xcb, 0xf7, 0x7f, 0x44, 0xbd, 0xeb, 0xa2, 0x14, 0x22, 0xce, 0x2c, 0x0b, 0xb2,
+    0x07, 0x72, 0x30, 0x06, 0x1e, 0xb8, 0xb0, 0x0a, 0xee, 0x62, 0x93, 0xd3, 0x69, 0x36, 0x32, 0x98,
+    0x79, 0xff, 0x1d, 0x99, 0x3d, 0x89, 0xcc, 0xbf, 0xd6, 0xd8, 0x8e, 0x31, 0x28, 0x13, 0x49, 0x0c,
+    0xef, 0x6f, 0x9c, 0x51, 0xf9, 0x63, 0x82, 0x79, 0x8c, 0xe9, 0x43, 0xbe, 0x43, 0x3b, 0x0f, 0x5c,
+    0x0a, 0xaf, 0xc5, 0x2d, 0x70, 0x9a, 0x38, 0x22, 0xea, 0xde, 0xf8, 0xd9, 0xdd, 0x18, 0x40, 0xd5,
+    0x2a, 0xf3, 0xc8, 0xfd, 0xe0, 0xf0, 0x3f, 0xec, 0x5f, 0x0a, 0x53, 0x8d, 0x25, 0x08, 0xdc, 0xcf,
+    0xf0, 0xb9, 0xb8, 0x11, 0x1d, 0xa8, 0xc1, 0xd2, 0x46, 0xcd, 0xce, 0xd1, 0x8d, 0xc0, 0x19, 0xb9,
+    0xf3, 0x1c, 0xbf, 0x99, 0x6b, 0x4b, 0xc7, 0xda, 0xc4, 0x9a, 0x1e, 0x1b, 0x52, 0x3c, 0x3e, 0x3c,
+    0xff, 0x00, 0xbd, 0xdc, 0xce, 0x97, 0x90, 0x06, 0x00, 0x00,
+};
+
+const size_t Dashboard_html_gz_len = sizeof(Dashboard_html_gz);
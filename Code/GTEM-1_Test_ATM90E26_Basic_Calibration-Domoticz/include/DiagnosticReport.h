@@ -0,0 +1,391 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <Arduino.h>
+#include <rom/crc.h> // ESP32 ROM CRC32
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Diagnostic Report.  CaptureReport() reads each register once, in one pass, into a DiagnosticReport.  A Report Renderer
+// then turns it into text (the tab aligned report), JSON or a compact binary record, into any Print (normally SerialOut),
+// so the capture is not held up by the UART, and the renderers never touch the ATM90E26.
+const int ReportRegistersMax = 16;
+
+struct ReportRegister
+{
+  uint8_t Index;  // Into ATM90E26Registers
+  uint16_t Value; // Raw
+};
+
+struct DiagnosticReport
+{
+  uint64_t ChipId;                              // ESP32 eFuse MAC
+  char Version[24];                             // Firmware Version
+  uint32_t Timestamp;                           // millis() at capture
+  boolean BasicInfo;                            // Restricted report.  No Register block or Checksums
+  boolean Filtered;                             // Measurements from the Snapshot Pipeline, not direct reads
+  boolean Sensors;                              // DC Voltage and Temperature present (DisableHardwareTest)
+  int RegisterCount;                            // REG_REPORT Registers captured
+  ReportRegister Registers[ReportRegistersMax]; // Table order
+  uint16_t CS1Status;                           // Checksum 1 written
+  uint16_t CS1Calculated;                       // Checksum 1 calculated by the ATM90E26
+  uint16_t CS2Status;                           // Checksum 2 written
+  uint16_t CS2Calculated;                       // Checksum 2 calculated by the ATM90E26
+  uint16_t LSBStatus;                           // LSB RMS/Power
+  float LineVoltage;                            // V
+  float LineCurrent;                            // A
+  float LineFrequency;                          // Hz
+  float ActivePower;                            // W.  Positive Import, Negative Export
+  float ImportPower;                            // W
+  float ExportPower;                            // W
+  float PowerFactor;                            // -1 to 1
+  float ImportEnergy;                           // kWh.  Since boot
+  float ExportEnergy;                           // kWh.  Since boot
+  float AbsActiveEnergy;                        // kWh
+  float AbsReactiveEnergy;                      // kvarh
+  float ReactiveFwdEnergy;                      // kvarh
+  float DCVoltage;                              // V.  DCV_IN
+  float TemperatureC;                           // ºC.  NTC_IN
+};
+
+DiagnosticReport Report = {}; // Last captured
+
+// Report Renderers.  Selected by name ('report json').
+typedef void (*ReportRenderer)(const DiagnosticReport &r, Print &Out);
+
+struct ReportFormat
+{
+  const char *Name;
+  ReportRenderer Render;
+};
+
+// Binary Report.  Little endian, packed.
+//   0 "GTRP", 4 uint16 record length, 6 uint8 format (1), 7 uint8 flags (1 BasicInfo, 2 Filtered, 4 Sensors),
+//   8 uint64 ChipId, 16 uint32 Timestamp, 20 char[24] Version, 44 uint16 CS1Status, CS1Calculated, CS2Status, CS2Calculated, LSBStatus,
+//   54 float32 x 14 (LineVoltage to TemperatureC, in DiagnosticReport order), 110 uint8 register count, then per register
+//   uint8 address and uint16 value, then uint32 CRC32 of all before.
+const uint8_t ReportBinaryFormat = 1;
+const size_t ReportBinaryMax = 111 + ReportRegistersMax * 3 + 4;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Capture the ATM90E26 part of a Report.  The caller fills in Sensors, DCVoltage and TemperatureC.
+void CaptureReport(ATM90E26_SPI &ic, DiagnosticReport &r, const char *Version)
+{
+  r.ChipId = ESP.getEfuseMac();
+  snprintf(r.Version, sizeof(r.Version), "%s", Version);
+  r.Timestamp = millis();
+  r.BasicInfo = Config.EnableBasicInfo;
+  r.RegisterCount = 0;
+
+  if (r.BasicInfo == false)
+  {
+    // Status and Calibration Registers, per the Register Table
+    for (int i = 0; i < ATM90E26RegisterCount && r.RegisterCount < ReportRegistersMax; i++)
+    {
+      if (ATM90E26Registers[i].Flags & REG_REPORT)
+        r.Registers[r.RegisterCount++] = {(uint8_t)i, ic.GetRegister(ATM90E26Registers[i].Address)};
+    }
+
+    r.CS1Status = ic.GetCS1Status();
+    r.CS1Calculated = ic.GetCS1Calculated();
+    r.CS2Status = ic.GetCS2Status();
+    r.CS2Calculated = ic.GetCS2Calculated();
+  }
+
+  // Filtered values from the Sampler, when running.  Otherwise direct reads.
+  GTEM_Snapshot Filtered;
+  r.Filtered = (Config.EnableAveraging == true && SnapshotTaskHandle != NULL);
+  if (r.Filtered)
+  {
+    GetLatestSnapshot(Filtered);
+    r.LineVoltage = Filtered.LineVoltage;
+    r.LineCurrent = Filtered.LineCurrent;
+    r.LineFrequency = Filtered.LineFrequency;
+    r.ActivePower = Filtered.ActivePower;
+    r.PowerFactor = Filtered.PowerFactor;
+  }
+  else
+  {
+    r.LineVoltage = ic.GetLineVoltage();
+    r.LineCurrent = ic.GetLineCurrent();
+    r.LineFrequency = ic.GetFrequency();
+    r.ActivePower = ic.GetActivePower();
+    r.PowerFactor = ic.GetPowerFactor();
+  }
+  r.ImportPower = r.ActivePower > 0 ? r.ActivePower : 0;
+  r.ExportPower = r.ActivePower < 0 ? -r.ActivePower : 0;
+
+  // Energy totals, as the Snapshot.  Without the Sampler, the registers are read into the totals first.
+  if (SnapshotTaskHandle == NULL)
+  {
+    ic.GetImportEnergy();
+    ic.GetExportEnergy();
+  }
+  r.ImportEnergy = ic.GetImportEnergyTotal();
+  r.ExportEnergy = ic.GetExportEnergyTotal();
+  r.AbsActiveEnergy = ic.GetAbsActiveEnergy();
+  r.AbsReactiveEnergy = ic.GetAbsReactiveEnergy();
+  r.ReactiveFwdEnergy = ic.GetReactivefwdEnergy();
+  r.LSBStatus = ic.GetLSBStatus();
+}
+
+// One Register as text, per the Register Table.  Measurements in their Unit, others in hex and binary, with any
+// Bitfield value names and known value notes.
+void RenderRegisterText(const RegisterInfo &Info, uint16_t Value, Print &Out)
+{
+  char Label[24];
+  snprintf(Label, sizeof(Label), "(%s 0x%02X):", Info.Name, Info.Address);
+  Out.printf("%-32s%-24s", Info.Description, Label);
+
+  if (Info.Scale > 0)
+  {
+    Out.printf("%.*f %s\n", RegisterDecimals(Info.Scale), RegisterDecode(Info, Value), Info.Unit);
+    return;
+  }
+
+  Out.printf("0x%04X ", Value);
+  if (Info.FieldCount > 0)
+  {
+    char Binary[18];
+    for (int b = 0; b < 16; b++)
+      Binary[b] = Value & (0x8000 >> b) ? '1' : '0';
+    Binary[16] = ' ';
+    Binary[17] = 0;
+    Out.print(Binary);
+  }
+
+  for (int f = 0; f < Info.FieldCount; f++)
+  {
+    const char *Name = Info.Fields[f].Values[RegisterFieldValue(Info.Fields[f], Value)];
+    if (Name != NULL)
+      Out.printf("%s.%s ", Info.Fields[f].Name, Name);
+  }
+
+  const char *Note = RegisterNoteText(Info, Value);
+  if (Note != NULL)
+    Out.printf(">ATM 0x%02X - %s", Info.Address, Note);
+  else if (Info.NoteCount > 0 && Info.FieldCount == 0)
+    Out.printf(">ATM 0x%02X - Unknown Value", Info.Address);
+  Out.println();
+}
+
+// Text Report.  The tab aligned Diagnostic Report, followed by the live module statistics.
+void RenderReportText(const DiagnosticReport &r, Print &Out)
+{
+  // Header
+  Out.println("GTEM-1 ATM90E26 Energy Monitoring Energy Monitor");
+  Out.println("Register Status and Diagnostic Report");
+  Out.printf("ESP32 Serial ID = %04X%08X   Firmware Version = %s\n\n", (uint16_t)(r.ChipId >> 32), (uint32_t)r.ChipId, r.Version);
+
+  if (r.BasicInfo == false) // Restrict displayed information if EnableBasicInfo is true
+  {
+    Out.println("Register Name\t\t\tVar/Address\t\tValue / Binary / Information");
+    Out.println("------------ \t\t\t-----------\t\t--------------------------------------------------------");
+
+    for (int i = 0; i < r.RegisterCount; i++)
+      RenderRegisterText(ATM90E26Registers[r.Registers[i].Index], r.Registers[i].Value, Out);
+
+    Out.printf("Checksum Status \t\t(CS1 0x2C):\t\t0x%04X ", r.CS1Status);
+    if (r.CS1Status != r.CS1Calculated)
+      Out.printf("*ERROR: Please update _crc1 to ATM Calculated CRC: 0x%X", r.CS1Calculated);
+    Out.println();
+
+    Out.printf("Checksum Status \t\t(CS2 0x3B):\t\t0x%04X ", r.CS2Status);
+    if (r.CS2Status != r.CS2Calculated)
+      Out.printf("*ERROR: Please update _crc2 to ATM Calculated CRC: 0x%X", r.CS2Calculated);
+    Out.println();
+
+    Out.println("-----------");
+  }
+
+  Out.printf("Line Voltage \t\t\t(Urms 0x49):\t\t%.2f V\n", r.LineVoltage);
+  Out.printf("Line Current \t\t\t(Irms 0x48):\t\t%.2f A\n", r.LineCurrent);
+  Out.printf("Line Frequency \t\t\t(Freq 0x4C):\t\t%.2f Hz\n", r.LineFrequency);
+  Out.printf("Active Power \t\t\t(Pmean 0x4A):\t\t%.2f W\n", r.ActivePower);
+  Out.printf("Import Power \t\t\t(Pmean 0x4A +):\t\t%.2f W\n", r.ImportPower);
+  Out.printf("Export Power \t\t\t(Pmean 0x4A -):\t\t%.2f W\n", r.ExportPower);
+  Out.println("-----------");
+  Out.printf("Import Energy Total \t\t(APenergy 0x40):\t%.2f\n", r.ImportEnergy);
+  Out.printf("Export Energy Total \t\t(ANenergy 0x41):\t%.2f\n", r.ExportEnergy);
+  Out.printf("Power Factor \t\t\t(PowerF 0x4D):\t\t%.2f\n", r.PowerFactor);
+  Out.println("-----------");
+  Out.printf("Abs Active Energy \t\t(ATenergy 0x42):\t%.2f\n", r.AbsActiveEnergy);
+  Out.printf("Abs Reactive Energy \t\t(Rtenergy 0x45):\t%.2f\n", r.AbsReactiveEnergy);
+  Out.printf("Abs Reactive Forward Energy \t(RPenergy 0x43):\t%.2f\n", r.ReactiveFwdEnergy);
+  RenderRegisterText(ATM90E26Registers[RegisterIndex(LSB)], r.LSBStatus, Out);
+
+  // Rolling Statistics
+  if (EnableStatistics == true)
+  {
+    Out.println("-----------");
+    DisplayStatistics(Out);
+  }
+
+  // Filter Settings
+  if (EnableFilters == true && r.BasicInfo == false)
+  {
+    Out.println("-----------");
+    DisplayFilters(Out);
+  }
+
+  // Latency Histograms
+  if (r.BasicInfo == false)
+  {
+    Out.println("-----------");
+    DisplayLatencyStatistics(Out);
+    DisplayLoggerStatistics(Out);
+  }
+
+  // Scheduler
+  if (SchedulerJobCount > 0)
+  {
+    Out.println("-----------");
+    DisplaySchedulerStatistics(Out);
+  }
+
+  // ATM90E26 Health Check
+  if (EnableHealthCheck == true && r.BasicInfo == false)
+  {
+    Out.println("-----------");
+    DisplayHealthStatistics(Out);
+  }
+
+  // Snapshot Pipeline
+  if (SnapshotTaskHandle != NULL && r.BasicInfo == false)
+  {
+    Out.println("-----------");
+    DisplayPipelineStatistics(Out);
+  }
+
+  // Adaptive Sampling
+  if (EnableAdaptiveRate == true && SnapshotTaskHandle != NULL && r.BasicInfo == false)
+  {
+    Out.println("-----------");
+    DisplayAdaptiveRateStatistics(Out);
+  }
+
+  // Other GTEM Sensors.  ESP32 ADC 12-Bit SAR, calibrate as needed.
+  Out.println("-----------");
+
+  if (r.Sensors == true)
+  {
+    Out.printf("DC Voltage Sensor \t\t(DCV_IN VP):\t\t%.2f", r.DCVoltage);
+    if (r.DCVoltage < 5)
+      Out.print(" V USB Powered.  Note - Not all ATM functions will work in this mode");
+    if (r.DCVoltage > 5)
+      Out.print(" V AC/DC Input");
+    if (r.DCVoltage > 20)
+      Out.print(" V *WARNING: Please Check Input Voltage.  Too High!");
+    Out.println();
+
+    Out.printf("PCB Temperature Sensor\t\t(NTC_IN VN):\t\t%.2f ºC\n", r.TemperatureC);
+
+    if (EnableAnalogSampler == true && r.BasicInfo == false)
+      DisplayAnalogStatistics(Out);
+
+    Out.println("\n");
+
+    if (Config.EnableDomoticz == false)
+      Out.println("Set EnableDomoticz to true ('set domoticz true'), to enable Domoticz Publishing");
+
+    if (EnableInfluxDB == true)
+      DisplayInfluxStatistics(Out);
+
+    if (EnableModbus == true)
+      DisplayModbusStatistics(Out);
+  }
+}
+
+// JSON Report.  Captured values only.
+// {"chip":"...","version":"...","t":1234,"basic":false,"filtered":true,"regs":{"SysStatus":"0x0000",...},"cs1":"0xAE70","cs1_calc":"0xAE70",...}
+void RenderReportJSON(const DiagnosticReport &r, Print &Out)
+{
+  Out.printf("{\"chip\":\"%04X%08X\",\"version\":\"%s\",\"t\":%u,\"basic\":%s,\"filtered\":%s", (uint16_t)(r.ChipId >> 32), (uint32_t)r.ChipId,
+             r.Version, (unsigned)r.Timestamp, r.BasicInfo ? "true" : "false", r.Filtered ? "true" : "false");
+
+  if (r.BasicInfo == false)
+  {
+    Out.print(",\"regs\":{");
+    for (int i = 0; i < r.RegisterCount; i++)
+      Out.printf("%s\"%s\":\"0x%04X\"", i ? "," : "", ATM90E26Registers[r.Registers[i].Index].Name, r.Registers[i].Value);
+    Out.printf("},\"cs1\":\"0x%04X\",\"cs1_calc\":\"0x%04X\",\"cs2\":\"0x%04X\",\"cs2_calc\":\"0x%04X\"", r.CS1Status, r.CS1Calculated, r.CS2Status,
+               r.CS2Calculated);
+  }
+
+  Out.printf(",\"v\":%.2f,\"i\":%.3f,\"hz\":%.2f,\"p\":%.2f,\"import_w\":%.2f,\"export_w\":%.2f,\"pf\":%.3f", r.LineVoltage, r.LineCurrent,
+             r.LineFrequency, r.ActivePower, r.ImportPower, r.ExportPower, r.PowerFactor);
+  Out.printf(",\"import_kwh\":%.4f,\"export_kwh\":%.4f,\"abs_active_kwh\":%.4f,\"abs_reactive_kvarh\":%.4f,\"reactive_fwd_kvarh\":%.4f,\"lsb\":\"0x%04X\"",
+             r.ImportEnergy, r.ExportEnergy, r.AbsActiveEnergy, r.AbsReactiveEnergy, r.ReactiveFwdEnergy, r.LSBStatus);
+
+  if (r.Sensors == true)
+    Out.printf(",\"dcv\":%.2f,\"temp_c\":%.2f", r.DCVoltage, r.TemperatureC);
+  Out.println("}");
+}
+
+// Pack a Report as a Binary Report.  Returns the length.  Buffer must hold ReportBinaryMax.
+size_t PackReport(const DiagnosticReport &r, uint8_t *Buffer)
+{
+  const float Values[14] = {r.LineVoltage,  r.LineCurrent,  r.LineFrequency,   r.ActivePower,     r.ImportPower,       r.ExportPower, r.PowerFactor,
+                            r.ImportEnergy, r.ExportEnergy, r.AbsActiveEnergy, r.AbsReactiveEnergy, r.ReactiveFwdEnergy, r.DCVoltage,  r.TemperatureC};
+  const uint16_t Status[5] = {r.CS1Status, r.CS1Calculated, r.CS2Status, r.CS2Calculated, r.LSBStatus};
+  uint16_t Length = 111 + r.RegisterCount * 3 + 4;
+
+  memset(Buffer, 0, 111);
+  memcpy(Buffer, "GTRP", 4);
+  memcpy(Buffer + 4, &Length, 2);
+  Buffer[6] = ReportBinaryFormat;
+  Buffer[7] = (r.BasicInfo ? 1 : 0) | (r.Filtered ? 2 : 0) | (r.Sensors ? 4 : 0);
+  memcpy(Buffer + 8, &r.ChipId, 8);
+  memcpy(Buffer + 16, &r.Timestamp, 4);
+  strncpy((char *)Buffer + 20, r.Version, 24);
+  memcpy(Buffer + 44, Status, sizeof(Status));
+  memcpy(Buffer + 54, Values, sizeof(Values));
+  Buffer[110] = r.RegisterCount;
+
+  uint8_t *p = Buffer + 111;
+  for (int i = 0; i < r.RegisterCount; i++)
+  {
+    *p++ = ATM90E26Registers[r.Registers[i].Index].Address;
+    *p++ = r.Registers[i].Value & 0xFF;
+    *p++ = r.Registers[i].Value >> 8;
+  }
+
+  uint32_t Crc = crc32_le(0, Buffer, p - Buffer);
+  memcpy(p, &Crc, 4);
+  return Length;
+}
+
+// Binary Report
+void RenderReportBinary(const DiagnosticReport &r, Print &Out)
+{
+  uint8_t Buffer[ReportBinaryMax];
+  Out.write(Buffer, PackReport(r, Buffer));
+}
+
+const ReportFormat ReportFormats[] = {{"text", RenderReportText}, {"json", RenderReportJSON}, {"binary", RenderReportBinary}};
+const int ReportFormatCount = sizeof(ReportFormats) / sizeof(ReportFormat);
+
+// Find a Report Format by name.  NULL if unknown.
+const ReportFormat *FindReportFormat(const char *Name)
+{
+  for (int i = 0; i < ReportFormatCount; i++)
+  {
+    if (strcasecmp(ReportFormats[i].Name, Name) == 0)
+      return &ReportFormats[i];
+  }
+  return NULL;
+}
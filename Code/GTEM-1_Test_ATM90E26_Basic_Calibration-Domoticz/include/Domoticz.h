@@ -17,90 +17,125 @@
 
 // ****************  VARIABLES / DEFINES / STATIC / STRUCTURES ****************
 
-// WiFi.  Setup with your Wireless Information
-const char *ssid = "xxxx";      // network SSID - Case Sensitive
-const char *password = "xxxx"; // network password - Case Sensitive
+// WiFi.  SSID and password are in Config (ConfigStore.h)
 WiFiClient client;                  // Initialize the client library
 String HostNameHeader = "GTEM-";    // Hostname Prefix
 
-// Domoticz Server info.  Setup with your Domoticz IP and Port
-const char *domoticz_server = "0.0.0.0"; // IP Address
-int port = 8080;                              // Domoticz port
-boolean EnableDomoticz = false; // Change to true to enable read Loop and sending data to Domoticz.
-
-// Set these values to the Domoticz Devices Indexes (IDX).  If Zero, then entry is ignored. Device needs to be created in Domoticz.
-int LineVoltage = 34;    // Urms - Line Voltage RMS
-int LineCurrent = 35;    // Irms - Line Current RMS
-int ActivePower = 37;    // Pmean - Line Mean Active Power
-int ImportPower = 38;    // Pmean - Line Mean Active Import Power
-int ExportPower = 39;    // Pmean - Line Mean Active Export Power
-int LineFrequency = 36;   // Freq - Line Voltage Frequency
-int ImportEnergy = 40;    // APenergy - Forward Active Energy
-int ExportEnergy = 41;    // ANenergy - Reverse Active Energy
-int PowerFactor = 44;     // PowerF - Line Power Factor
-int DCVoltage = 0;      // PCB DC Input (Derived from AC)
-int PCBTemperature = 43; // PCB NTC
+// Domoticz Server, Port, EnableDomoticz and Device Indexes (IDX) are in Config (ConfigStore.h)
 
 // Set this value to the Domoticz Device Group Index (IDX) - Note: Currently Unused Virtual Device.
 int DomoticzBaseIndex = 0; // If Zero, then entry is ignored.  Group device needs to be created in Domoticz. WIP.
 
+// Reconnect.  Once the Scheduler runs, WiFi and the Domoticz Server are retried from the Publish Job with a doubling
+// backoff, never with delay(), so the LEDs, Console and other Jobs keep their times while either is away.
+const uint32_t WiFiConnectTimeout = 10000;    // ms.  Wait after WiFi.begin() before beginning again.  Doubles to the max
+const uint32_t DomoticzBackoffMin = 2000;     // ms.  Wait after the first failed connect to the Domoticz Server
+const uint32_t DomoticzBackoffMax = 60000;    // ms.  Doubling stops here
+const int32_t DomoticzConnectTimeout = 1000;  // ms.  One connect attempt.  Default is 3 s
+
+struct LinkRetry
+{
+    uint32_t Backoff; // ms until the next attempt.  0 when connected
+    uint32_t Next;    // millis() of the next attempt
+};
+
+LinkRetry WiFiRetry = {};
+LinkRetry DomoticzRetry = {};
+
 // ######### FUNCTIONS #########
 
-// Initialise WiFi
+// True when a Link is not waiting out its backoff
+boolean LinkDue(const LinkRetry &Retry)
+{
+    return Retry.Backoff == 0 || (int32_t)(millis() - Retry.Next) >= 0;
+}
+
+// Wait longer before the next attempt
+void LinkFailed(LinkRetry &Retry, uint32_t BackoffMin)
+{
+    Retry.Backoff = Retry.Backoff == 0 ? BackoffMin : min(Retry.Backoff * 2, DomoticzBackoffMax);
+    Retry.Next = millis() + Retry.Backoff;
+}
+
+// Start connecting to WiFi.  Does not wait.
+void BeginWiFi()
+{
+    LogInfo("Attempting to connect to %s", Config.WiFiSSID);
+
+    // Force Hostname
+    String Hostname = HostNameHeader;
+    Hostname.concat(WiFi.macAddress().substring(WiFi.macAddress().length() - 5, WiFi.macAddress().length()));
+    Hostname.replace(":", "");
+    WiFi.setHostname(Hostname.c_str());
+
+    // Wifi Settings and Initialisation
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    WiFi.persistent(true);
+    WiFi.begin(Config.WiFiSSID, Config.WiFiPassword);
+}
+
+// Wifi Information
+void LogWiFiDetails()
+{
+    LogInfo("Connection Details:");
+    LogInfo("WiFi SSID \t %s(Wifi Station Mode)", Config.WiFiSSID);
+    LogInfo("WiFi IP \t %s", WiFi.localIP().toString());
+    LogInfo("WiFi GW \t %s", WiFi.gatewayIP().toString());
+    LogInfo("WiFi MASK \t %s", WiFi.subnetMask().toString());
+    LogInfo("WiFi MAC \t %s", WiFi.macAddress());
+    LogInfo("WiFi Hostname \t %s", WiFi.getHostname());
+    LogInfo("WiFi RSSI \t %d\n", WiFi.RSSI());
+}
+
+// Initialise WiFi.  At boot only, before the Scheduler runs.  Jobs use ReconnectWiFi().
 void InitialiseWiFi()
 {
     // Connect or reconnect to WiFi
     if (WiFi.status() != WL_CONNECTED)
     {
-        Serial.println("Attempting to connect to " + String(ssid));
-
-        // Force Hostname
-        String Hostname = HostNameHeader;
-        Hostname.concat(WiFi.macAddress().substring(WiFi.macAddress().length() - 5, WiFi.macAddress().length()));
-        Hostname.replace(":", "");
-        WiFi.setHostname(Hostname.c_str());
-
-        // Wifi Initialisation
-        WiFi.begin(ssid, password);
+        LATENCY_SCOPE(LAT_WiFiConnect);
+        BeginWiFi();
 
         // Stabalise for slow Access Points
-        delay(2000);
+        delay(3000);
 
-        // Wifi Settings
-        WiFi.mode(WIFI_STA);
-        WiFi.setAutoReconnect(true);
-        WiFi.persistent(true);
+        LogWiFiDetails();
+    }
+}
 
-        // Stabalise for slow Access Points
-        delay(1000);
-
-        // Wifi Information
-        Serial.println("Connection Details:");
-        Serial.println("WiFi SSID \t " + String(ssid) + "(Wifi Station Mode)");
-        Serial.printf("WiFi IP \t %s\n", WiFi.localIP().toString().c_str());
-        Serial.printf("WiFi GW \t %s\n", WiFi.gatewayIP().toString().c_str());
-        Serial.printf("WiFi MASK \t %s\n", WiFi.subnetMask().toString().c_str());
-        Serial.println("WiFi MAC \t " + WiFi.macAddress());
-        Serial.printf("WiFi Hostname \t %s\n", WiFi.getHostname());
-        Serial.println("WiFi RSSI \t " + String(WiFi.RSSI()));
-        Serial.println("");
+// Reconnect WiFi without waiting.  Returns true when connected.  While not, WiFi.begin() is repeated with a doubling backoff.
+boolean ReconnectWiFi()
+{
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        if (WiFiRetry.Backoff != 0)
+        {
+            WiFiRetry.Backoff = 0;
+            LogWiFiDetails();
+        }
+        return true;
     }
+
+    if (LinkDue(WiFiRetry))
+    {
+        BeginWiFi();
+        LinkFailed(WiFiRetry, WiFiConnectTimeout); // Cleared when the connection comes up
+    }
+    return false;
 }
 
 // Publish to Domoticz - Single Values
 void PublishDomoticz(int Sensor_Index, float Sensor_Value, String Sensor_Name = "")
 {
 
-    if (Sensor_Index > 0)
+    if (Sensor_Index > 0 && LinkDue(DomoticzRetry))
     {
-        if (client.connect(domoticz_server, port))
+        LATENCY_SCOPE(LAT_Domoticz);
+        if (client.connect(Config.DomoticzServer, Config.DomoticzPort, DomoticzConnectTimeout))
         {
-            Serial.print("Sending Message to Domoticz #");
-            Serial.print(Sensor_Index);
-            Serial.print(" ");
-            Serial.print(Sensor_Value);
-            Serial.print(" \t");
-            Serial.println(Sensor_Name);
+            DomoticzRetry.Backoff = 0;
+            LogInfo("Sending Message to Domoticz #%d %.2f \t%s", Sensor_Index, Sensor_Value, Sensor_Name);
 
             client.print("GET /json.htm?type=command&param=udevice&idx=");
             client.print(Sensor_Index);
@@ -110,10 +145,10 @@ void PublishDomoticz(int Sensor_Index, float Sensor_Value, String Sensor_Name =
 
             client.println(" HTTP/1.1");
             client.print("Host: ");
-            client.print(domoticz_server);
+            client.print(Config.DomoticzServer);
             client.print(":");
 
-            client.println(port);
+            client.println(Config.DomoticzPort);
             client.println("User-Agent: Arduino-ethernet");
             client.println("Connection: close");
             client.println();
@@ -122,11 +157,9 @@ void PublishDomoticz(int Sensor_Index, float Sensor_Value, String Sensor_Name =
         }
         else
         {
-            Serial.println("WiFi or Domoticz Server Not Connected");
-
-            // Stabalise for slow Access Points
-            delay(2000);
-            InitialiseWiFi();
+            // Skip publishes until the backoff ends, rather than waiting here
+            LinkFailed(DomoticzRetry, DomoticzBackoffMin);
+            LogWarn("WiFi or Domoticz Server Not Connected.  Retry in %u ms", (unsigned)DomoticzRetry.Backoff);
         }
     }
 }
@@ -136,43 +169,44 @@ void PublishDomoticz(int Sensor_Index, float Sensor_Value, String Sensor_Name =
 // Publish to Domoticz EXAMPLE - Batch or Group Values Example to Virtual Sensor.  Update as needed.  Future WIP Option.
 void PublishDomoticzATM(int Sensor_Index)
 {
-    if (Sensor_Index > 0)
+    if (Sensor_Index > 0 && LinkDue(DomoticzRetry))
     {
-        if (client.connect(domoticz_server, port))
+        LATENCY_SCOPE(LAT_Domoticz);
+        if (client.connect(Config.DomoticzServer, Config.DomoticzPort, DomoticzConnectTimeout))
         {
-            Serial.print("Sending ATM Group Message to Domoticz #");
-            Serial.print(Sensor_Index);
+            DomoticzRetry.Backoff = 0;
+            LogInfo("Sending ATM Group Message to Domoticz #%d", Sensor_Index);
 
             client.print("GET /json.htm?type=command&param=udevice&idx=");
             client.print(Sensor_Index);
 
             // Potential values to select from and batch post to a single sensor
             client.print("&svalue=");
-            client.print(String(LineVoltage));
+            client.print(String(Config.Idx.LineVoltage));
             client.print(";");
-            client.print(String(LineCurrent));
+            client.print(String(Config.Idx.LineCurrent));
             client.print(";0;");
-            client.print(String(LineFrequency));
+            client.print(String(Config.Idx.LineFrequency));
             client.print(";0;");
-            client.print(String(ActivePower));
+            client.print(String(Config.Idx.ActivePower));
             client.print(";0;");
-            client.print(String(ImportEnergy));
+            client.print(String(Config.Idx.ImportEnergy));
             client.print(";0;");
-            client.print(String(ExportEnergy));
+            client.print(String(Config.Idx.ExportEnergy));
             client.print(";0;");
-            client.print(String(PowerFactor));
+            client.print(String(Config.Idx.PowerFactor));
             client.print(";0;");
-            client.print(String(DCVoltage));
+            client.print(String(Config.Idx.DCVoltage));
             client.print(";0;");
-            client.print(String(PCBTemperature));
+            client.print(String(Config.Idx.PCBTemperature));
             client.print(";0");
 
             client.println(" HTTP/1.1");
             client.print("Host: ");
-            client.print(domoticz_server);
+            client.print(Config.DomoticzServer);
             client.print(":");
 
-            client.println(port);
+            client.println(Config.DomoticzPort);
             client.println("User-Agent: Arduino-ethernet");
             client.println("Connection: close");
             client.println();
@@ -181,8 +215,8 @@ void PublishDomoticzATM(int Sensor_Index)
         }
         else
         {
-            Serial.println("Not Connected");
-            InitialiseWiFi();
+            LinkFailed(DomoticzRetry, DomoticzBackoffMin);
+            LogWarn("Not Connected.  Retry in %u ms", (unsigned)DomoticzRetry.Backoff);
         }
     }
 }
@@ -0,0 +1,227 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+
+// Libraries
+#include <Arduino.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Energy Direction.  The ATM90E26 sets SysStatus RevPchg the moment active energy changes direction (import to export, or
+// back), if FuncEn RevPEn is set, and asserts its IRQ pin.  The IRQ edge is timestamped in an ISR, which wakes the Direction
+// Task.  That reads SysStatus to decode the event, then a fresh power snapshot (Urms, Irms, Pmean, PowerF and EnStatus), and
+// passes the DirectionEvent to the Direction Listeners, i.e. diversion logic, rather than waiting for the next poll.
+// The Direction is EnStatus RevP, the direction of the last CF1 pulse.  Latency from the edge is kept in us per event.
+// SysStatus clears on read, and the Sampler reads it too, so the event bits are latched by the driver (TakeStatusEvents()).
+// The WarnOut pin only reports checksum errors and voltage sag, so the IRQ pin (ATM_IRQ) is used.
+boolean EnableDirectionEvents = false; // Set to true to enable the Energy Direction Change IRQ
+
+enum EnergyDirectionId
+{
+  DIR_Import,
+  DIR_Export,
+  DIR_Count
+};
+
+const char *EnergyDirectionName[DIR_Count] = {"Import", "Export"};
+
+// Direction Change Event
+struct DirectionEvent
+{
+  uint32_t Sequence;        // Incremented on every event
+  uint32_t Timestamp;       // millis() at the IRQ edge
+  int64_t EdgeTime;         // esp_timer_get_time() at the IRQ edge (us)
+  uint32_t DecodeLatency;   // us from the edge to SysStatus decoded
+  uint32_t SnapshotLatency; // us from the edge to the power snapshot read
+  uint16_t SystemStatus;    // SysStatus event bits (STATUS_)
+  uint16_t MeterStatus;     // EnStatus 0x46
+  uint8_t Direction;        // EnergyDirectionId, from EnStatus RevP
+  float LineVoltage;        // Urms (V)
+  float LineCurrent;        // Irms (A)
+  float ActivePower;        // Pmean (W).  Positive Import, Negative Export
+  float PowerFactor;        // PowerF
+};
+
+// Direction Listeners.  Called from the Direction Task on every event, so must be quick and never block.
+typedef void (*DirectionListener)(const DirectionEvent &event);
+const int DirectionListenersMax = 4;
+DirectionListener DirectionListeners[DirectionListenersMax];
+int DirectionListenerCount = 0;
+
+const int DirectionHistoryMax = 8; // Last events kept for the console
+
+DirectionEvent DirectionHistory[DirectionHistoryMax] = {};
+uint32_t DirectionEventCount = 0;                         // Events, also the next Sequence
+portMUX_TYPE DirectionMux = portMUX_INITIALIZER_UNLOCKED; // Guards the edge and DirectionHistory between the ISR and tasks
+TaskHandle_t DirectionTaskHandle = NULL;
+int DirectionIRQPin = -1;
+
+// IRQ Edge, from the ISR
+uint32_t DirectionEdgeCycles = 0; // ESP.getCycleCount()
+int64_t DirectionEdgeTime = 0;    // esp_timer_get_time()
+uint32_t DirectionEdgeMillis = 0;
+BaseType_t DirectionEdgeCore = 0;
+
+// Statistics
+volatile uint32_t DirectionEdges = 0; // IRQ edges
+uint32_t DirectionOther = 0;          // Edges for another event (Sag, Reactive or Line change) only
+uint32_t DirectionSpurious = 0;       // Edges with no event latched
+uint32_t DirectionLatencyMax = 0;     // us, edge to snapshot
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// IRQ Edge.  Timestamp and wake the Direction Task.
+void IRAM_ATTR DirectionISR()
+{
+  BaseType_t Woken = pdFALSE;
+
+  portENTER_CRITICAL_ISR(&DirectionMux);
+  DirectionEdgeCycles = ESP.getCycleCount();
+  DirectionEdgeTime = esp_timer_get_time();
+  DirectionEdgeMillis = millis();
+  DirectionEdgeCore = xPortGetCoreID();
+  portEXIT_CRITICAL_ISR(&DirectionMux);
+  DirectionEdges++;
+
+  vTaskNotifyGiveFromISR(DirectionTaskHandle, &Woken);
+  portYIELD_FROM_ISR(Woken);
+}
+
+// Register a Listener, before InitialiseDirectionEvents()
+void AddDirectionListener(DirectionListener listener)
+{
+  if (DirectionListenerCount < DirectionListenersMax)
+    DirectionListeners[DirectionListenerCount++] = listener;
+}
+
+// Copy of the Last event.  Returns false if none yet.
+boolean GetLastDirectionEvent(DirectionEvent &Event)
+{
+  portENTER_CRITICAL(&DirectionMux);
+  boolean Found = DirectionEventCount > 0;
+  if (Found)
+    Event = DirectionHistory[(DirectionEventCount - 1) % DirectionHistoryMax];
+  portEXIT_CRITICAL(&DirectionMux);
+  return Found;
+}
+
+// Decode an IRQ edge against SysStatus, and if the active energy direction changed, take the power snapshot
+void HandleDirectionEdge(ATM90E26_SPI &ic)
+{
+  DirectionEvent Event;
+
+  portENTER_CRITICAL(&DirectionMux);
+  uint32_t EdgeCycles = DirectionEdgeCycles;
+  BaseType_t EdgeCore = DirectionEdgeCore;
+  Event.EdgeTime = DirectionEdgeTime;
+  Event.Timestamp = DirectionEdgeMillis;
+  portEXIT_CRITICAL(&DirectionMux);
+
+  ic.GetSysStatus(); // Clears the IRQ.  Events the Sampler read first are latched in the driver
+  Event.SystemStatus = ic.TakeStatusEvents();
+  Event.DecodeLatency = (uint32_t)(esp_timer_get_time() - Event.EdgeTime);
+
+  if ((Event.SystemStatus & STATUS_RevPchg) == 0)
+  {
+    if (Event.SystemStatus == 0)
+      DirectionSpurious++;
+    else
+      DirectionOther++;
+    return;
+  }
+
+  Event.MeterStatus = ic.GetMeterStatus();
+  Event.ActivePower = ic.GetActivePower();
+  Event.LineCurrent = ic.GetLineCurrent();
+  Event.LineVoltage = ic.GetLineVoltage();
+  Event.PowerFactor = ic.GetPowerFactor();
+  Event.Direction = Event.MeterStatus & 0x1000 ? DIR_Export : DIR_Import;
+  Event.SnapshotLatency = (uint32_t)(esp_timer_get_time() - Event.EdgeTime);
+
+#if GTEM_INSTRUMENT
+  uint32_t Cycles = ESP.getCycleCount() - EdgeCycles;
+  if (xPortGetCoreID() == EdgeCore)
+    Latency[LAT_DirectionEvent].Record(Cycles);
+#endif
+
+  portENTER_CRITICAL(&DirectionMux);
+  Event.Sequence = DirectionEventCount;
+  DirectionHistory[DirectionEventCount % DirectionHistoryMax] = Event;
+  DirectionEventCount++;
+  portEXIT_CRITICAL(&DirectionMux);
+  DirectionLatencyMax = max(DirectionLatencyMax, Event.SnapshotLatency);
+
+  for (int i = 0; i < DirectionListenerCount; i++)
+    DirectionListeners[i](Event);
+
+  LogInfo("Energy Direction \t %s \t %.1f W \t %u us", EnergyDirectionName[Event.Direction], Event.ActivePower, (unsigned)Event.SnapshotLatency);
+}
+
+// Direction Task.  Core 1, priority 4, above the Sampler, so an event is read as soon as the IRQ is asserted.
+void DirectionTask(void *Param)
+{
+  ATM90E26_SPI &ic = *(ATM90E26_SPI *)Param;
+
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    HandleDirectionEdge(ic);
+  }
+}
+
+// Initialise Energy Direction Events, once InitEnergyIC() has run.  Enables RevPEn live, and keeps it for any Recover().
+void InitialiseDirectionEvents(ATM90E26_SPI &ic, int Pin)
+{
+  DirectionIRQPin = Pin;
+  pinMode(Pin, INPUT);
+
+  ic.SetFunctionEnable(ic.GetFunctionEnableSetting() | FUNC_RevPEn);
+  ic.ApplyFunctionEnable();
+  ic.GetSysStatus(); // Clear any event from boot, so the IRQ is idle
+  ic.TakeStatusEvents();
+
+  xTaskCreatePinnedToCore(DirectionTask, "Direction", 4096, &ic, 4, &DirectionTaskHandle, 1);
+  attachInterrupt(digitalPinToInterrupt(Pin), DirectionISR, RISING);
+
+  LogInfo("Energy Direction \t IRQ on GPIO %d", Pin);
+}
+
+// Display Energy Direction Statistics
+void DisplayDirectionStatistics(Print &Out = Serial)
+{
+  Out.printf("Energy Direction \t\t%s | Edges %u | Events %u | Other %u | Spurious %u | Max %u us\n",
+             DirectionTaskHandle != NULL ? "IRQ" : "Off", (unsigned)DirectionEdges, (unsigned)DirectionEventCount, (unsigned)DirectionOther,
+             (unsigned)DirectionSpurious, (unsigned)DirectionLatencyMax);
+}
+
+// Display the Last events, oldest first
+void DisplayDirectionEvents(Print &Out = Serial)
+{
+  DisplayDirectionStatistics(Out);
+
+  uint32_t Count = DirectionEventCount;
+  uint32_t First = Count > DirectionHistoryMax ? Count - DirectionHistoryMax : 0;
+  for (uint32_t s = First; s < Count; s++)
+  {
+    DirectionEvent Event;
+    portENTER_CRITICAL(&DirectionMux);
+    Event = DirectionHistory[s % DirectionHistoryMax];
+    portEXIT_CRITICAL(&DirectionMux);
+
+    Out.printf("#%-4u %10.3f s \t%s \t%.2f V \t%.3f A \t%.1f W \tPF %.2f \tDecode %u us | Snapshot %u us\n", (unsigned)Event.Sequence,
+               Event.Timestamp / 1000.0, EnergyDirectionName[Event.Direction], Event.LineVoltage, Event.LineCurrent, Event.ActivePower,
+               Event.PowerFactor, (unsigned)Event.DecodeLatency, (unsigned)Event.SnapshotLatency);
+  }
+}
@@ -0,0 +1,116 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// ATM90E26 Health Check.  Before every Snapshot capture (or each second, when the Snapshot Pipeline is not running), the status
+// is checked for a stuck bus, LastData must echo the Ugain read, and Ugain and the Checksum bits must be as written at init.
+// On a fault the capture is dropped, and the ATM90E26 is soft reset and its Register Defaults written again in place.
+// If that fails, the next attempt backs off, doubling each time.  The ESP32 is never restarted.
+boolean EnableHealthCheck = true; // Set to true to check the ATM90E26 on every Snapshot, and recover it in place
+
+const uint32_t HealthBackoffMin = 100;   // ms.  Wait after the first failed Recovery
+const uint32_t HealthBackoffMax = 60000; // ms.  Doubling stops here
+
+const char *HealthFaultName[FAULT_Count] = {"Stuck Bus", "Echo", "Checksum", "Config"};
+
+// Health State and Counters
+struct EnergyICHealth
+{
+  uint32_t Checks;              // Health Checks run
+  uint32_t Faulty;              // Checks with any fault
+  uint32_t Faults[FAULT_Count]; // Checks with each fault
+  uint32_t Recoveries;          // Recoveries attempted
+  uint32_t RecoveryFailures;    // Recoveries that left a fault
+  uint8_t LastFaults;           // ATM90E26Fault bits of the last faulty check
+  uint32_t LastFaultTime;       // millis() of the last faulty check
+  uint32_t LastRecoveryTime;    // millis() of the last good Recovery
+  uint32_t Backoff;             // ms between Recovery attempts.  0 when healthy
+  uint32_t NextRecovery;        // millis() of the next Recovery attempt
+};
+
+EnergyICHealth Health = {};
+portMUX_TYPE HealthMux = portMUX_INITIALIZER_UNLOCKED;
+volatile boolean EnergyICFault = false; // Last check was faulty, and not yet recovered
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Health Check, and Recovery if due.  Returns true if healthy, so a capture may go ahead.
+boolean CheckEnergyIC(ATM90E26_SPI &ic)
+{
+  uint8_t Faults = ic.CheckHealth();
+  uint32_t Now = millis();
+
+  portENTER_CRITICAL(&HealthMux);
+  Health.Checks++;
+  if (Faults != 0)
+  {
+    Health.Faulty++;
+    for (int f = 0; f < FAULT_Count; f++)
+      if (Faults & (1 << f))
+        Health.Faults[f]++;
+    Health.LastFaults = Faults;
+    Health.LastFaultTime = Now;
+  }
+  else
+    Health.Backoff = 0;
+  boolean Due = Health.Backoff == 0 || (int32_t)(Now - Health.NextRecovery) >= 0;
+  portEXIT_CRITICAL(&HealthMux);
+
+  EnergyICFault = Faults != 0;
+  if (Faults == 0 || !Due)
+    return Faults == 0;
+
+  // Recover in place
+  uint8_t Remaining;
+  {
+    LATENCY_SCOPE(LAT_RecoverEnergyIC);
+    Remaining = ic.Recover();
+  }
+
+  portENTER_CRITICAL(&HealthMux);
+  Health.Recoveries++;
+  if (Remaining != 0)
+  {
+    Health.RecoveryFailures++;
+    Health.Backoff = Health.Backoff == 0 ? HealthBackoffMin : min(Health.Backoff * 2, HealthBackoffMax);
+    Health.NextRecovery = Now + Health.Backoff;
+  }
+  else
+  {
+    Health.Backoff = 0;
+    Health.LastRecoveryTime = Now;
+  }
+  portEXIT_CRITICAL(&HealthMux);
+
+  EnergyICFault = Remaining != 0;
+  return false; // Dropped either way.  The Energy registers were read faulty, or cleared by the soft reset
+}
+
+// Display Health Check Counters
+void DisplayHealthStatistics(Print &Out = Serial)
+{
+  portENTER_CRITICAL(&HealthMux);
+  EnergyICHealth h = Health;
+  portEXIT_CRITICAL(&HealthMux);
+
+  Out.printf("ATM90E26 Health \t\t%s | Checks %u | Faulty %u | Recoveries %u | Failed %u\n", EnergyICFault ? "FAULT" : "OK",
+                (unsigned)h.Checks, (unsigned)h.Faulty, (unsigned)h.Recoveries, (unsigned)h.RecoveryFailures);
+  for (int f = 0; f < FAULT_Count; f++)
+    Out.printf("Health Fault %-10s \t%u\n", HealthFaultName[f], (unsigned)h.Faults[f]);
+  if (h.Faulty > 0)
+    Out.printf("Last Fault \t\t\t0x%02X %u s ago | Last Recovery %u s ago | Backoff %u ms\n", h.LastFaults, (unsigned)((millis() - h.LastFaultTime) / 1000),
+                  (unsigned)((millis() - h.LastRecoveryTime) / 1000), (unsigned)h.Backoff);
+}
@@ -0,0 +1,165 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Filter Pipeline.  Each Snapshot value passes, in order, through:
+//   Median    - Median of the last N samples.  A single spike is rejected rather than averaged in.
+//   EMA       - Exponential Moving Average.  Output += Alpha * (Input - Output).
+//   Deadzone  - Values nearer zero than Deadzone read zero.  Once zeroed, the value must pass Deadzone + Hysteresis
+//               to read again, so a reading sat on the threshold does not flicker.
+// Filters run in the Processor Task, so every output sees the same filtered values.
+boolean EnableFilters = true; // Set to true to filter Snapshot values
+
+// Settings (FilterConfig) are in Config.Filters, one per Statistics Metric.  Defaults in ConfigStore.h.
+static_assert(CONFIG_FILTERS == STATS_Metrics, "One Filter per Statistics Metric");
+
+struct FilterState
+{
+  float Window[FILTER_MEDIAN_MAX]; // Last samples, ring
+  uint8_t Count;                   // Samples in Window
+  uint8_t Index;                   // Next ring position
+  float Ema;
+  boolean Primed; // Ema holds a value
+  boolean Zeroed; // In the Deadzone
+};
+
+FilterState FilterStates[STATS_Metrics];
+uint32_t FilterGeneration = 0; // Changed by SetFilter()
+portMUX_TYPE FiltersMux = portMUX_INITIALIZER_UNLOCKED;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Median of the Window.  Insertion sort of a copy, at most FILTER_MEDIAN_MAX values.
+float FilterMedian(const FilterState &State)
+{
+  float Sorted[FILTER_MEDIAN_MAX];
+  int n = State.Count;
+
+  for (int i = 0; i < n; i++)
+  {
+    float Value = State.Window[i];
+    int j = i;
+    while (j > 0 && Sorted[j - 1] > Value)
+    {
+      Sorted[j] = Sorted[j - 1];
+      j--;
+    }
+    Sorted[j] = Value;
+  }
+
+  if (n % 2)
+    return Sorted[n / 2];
+  return (Sorted[n / 2 - 1] + Sorted[n / 2]) / 2;
+}
+
+// Pass one Value through a Filter chain
+float FilterApply(const FilterConfig &Config, FilterState &State, float Value)
+{
+  // Median
+  if (Config.Median > 1)
+  {
+    int Size = min((int)Config.Median, FILTER_MEDIAN_MAX);
+    State.Window[State.Index] = Value;
+    State.Index = (State.Index + 1) % Size;
+    if (State.Count < Size)
+      State.Count++;
+    Value = FilterMedian(State);
+  }
+
+  // EMA
+  if (Config.Alpha < 1.0)
+  {
+    if (!State.Primed)
+      State.Ema = Value;
+    else
+      State.Ema += Config.Alpha * (Value - State.Ema);
+    State.Primed = true;
+    Value = State.Ema;
+  }
+
+  // Deadzone with Hysteresis
+  if (Config.Deadzone > 0)
+  {
+    float Magnitude = fabsf(Value);
+    if (State.Zeroed)
+      State.Zeroed = Magnitude < Config.Deadzone + Config.Hysteresis;
+    else
+      State.Zeroed = Magnitude < Config.Deadzone;
+    if (State.Zeroed)
+      Value = 0;
+  }
+
+  return Value;
+}
+
+// Filter a Snapshot in place.  Snapshot Filter, runs in the Processor Task.
+// Settings and State are copied under the lock and filtered outside it, so interrupts are only held off for the copies.
+// A capture flagged SNAP_RangeSwitch is filtered, but its State is not kept, so the transient does not stay in the history.
+void FilterSnapshot(GTEM_Snapshot &snap)
+{
+  float *Values[STATS_Metrics] = {&snap.LineVoltage, &snap.LineCurrent, &snap.ActivePower, &snap.LineFrequency, &snap.PowerFactor};
+  FilterConfig Configs[STATS_Metrics];
+  FilterState States[STATS_Metrics];
+  uint32_t Generation;
+
+  portENTER_CRITICAL(&FiltersMux);
+  memcpy(Configs, Config.Filters, sizeof(Configs));
+  memcpy(States, FilterStates, sizeof(States));
+  Generation = FilterGeneration;
+  portEXIT_CRITICAL(&FiltersMux);
+
+  for (int m = 0; m < STATS_Metrics; m++)
+    *Values[m] = FilterApply(Configs[m], States[m], *Values[m]);
+
+  // State back, unless a Filter was changed meanwhile.  Its cleared history is then kept.
+  portENTER_CRITICAL(&FiltersMux);
+  if (Generation == FilterGeneration && !(snap.Flags & SNAP_RangeSwitch))
+    memcpy(FilterStates, States, sizeof(States));
+  portEXIT_CRITICAL(&FiltersMux);
+}
+
+// Change a Metric's Filter, and save it.  Its history is cleared.
+void SetFilter(int Metric, uint8_t Median, float Alpha, float Deadzone, float Hysteresis)
+{
+  if (Metric < 0 || Metric >= STATS_Metrics)
+    return;
+
+  FilterConfig &Filter = Config.Filters[Metric];
+  portENTER_CRITICAL(&FiltersMux);
+  Filter.Median = constrain(Median, (uint8_t)1, (uint8_t)FILTER_MEDIAN_MAX);
+  Filter.Alpha = constrain(Alpha, 0.01f, 1.0f);
+  Filter.Deadzone = fabsf(Deadzone);
+  Filter.Hysteresis = fabsf(Hysteresis);
+  memset(&FilterStates[Metric], 0, sizeof(FilterState));
+  FilterGeneration++;
+  portEXIT_CRITICAL(&FiltersMux);
+
+  SaveConfigField(&Filter, sizeof(FilterConfig));
+}
+
+// Initialise Filters.  Start before the Sampler Task.
+void InitialiseFilters()
+{
+  memset(FilterStates, 0, sizeof(FilterStates));
+  SnapshotFilter = FilterSnapshot;
+}
+
+// Display Filter Settings
+void DisplayFilters(Print &Out = Serial)
+{
+  Out.println("Filters \t\t\tMedian\tEMA\tDeadzone\tHysteresis");
+  for (int m = 0; m < STATS_Metrics; m++)
+    Out.printf("%-16s \t\t%d\t%.2f\t%.3f\t\t%.3f\n", StatsMetricName[m], Config.Filters[m].Median, Config.Filters[m].Alpha, Config.Filters[m].Deadzone, Config.Filters[m].Hysteresis);
+}
@@ -23,87 +23,39 @@ boolean CRCErrorFlag = false; // Updated to true if CRC error
 
 // Calibration Defaults.  If updated, CRC is autocalculated upon boot and re-read from EEPROM.
 // Simply use XLS to approxi,ate calculate UGAIN and IGAIN.  Enter below and 'Upload'.  CRC will auto calcualte.
+// Or calibrate on the board with 'calibrate <volts> <amps>' (Calibration.h).  The gains saved in the Config are then used instead.
 // Remember that the mains voltage continuously changes slightly!  You will see this when monitoring.
 // NB. Testing was done with a pure sinewave inverter (TLC SK 652100) to give constant 230v and a Resistive fixed load.
 // If the current clamp is correctly placed and current reduces on load - simply reverse the transformer AC in!
-ATM90E26_SPI::ATM90E26_SPI(int pin)
+// Register Defaults not listed here are the ATM90E26_Profile values, in Code/lib/ATM90E26/src/ATM90E26.h
+struct GTEM_Calibration : ATM90E26_Profile
 {
-  _cs = pin;
-  _lgain = 0x1D39; // PL CONSTANT.  Use XLS to calculate these values. Examples: 0x1D39;
-  _ugain = 0x9F62; // VOLTAGE RMS Gain.  Use XLS to calculate these values. Examples: 8V 0xA028 | 12V 0x9F9A or 0x9E38
-  _igain = 0xDF36; // CURRENT RMS GAIN. Use XLS to calculate these values. Examples: 0x7160; 0x9897; 0x8DF2;
-}
+  static constexpr unsigned short LineGain = 0x1D39;    // PL CONSTANT.  Use XLS to calculate these values. Examples: 0x1D39;
+  static constexpr unsigned short VoltageGain = 0x9F62; // VOLTAGE RMS Gain.  Use XLS to calculate these values. Examples: 8V 0xA028 | 12V 0x9F9A or 0x9E38
+  static constexpr unsigned short CurrentGain = 0xDF36; // CURRENT RMS GAIN. Use XLS to calculate these values. Examples: 0x7160; 0x9897; 0x8DF2;
 
-// Register Defaults
-void ATM90E26_SPI::InitEnergyIC()
-{
-
-  // Auto Calculated CRC and Restored from EEPROM.  If CRC Error - EEPROM is updated, ESP32 and ATM90E26 Restarted.
-  _crc1 = readEEPROM16(0x1C);
-  _crc2 = readEEPROM16(0x1E);
-
-  // unsigned short systemstatus;
-  pinMode(_cs, OUTPUT);
-
-  /* Enable SPI */
-  SPI.begin();
-  SPI.setBitOrder(MSBFIRST);
-  SPI.setDataMode(SPI_MODE3);
-  SPI.setClockDivider(SPI_CLOCK_DIV16);
-
-  CommEnergyIC(0, SoftReset, 0x789A); // Perform soft reset
-
-  CommEnergyIC(0, FuncEn, 0x0030); // Voltage sag irq=1, report on warnout pin=1, energy dir change irq=0
-  CommEnergyIC(0, SagTh, 0x17DD);  // Voltage sag threshhold 0x1F2F
-
-  // Set metering calibration values
-  // CommEnergyIC(0, CalStart, 0x8765);  // RUNNING Metering calibration startup command. Register 21 to 2B need to be set
-  CommEnergyIC(0, CalStart, 0x5678); // CAL Metering calibration startup command. Register 21 to 2B need to be set
-
-  // Configure
-  CommEnergyIC(0, MMode, 0x9422); // Metering Mode Configuration. All defaults. See pg 31 of datasheet.
-
-  CommEnergyIC(0, PLconstH, 0x05CD); // PL Constant MSB 0x21 0x0525
-  CommEnergyIC(0, PLconstL, 0xBB1C); // PL Constant LSB 0x22 0xFCB2
-
-  CommEnergyIC(0, Lgain, _lgain);    // Line calibration gain 0x1D39
-  CommEnergyIC(0, Lphi, 0x0000);     // Line calibration angle
-  CommEnergyIC(0, PStartTh, 0x08BD); // Active Startup Power Threshold
-  CommEnergyIC(0, PNolTh, 0x0000);   // Active No-Load Power Threshold
-  CommEnergyIC(0, QStartTh, 0x0AEC); // Reactive Startup Power Threshold
-  CommEnergyIC(0, QNolTh, 0x0000);   // Reactive No-Load Power Threshold
-  CommEnergyIC(0, CSOne, _crc1);     // Write CSOne, as self calculated
-
-  // Set measurement calibration values
-  CommEnergyIC(0, AdjStart, 0x5678); // Measurement calibration startup command, registers 31-3A
-  CommEnergyIC(0, Ugain, _ugain);    // Voltage rms gain
-  CommEnergyIC(0, IgainL, _igain);   // L line current gain
-  CommEnergyIC(0, Uoffset, 0x0000);  // Voltage offset
-  CommEnergyIC(0, IoffsetL, 0x0000); // L line current offset
-  CommEnergyIC(0, PoffsetL, 0x0000); // L line active power offset
-  CommEnergyIC(0, QoffsetL, 0x0000); // L line reactive power offset
-  CommEnergyIC(0, CSTwo, _crc2);     // Write CSTwo, as self calculated
-
-  CommEnergyIC(0, CalStart, 0x8765); // Checks correctness of 21-2B registers and starts normal metering if ok
-  CommEnergyIC(0, AdjStart, 0x8765); // Checks correctness of 31-3A registers and starts normal measurement  if ok
-
-  Serial.println("");
-
-  // Upon CRC Error - Update EEPROM with New Values and Auto Reboot
-  if (GetSysStatus() & 0xC000 || GetSysStatus() & 0x3000)
+  // Auto Calculated CRC and Restored from EEPROM.
+  static void LoadChecksums(unsigned short &crc1, unsigned short &crc2)
   {
+    crc1 = readEEPROM16(0x1C);
+    crc2 = readEEPROM16(0x1E);
+  }
 
-    Serial.println("Updating CRC Values in EEPROM");
+  // Upon CRC Error - Update EEPROM with New Values, and write the Register Defaults again with them.  No reboot.
+  static bool ChecksumError(unsigned short status, unsigned short &crc1, unsigned short cs1, unsigned short &crc2, unsigned short cs2)
+  {
+    LogWarn("Updating CRC Values in EEPROM");
     CRCErrorFlag = true;
-    WriteEEPROM16(0x1C, CommEnergyIC(1, CSOne, 0x0000));
-    WriteEEPROM16(0x1E, CommEnergyIC(1, CSTwo, 0x0000));
+    WriteEEPROM16(0x1C, cs1);
+    WriteEEPROM16(0x1E, cs2);
+    crc1 = cs1;
+    crc2 = cs2;
     CRCErrorFlag = false;
-    
-    Serial.println("\n####### Automatically Rebooting ESP32 and ATM90E26 #######\n");
 
-    delay(3000);
-    ESP.restart();
+    LogWarn("Reinitialising ATM90E26");
+    return true;
   }
+};
 
-  Serial.println("");
-}
\ No newline at end of file
+// GTEM Energy IC.  CS pin, timed SPI Transport and the Calibration above
+typedef ATM90E26<energy_CS, GTEM_SPITransport, GTEM_Calibration> ATM90E26_SPI;
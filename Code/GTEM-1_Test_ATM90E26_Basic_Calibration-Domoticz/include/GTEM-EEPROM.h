@@ -25,6 +25,7 @@ serialEEPROM extEEPROM(0x50, 8192, 32); // Address, Size, PageSize
 // Read 8bit Value
 byte readEEPROM(unsigned int addEEPROM)
 {
+  LATENCY_SCOPE(LAT_EEPROMRead);
   uint8_t valEEPROM = 0x00;
   valEEPROM = extEEPROM.read(addEEPROM);
   return valEEPROM;
@@ -33,12 +34,14 @@ byte readEEPROM(unsigned int addEEPROM)
 // Write 8bit Value
 void WriteEEPROM(unsigned int addEEPROM, uint8_t valEEPROM)
 {
+  LATENCY_SCOPE(LAT_EEPROMWrite);
   extEEPROM.write(addEEPROM, valEEPROM);
 }
 
 // Read 16bit Value
 uint16_t readEEPROM16(unsigned int addEEPROM)
 {
+  LATENCY_SCOPE(LAT_EEPROMRead);
   uint16_t valEEPROM = 0x0000;
   valEEPROM = (extEEPROM.read(addEEPROM + 1) << 8);
   valEEPROM |= extEEPROM.read(addEEPROM);
@@ -48,10 +51,39 @@ uint16_t readEEPROM16(unsigned int addEEPROM)
 // Write 16bit Value
 void WriteEEPROM16(unsigned int addEEPROM, uint16_t valEEPROM)
 {
+  LATENCY_SCOPE(LAT_EEPROMWrite);
   extEEPROM.write(addEEPROM, valEEPROM);
   extEEPROM.write(addEEPROM + 1, valEEPROM >> 8);
 }
 
+// Read Block.  One sequential read, in I2C buffer sized chunks
+void readEEPROMBlock(unsigned int addEEPROM, uint8_t *Data, unsigned int Length)
+{
+  LATENCY_SCOPE(LAT_EEPROMRead);
+  while (Length > 0)
+  {
+    unsigned int Chunk = min(Length, 64U);
+    extEEPROM.read(addEEPROM, Data, Chunk);
+    addEEPROM += Chunk;
+    Data += Chunk;
+    Length -= Chunk;
+  }
+}
+
+// Write Block.  Split at the 32-byte page boundaries
+void WriteEEPROMBlock(unsigned int addEEPROM, const uint8_t *Data, unsigned int Length)
+{
+  LATENCY_SCOPE(LAT_EEPROMWrite);
+  while (Length > 0)
+  {
+    unsigned int Chunk = min(Length, 32 - addEEPROM % 32);
+    extEEPROM.write(addEEPROM, (uint8_t *)Data, Chunk);
+    addEEPROM += Chunk;
+    Data += Chunk;
+    Length -= Chunk;
+  }
+}
+
 // Clear EEPROM (Only if unlocked and fully clear, if Validation not correct or corruption)
 void ClearEEPROM()
 {
@@ -59,7 +91,7 @@ void ClearEEPROM()
   {
     if (extEEPROM.read(0) != 0x20) // Check Validation Byte - Future Use
     {
-      Serial.println("\nPreparing New EEPROM.  Please Wait...");
+      LogInfo("\nPreparing New EEPROM.  Please Wait...");
 
       for (int i = 0; i < 8192; i++)
       {
@@ -68,31 +100,34 @@ void ClearEEPROM()
     }
     else
     {
-      Serial.println("\nClearing EEPROM.  Please Wait...");
+      LogInfo("\nClearing EEPROM.  Please Wait...");
+      int Cleared = 0;
       for (int i = 1; i < 8192; i++)
       {
         if (extEEPROM.read(i) != 0x00) // Only Clear Used Bytes
         {
-          Serial.print(extEEPROM.read(i), HEX);
           extEEPROM.write(i, 0x00);
+          Cleared++;
         }
       }
+      LogInfo("EEPROM %d Used Bytes Cleared", Cleared);
     }
 
     WriteEEPROM(0x00, 0x20); // Write Status Byte
 
+    int NotClear = 0;
     for (int i = 1; i < 8192; i++)
     {
-      if (extEEPROM.read(i) != 0x00) // Only Clear Used Bytes
-      {
-        Serial.print(extEEPROM.read(i), HEX);
-      }
+      if (extEEPROM.read(i) != 0x00) // Check Cleared
+        NotClear++;
     }
+    if (NotClear > 0)
+      LogError("EEPROM %d Bytes Not Cleared.  Possible Hardware Issue?", NotClear);
 
-    Serial.println("\nEEPROM Ready\n");
+    LogInfo("\nEEPROM Ready\n");
   }
   else
-    Serial.println("\nEEPROM Locked");
+    LogInfo("\nEEPROM Locked");
 }
 
 // Initialize EEPROM
@@ -104,8 +139,5 @@ void InitializeEEPROM()
   if (extEEPROM.read(0) != 0x20)
     ClearEEPROM();
 
-  Serial.print("\nEEPROM Reading CRC1: ");
-  Serial.print(readEEPROM16(0x1C), HEX);
-  Serial.print("  CRC2: ");
-  Serial.println(readEEPROM16(0x1E), HEX);
+  LogInfo("\nEEPROM Reading CRC1: %X  CRC2: %X", readEEPROM16(0x1C), readEEPROM16(0x1E));
 }
@@ -0,0 +1,151 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// Libraries
+#include <rom/crc.h> // ESP32 ROM CRC32
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Small Gzip Compressor.  Single probe LZ77 with the fixed Huffman table (RFC 1951 / 1952).
+// Payloads such as InfluxDB line protocol repeat the same tags and field names on every line, so this is enough.
+#define GZIP_HASH_BITS 12 // 4096 entry hash table, 8 KB
+
+const uint16_t GzipLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t GzipLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t GzipDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t GzipDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+struct GzipWriter
+{
+  uint8_t *Out;     // Output buffer
+  size_t Size;      // Output buffer size
+  size_t Length;    // Bytes written
+  uint32_t Bits;    // Pending bits, LSB first
+  int Count;        // Number of pending bits
+  boolean Overflow; // Output did not fit
+};
+
+uint16_t GzipHash[1 << GZIP_HASH_BITS];
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Write Bits, LSB first
+void GzipPutBits(GzipWriter &w, uint32_t Value, int Bits)
+{
+  w.Bits |= Value << w.Count;
+  w.Count += Bits;
+  while (w.Count >= 8)
+  {
+    if (w.Length < w.Size)
+      w.Out[w.Length++] = w.Bits & 0xFF;
+    else
+      w.Overflow = true;
+    w.Bits >>= 8;
+    w.Count -= 8;
+  }
+}
+
+// Write Huffman Code, MSB first
+void GzipPutCode(GzipWriter &w, uint32_t Code, int Bits)
+{
+  uint32_t Reversed = 0;
+  for (int i = 0; i < Bits; i++)
+    Reversed |= ((Code >> i) & 1) << (Bits - 1 - i);
+  GzipPutBits(w, Reversed, Bits);
+}
+
+// Write Literal or Length Symbol from the Fixed Table
+void GzipPutSymbol(GzipWriter &w, int Symbol)
+{
+  if (Symbol < 144)
+    GzipPutCode(w, 0x30 + Symbol, 8);
+  else if (Symbol < 256)
+    GzipPutCode(w, 0x190 + Symbol - 144, 9);
+  else if (Symbol < 280)
+    GzipPutCode(w, Symbol - 256, 7);
+  else
+    GzipPutCode(w, 0xC0 + Symbol - 280, 8);
+}
+
+// Write a Match
+void GzipPutMatch(GzipWriter &w, int Length, int Distance)
+{
+  int i = 28;
+  while (GzipLengthBase[i] > Length)
+    i--;
+  GzipPutSymbol(w, 257 + i);
+  GzipPutBits(w, Length - GzipLengthBase[i], GzipLengthExtra[i]);
+
+  int d = 29;
+  while (GzipDistanceBase[d] > Distance)
+    d--;
+  GzipPutCode(w, d, 5);
+  GzipPutBits(w, Distance - GzipDistanceBase[d], GzipDistanceExtra[d]);
+}
+
+// Compress In to Out as a Gzip member.  Returns compressed length, or 0 if it did not fit (send uncompressed instead).
+size_t GzipCompress(const uint8_t *In, size_t InLength, uint8_t *Out, size_t OutSize)
+{
+  GzipWriter w = {Out, OutSize, 0, 0, 0, false};
+  const uint8_t Header[10] = {0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF};
+
+  if (OutSize < 18 || InLength > 32768)
+    return 0;
+
+  memcpy(Out, Header, sizeof(Header));
+  w.Length = sizeof(Header);
+  memset(GzipHash, 0xFF, sizeof(GzipHash));
+
+  GzipPutBits(w, 1, 1); // BFINAL
+  GzipPutBits(w, 1, 2); // BTYPE Fixed Huffman
+
+  size_t i = 0;
+  while (i < InLength && !w.Overflow)
+  {
+    int Best = 0;
+    if (i + 3 <= InLength)
+    {
+      uint32_t h = ((In[i] << 16) | (In[i + 1] << 8) | In[i + 2]) * 2654435761u >> (32 - GZIP_HASH_BITS);
+      uint16_t Candidate = GzipHash[h];
+      GzipHash[h] = i;
+
+      if (Candidate != 0xFFFF)
+      {
+        size_t Limit = min((size_t)258, InLength - i);
+        while (Best < (int)Limit && In[Candidate + Best] == In[i + Best])
+          Best++;
+        if (Best >= 3)
+        {
+          GzipPutMatch(w, Best, i - Candidate);
+          i += Best;
+          continue;
+        }
+      }
+    }
+    GzipPutSymbol(w, In[i++]);
+  }
+
+  GzipPutSymbol(w, 256); // End of Block
+  if (w.Count > 0)
+    GzipPutBits(w, 0, 8 - w.Count);
+
+  // Trailer.  CRC32 and Input Size, little endian
+  uint32_t Crc = crc32_le(0, In, InLength);
+  for (int b = 0; b < 4; b++)
+    GzipPutBits(w, (Crc >> (8 * b)) & 0xFF, 8);
+  for (int b = 0; b < 4; b++)
+    GzipPutBits(w, (InLength >> (8 * b)) & 0xFF, 8);
+
+  return w.Overflow ? 0 : w.Length;
+}
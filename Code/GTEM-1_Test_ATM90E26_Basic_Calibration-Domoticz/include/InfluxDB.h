@@ -0,0 +1,358 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// Libraries
+#include <time.h>
+#include <Gzip.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// InfluxDB Server info.  Setup with your InfluxDB IP, Port and Database
+const char *influx_server = "0.0.0.0";                   // IP Address
+int influx_port = 8086;                                  // InfluxDB port
+const char *influx_path = "/write?db=gtem&precision=ms"; // InfluxDB 1.x.  For 2.x use "/api/v2/write?org=xxx&bucket=gtem&precision=ms"
+const char *influx_token = "";                           // InfluxDB 2.x API Token.  Leave empty for 1.x
+const char *influx_measurement = "gtem";                 // Measurement name.  Tagged with host=<Hostname>
+boolean EnableInfluxDB = false;                          // Change to true to enable writing every Snapshot to InfluxDB.
+boolean EnableInfluxGzip = true;                         // Compress each batch (Content-Encoding: gzip)
+
+// Batching.  Points are flushed by size or time, whichever comes first.
+const int InfluxBatchPoints = 50;        // Flush when this many points are waiting
+const int InfluxFlushInterval = 5000;    // or when the oldest has waited this long (ms)
+const int InfluxBacklogPoints = 600;     // Points held for retry while the server is unreachable.  Oldest are dropped when full.
+const int InfluxTimeout = 2000;          // Server response timeout (ms)
+const int InfluxLatencyInterval = 60000; // Latency Histograms are added to a batch this often (ms), as measurement <influx_measurement>_latency,
+                                         // with the 1min and 15min Rolling Statistics as <influx_measurement>_stats
+
+struct InfluxPoint
+{
+  uint32_t Timestamp; // millis() at capture.  Converted to Unix time when sent.
+  float LineVoltage;
+  float LineCurrent;
+  float ActivePower;
+  float LineFrequency;
+  float PowerFactor;
+  uint8_t Range; // Current Range
+  uint8_t Flags; // SNAP_ bits.  SNAP_RangeSwitch marks a transient to leave out
+};
+
+// Backlog Ring.  InfluxAdded and InfluxSent are running totals, so the ring position is total % InfluxBacklogPoints.
+InfluxPoint InfluxBacklog[InfluxBacklogPoints];
+uint32_t InfluxAdded = 0; // Points added
+uint32_t InfluxSent = 0;  // Points accepted by the server, or dropped
+portMUX_TYPE InfluxMux = portMUX_INITIALIZER_UNLOCKED;
+
+WiFiClient InfluxClient; // Kept open between batches (HTTP keep-alive)
+uint32_t InfluxLatencyLast = 0; // millis() Latency Histograms last added
+InfluxPoint InfluxBatch[InfluxBatchPoints];
+char InfluxBody[InfluxBatchPoints * 160 + (LAT_Count + STATS_Metrics * (STATS_Windows - 1)) * 128]; // Points, then the Latency and Statistics lines
+uint8_t InfluxGzipBody[sizeof(InfluxBody)];
+
+// Statistics
+uint32_t InfluxPointsWritten = 0; // Points accepted by the server
+uint32_t InfluxPointsDropped = 0; // Points lost to a full backlog or rejected batch
+uint32_t InfluxFlushes = 0;       // Successful batches
+uint32_t InfluxFlushErrors = 0;   // Failed batches
+uint32_t InfluxFlushTime = 0;     // Last batch, connect to response (ms)
+uint32_t InfluxFlushTimeMax = 0;  // Slowest batch (ms)
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Add Snapshot to Backlog.  Network Listener, runs in the Network Task.
+void InfluxAddPoint(const GTEM_Snapshot &snap)
+{
+  portENTER_CRITICAL(&InfluxMux);
+  InfluxPoint &Point = InfluxBacklog[InfluxAdded % InfluxBacklogPoints];
+  Point.Timestamp = snap.Timestamp;
+  Point.LineVoltage = snap.LineVoltage;
+  Point.LineCurrent = snap.LineCurrent;
+  Point.ActivePower = snap.ActivePower;
+  Point.LineFrequency = snap.LineFrequency;
+  Point.PowerFactor = snap.PowerFactor;
+  Point.Range = snap.Range;
+  Point.Flags = snap.Flags;
+  InfluxAdded++;
+
+  // Backlog full.  Oldest point is overwritten.
+  if (InfluxAdded - InfluxSent > InfluxBacklogPoints)
+  {
+    InfluxSent = InfluxAdded - InfluxBacklogPoints;
+    InfluxPointsDropped++;
+  }
+  portEXIT_CRITICAL(&InfluxMux);
+}
+
+// Points Waiting
+uint32_t InfluxPending()
+{
+  portENTER_CRITICAL(&InfluxMux);
+  uint32_t Pending = InfluxAdded - InfluxSent;
+  portEXIT_CRITICAL(&InfluxMux);
+  return Pending;
+}
+
+// Format Batch as Line Protocol.  Returns body length.  Host tag is the WiFi Hostname, unless given.
+int InfluxFormatBatch(int Points, int64_t NowMs, uint32_t NowMillis, const char *Host = NULL)
+{
+  int Length = 0;
+  if (Host == NULL)
+    Host = WiFi.getHostname();
+
+  for (int i = 0; i < Points && Length < (int)sizeof(InfluxBody); i++)
+  {
+    const InfluxPoint &Point = InfluxBatch[i];
+    int64_t Time = NowMs - (int32_t)(NowMillis - Point.Timestamp);
+
+    Length += snprintf(InfluxBody + Length, sizeof(InfluxBody) - Length,
+                       "%s,host=%s voltage=%.2f,current=%.3f,power=%.0f,frequency=%.2f,pf=%.3f,range=%ui,flags=%ui %lld\n",
+                       influx_measurement, Host, Point.LineVoltage, Point.LineCurrent, Point.ActivePower,
+                       Point.LineFrequency, Point.PowerFactor, (unsigned)Point.Range, (unsigned)Point.Flags, (long long)Time);
+  }
+
+  // Latency Histograms (us) and Rolling Statistics, if there is room
+  if (NowMillis - InfluxLatencyLast >= InfluxLatencyInterval)
+  {
+    boolean Added = true;
+    for (int i = 0; i < LAT_Count && Added; i++)
+    {
+      char Line[160];
+      int LineLength = snprintf(Line, sizeof(Line), "%s_latency,host=%s,op=%s n=%ui,mean=%ui,p50=%ui,p99=%ui,max=%ui %lld\n",
+                                influx_measurement, Host, Latency[i].Key, (unsigned)Latency[i].GetCount(), (unsigned)Latency[i].GetMean(),
+                                (unsigned)Latency[i].GetPercentile(50), (unsigned)Latency[i].GetPercentile(99), (unsigned)Latency[i].GetMax(), (long long)NowMs);
+      Added = Length + LineLength < (int)sizeof(InfluxBody) && LineLength < (int)sizeof(Line);
+      if (Added && Latency[i].GetCount() > 0)
+      {
+        memcpy(InfluxBody + Length, Line, LineLength);
+        Length += LineLength;
+      }
+    }
+
+    // Rolling Statistics, each Window at least this long
+    for (int m = 0; m < STATS_Metrics && Added && EnableStatistics == true; m++)
+    {
+      for (int w = 0; w < STATS_Windows && Added; w++)
+      {
+        StatsResult r;
+        if (StatsWindowTime[w] < (uint32_t)InfluxLatencyInterval)
+          continue;
+        GetStatistics(m, w, r);
+        char Line[160];
+        int LineLength = snprintf(Line, sizeof(Line), "%s_stats,host=%s,metric=%s,window=%s n=%ui,mean=%.4f,sd=%.4f,min=%.4f,max=%.4f %lld\n",
+                                  influx_measurement, Host, StatsMetricKey[m], StatsWindowName[w], (unsigned)r.Count, r.Mean, r.StdDev,
+                                  r.Min, r.Max, (long long)NowMs);
+        Added = Length + LineLength < (int)sizeof(InfluxBody) && LineLength < (int)sizeof(Line);
+        if (Added && r.Count > 0)
+        {
+          memcpy(InfluxBody + Length, Line, LineLength);
+          Length += LineLength;
+        }
+      }
+    }
+    if (Added)
+      InfluxLatencyLast = NowMillis;
+  }
+
+  return min(Length, (int)sizeof(InfluxBody));
+}
+
+// Read HTTP Response, leaving the connection ready for the next request.  Returns status code, 0 on timeout.
+int InfluxReadResponse()
+{
+  char Line[128];
+  int Status = 0;
+  int ContentLength = 0;
+  boolean KeepAlive = true;
+  uint32_t Start = millis();
+
+  // Status line and headers
+  for (;;)
+  {
+    int Length = 0;
+    for (;;)
+    {
+      if (millis() - Start > InfluxTimeout)
+        return 0;
+      if (!InfluxClient.available())
+      {
+        delay(1);
+        continue;
+      }
+      char c = InfluxClient.read();
+      if (c == '\n')
+        break;
+      if (c != '\r' && Length < (int)sizeof(Line) - 1)
+        Line[Length++] = c;
+    }
+    Line[Length] = 0;
+
+    if (Length == 0)
+      break; // End of headers
+    if (Status == 0)
+      sscanf(Line, "HTTP/%*s %d", &Status);
+    else if (strncasecmp(Line, "Content-Length:", 15) == 0)
+      ContentLength = atoi(Line + 15);
+    else if (strncasecmp(Line, "Connection: close", 17) == 0)
+      KeepAlive = false;
+  }
+
+  // Discard body (error text)
+  while (ContentLength > 0 && millis() - Start <= InfluxTimeout)
+  {
+    if (InfluxClient.available())
+    {
+      InfluxClient.read();
+      ContentLength--;
+    }
+    else
+      delay(1);
+  }
+
+  if (!KeepAlive)
+    InfluxClient.stop();
+
+  return Status;
+}
+
+// Send one Batch.  Returns true if the server accepted or rejected it (either way it is done), false to retry later.
+boolean FlushInfluxDB()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  if (tv.tv_sec < 1600000000)
+    return false; // Waiting for NTP.  Points are timestamped when sent.
+
+  // Copy oldest points out of the ring
+  portENTER_CRITICAL(&InfluxMux);
+  uint32_t First = InfluxSent;
+  int Points = min(InfluxAdded - InfluxSent, (uint32_t)InfluxBatchPoints);
+  for (int i = 0; i < Points; i++)
+    InfluxBatch[i] = InfluxBacklog[(First + i) % InfluxBacklogPoints];
+  portEXIT_CRITICAL(&InfluxMux);
+
+  if (Points == 0)
+    return true;
+
+  LATENCY_SCOPE(LAT_InfluxDB);
+  uint32_t Start = millis();
+  int64_t NowMs = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  int Length = InfluxFormatBatch(Points, NowMs, Start);
+
+  const uint8_t *Body = (const uint8_t *)InfluxBody;
+  size_t BodyLength = Length;
+  if (EnableInfluxGzip == true)
+  {
+    size_t Compressed = GzipCompress((const uint8_t *)InfluxBody, Length, InfluxGzipBody, sizeof(InfluxGzipBody));
+    if (Compressed > 0)
+    {
+      Body = InfluxGzipBody;
+      BodyLength = Compressed;
+    }
+  }
+
+  if (!InfluxClient.connected())
+  {
+    InfluxClient.stop();
+    if (!InfluxClient.connect(influx_server, influx_port))
+    {
+      InfluxFlushErrors++;
+      return false;
+    }
+    InfluxClient.setNoDelay(true);
+  }
+
+  char Header[384];
+  int HeaderLength = snprintf(Header, sizeof(Header),
+                              "POST %s HTTP/1.1\r\nHost: %s:%d\r\nUser-Agent: GTEM\r\nConnection: keep-alive\r\n"
+                              "Content-Type: text/plain; charset=utf-8\r\nContent-Length: %u\r\n%s",
+                              influx_path, influx_server, influx_port, (unsigned)BodyLength,
+                              Body == InfluxGzipBody ? "Content-Encoding: gzip\r\n" : "");
+  if (strlen(influx_token) > 0)
+    HeaderLength += snprintf(Header + HeaderLength, sizeof(Header) - HeaderLength, "Authorization: Token %s\r\n", influx_token);
+  HeaderLength += snprintf(Header + HeaderLength, sizeof(Header) - HeaderLength, "\r\n");
+
+  InfluxClient.write((const uint8_t *)Header, HeaderLength);
+  InfluxClient.write(Body, BodyLength);
+
+  int Status = InfluxReadResponse();
+
+  InfluxFlushTime = millis() - Start;
+  if (InfluxFlushTime > InfluxFlushTimeMax)
+    InfluxFlushTimeMax = InfluxFlushTime;
+
+  if (Status == 0 || Status >= 500)
+  {
+    // Timeout or server error.  Keep points and retry on a new connection.
+    LogWarn("InfluxDB Write Failed (%d).  %u Points Waiting", Status, InfluxPending());
+    InfluxClient.stop();
+    InfluxFlushErrors++;
+    return false;
+  }
+
+  portENTER_CRITICAL(&InfluxMux);
+  if ((int32_t)(First + Points - InfluxSent) > 0) // Unless overrun by a full backlog meanwhile
+    InfluxSent = First + Points;
+  portEXIT_CRITICAL(&InfluxMux);
+
+  if (Status >= 200 && Status < 300)
+  {
+    InfluxPointsWritten += Points;
+    InfluxFlushes++;
+  }
+  else
+  {
+    // Rejected (i.e. 400 Bad Request, 401 Unauthorized).  Sending again will not help.
+    LogError("InfluxDB Rejected Batch (%d).  %d Points Dropped", Status, Points);
+    InfluxPointsDropped += Points;
+    InfluxFlushErrors++;
+  }
+  return true;
+}
+
+// InfluxDB Task.  Flushes by size or time, and backs off while the server is unreachable.
+void InfluxDBTask(void *parameter)
+{
+  uint32_t LastFlush = millis();
+
+  for (;;)
+  {
+    uint32_t Pending = InfluxPending();
+
+    if (WiFi.status() == WL_CONNECTED && Pending > 0 && (Pending >= InfluxBatchPoints || millis() - LastFlush >= InfluxFlushInterval))
+    {
+      boolean Done = FlushInfluxDB();
+      LastFlush = millis();
+
+      // Drain the backlog straight away, once the server is back
+      while (Done && InfluxPending() >= InfluxBatchPoints)
+        Done = FlushInfluxDB();
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+}
+
+// Initialise InfluxDB Writer.  Start before the Sampler Task.
+void InitialiseInfluxDB()
+{
+  configTime(0, 0, "pool.ntp.org", "time.nist.gov"); // InfluxDB timestamps are UTC
+  AddNetworkListener(InfluxAddPoint);
+  xTaskCreatePinnedToCore(InfluxDBTask, "InfluxDB", 6144, NULL, 1, NULL, 0);
+}
+
+// Display InfluxDB Statistics
+void DisplayInfluxStatistics(Print &Out = Serial)
+{
+  Out.printf("InfluxDB Points \t\tWritten %u | Dropped %u | Waiting %u\n", (unsigned)InfluxPointsWritten, (unsigned)InfluxPointsDropped, (unsigned)InfluxPending());
+  Out.printf("InfluxDB Batches \t\tSent %u | Errors %u | Flush %u ms (Max %u ms)\n", (unsigned)InfluxFlushes, (unsigned)InfluxFlushErrors, (unsigned)InfluxFlushTime, (unsigned)InfluxFlushTimeMax);
+}
@@ -0,0 +1,103 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+#ifndef GTEM_INSTRUMENT_H
+#define GTEM_INSTRUMENT_H
+
+// Libraries
+#include <Arduino.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Latency Instrumentation.  Scoped timers read the ESP32 cycle counter (a single register read) on entry and exit,
+// and record the difference into a fixed log scale histogram, so it can be left on.  Build with -D GTEM_INSTRUMENT=0
+// to remove it entirely.  The cycle counter is per core, so a timer that ends on a different core is not recorded.
+#ifndef GTEM_INSTRUMENT
+#define GTEM_INSTRUMENT 1
+#endif
+
+// Histogram Buckets.  4 per power of 2 (within 19%), from 1 cycle to 2^32 cycles (about 18 s at 240 MHz).
+#define LATENCY_SUBBUCKETS 4
+#define LATENCY_BUCKETS 124
+
+enum LatencyId
+{
+  LAT_CommEnergyIC,
+  LAT_InitEnergyIC,
+  LAT_RecoverEnergyIC,
+  LAT_EEPROMRead,
+  LAT_EEPROMWrite,
+  LAT_WiFiConnect,
+  LAT_Domoticz,
+  LAT_InfluxDB,
+  LAT_DirectionEvent,
+  LAT_Count
+};
+
+// **************** FUNCTIONS / ROUTINES / CLASSES ****************
+
+class LatencyHistogram
+{
+public:
+  LatencyHistogram(const char *name, const char *key);
+
+  void Record(uint32_t cycles);
+  void Reset();
+
+  uint32_t GetCount();
+  uint32_t GetPercentile(float percentile); // us
+  uint32_t GetMax();                        // us
+  uint32_t GetMean();                       // us
+
+  const char *Name;
+  const char *Key; // Short name for JSON and InfluxDB
+
+private:
+  uint32_t _buckets[LATENCY_BUCKETS];
+  uint32_t _count;
+  uint32_t _max;   // cycles
+  uint64_t _total; // cycles
+  portMUX_TYPE _mux;
+};
+
+extern LatencyHistogram Latency[LAT_Count];
+
+// Scoped Timer.  Records the time from construction to the end of the enclosing scope.
+class ScopedTimer
+{
+public:
+  ScopedTimer(LatencyHistogram &histogram) : _histogram(histogram), _start(ESP.getCycleCount()), _core(xPortGetCoreID()) {}
+  ~ScopedTimer()
+  {
+    uint32_t cycles = ESP.getCycleCount() - _start;
+    if (xPortGetCoreID() == _core)
+      _histogram.Record(cycles);
+  }
+
+private:
+  LatencyHistogram &_histogram;
+  uint32_t _start;
+  BaseType_t _core;
+};
+
+#if GTEM_INSTRUMENT
+#define LATENCY_SCOPE(id) ScopedTimer _scopedtimer(Latency[id])
+#else
+#define LATENCY_SCOPE(id)
+#endif
+
+void DisplayLatencyStatistics(Print &Out = Serial);
+int FormatLatencyJSON(char *Out, size_t Size);
+
+#endif
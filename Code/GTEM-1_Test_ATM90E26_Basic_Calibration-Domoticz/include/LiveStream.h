@@ -0,0 +1,224 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// Libraries
+#include <ESPAsyncWebServer.h> // Reference https://github.com/me-no-dev/ESPAsyncWebServer
+#include <Dashboard.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Live Stream.  Browse to http://<board IP>/ for the dashboard.  Snapshot deltas are pushed on ws://<board IP>/ws
+// Rolling statistics are at http://<board IP>/stats, the Adaptive Sampling rate at http://<board IP>/rate
+// and the Latency Histograms at http://<board IP>/latency
+boolean EnableLiveStream = false; // Change to true to enable the WebSocket Live Stream and Dashboard.
+int LiveStreamRate = 10;          // Frames per second (1 to 20)
+const int LiveStreamPort = 80;    // Dashboard and WebSocket port
+const int LiveStreamClients = 8;  // Maximum browser clients.  Further connections are refused.
+
+// Per Client State.  Each client receives a delta against the last frame it was actually sent.
+struct LiveStreamClient
+{
+  uint32_t Id;            // AsyncWebSocketClient id, 0 if slot free
+  boolean Primed;         // Full frame sent
+  GTEM_Snapshot LastSent; // Values last queued to this client
+};
+
+AsyncWebServer LiveServer(LiveStreamPort);
+AsyncWebSocket LiveSocket("/ws");
+LiveStreamClient LiveClients[LiveStreamClients];
+SemaphoreHandle_t LiveClientsLock = NULL;
+
+// Statistics
+uint32_t LiveFramesSent = 0;    // Frames queued to clients
+uint32_t LiveFramesDropped = 0; // Frames skipped as client send queue was full
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Append "key":value to Frame
+void AppendLiveField(char *Frame, size_t Size, int &Length, const char *Key, float Value, int Decimals)
+{
+  if (Length > 0 && Length < (int)Size)
+    Length += snprintf(Frame + Length, Size - Length, ",\"%s\":%.*f", Key, Decimals, Value);
+}
+
+// Build JSON Delta Frame.  Only values that changed at display resolution are included, unless Full.
+int EncodeLiveFrame(char *Frame, size_t Size, const GTEM_Snapshot &Now, const GTEM_Snapshot &Last, boolean Full)
+{
+  int Length = snprintf(Frame, Size, "{\"n\":%u,\"t\":%u", (unsigned)Now.Sequence, (unsigned)Now.Timestamp);
+
+  if (Full || lroundf(Now.LineVoltage * 100) != lroundf(Last.LineVoltage * 100))
+    AppendLiveField(Frame, Size, Length, "v", Now.LineVoltage, 2);
+  if (Full || lroundf(Now.LineCurrent * 1000) != lroundf(Last.LineCurrent * 1000))
+    AppendLiveField(Frame, Size, Length, "i", Now.LineCurrent, 3);
+  if (Full || lroundf(Now.ActivePower) != lroundf(Last.ActivePower))
+    AppendLiveField(Frame, Size, Length, "p", Now.ActivePower, 0);
+  if (Full || lroundf(Now.LineFrequency * 100) != lroundf(Last.LineFrequency * 100))
+    AppendLiveField(Frame, Size, Length, "f", Now.LineFrequency, 2);
+  if (Full || lroundf(Now.PowerFactor * 1000) != lroundf(Last.PowerFactor * 1000))
+    AppendLiveField(Frame, Size, Length, "pf", Now.PowerFactor, 3);
+  if (Full || Now.SystemStatus != Last.SystemStatus || Now.MeterStatus != Last.MeterStatus)
+  {
+    AppendLiveField(Frame, Size, Length, "ss", Now.SystemStatus, 0);
+    AppendLiveField(Frame, Size, Length, "ms", Now.MeterStatus, 0);
+  }
+  if (Full || Now.Range != Last.Range || Now.Flags != Last.Flags)
+  {
+    AppendLiveField(Frame, Size, Length, "rg", Now.Range, 0);
+    AppendLiveField(Frame, Size, Length, "fl", Now.Flags, 0);
+  }
+
+  if (Length > 0 && Length < (int)Size - 1)
+  {
+    Frame[Length++] = '}';
+    Frame[Length] = 0;
+    return Length;
+  }
+  return 0;
+}
+
+// WebSocket Connect / Disconnect.  Runs in the AsyncTCP task.
+void LiveSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  if (type == WS_EVT_CONNECT)
+  {
+    int Slot = -1;
+    xSemaphoreTake(LiveClientsLock, portMAX_DELAY);
+    for (int i = 0; i < LiveStreamClients; i++)
+    {
+      if (LiveClients[i].Id == 0)
+      {
+        LiveClients[i].Id = client->id();
+        LiveClients[i].Primed = false;
+        Slot = i;
+        break;
+      }
+    }
+    xSemaphoreGive(LiveClientsLock);
+
+    if (Slot < 0)
+      client->close(1013, "Too many clients");
+  }
+  else if (type == WS_EVT_DISCONNECT)
+  {
+    xSemaphoreTake(LiveClientsLock, portMAX_DELAY);
+    for (int i = 0; i < LiveStreamClients; i++)
+    {
+      if (LiveClients[i].Id == client->id())
+        LiveClients[i].Id = 0;
+    }
+    xSemaphoreGive(LiveClientsLock);
+  }
+}
+
+// Push Snapshot to each Client.  A client with a full send queue is skipped, not waited on,
+// so the next frame it receives is a delta covering everything it missed.
+void PushLiveStream(const GTEM_Snapshot &Now)
+{
+  char Frame[160];
+
+  xSemaphoreTake(LiveClientsLock, portMAX_DELAY);
+  for (int i = 0; i < LiveStreamClients; i++)
+  {
+    if (LiveClients[i].Id == 0)
+      continue;
+
+    AsyncWebSocketClient *client = LiveSocket.client(LiveClients[i].Id);
+    if (client == NULL || client->status() != WS_CONNECTED)
+      continue;
+
+    if (client->queueIsFull())
+    {
+      LiveFramesDropped++;
+      continue;
+    }
+
+    int Length = EncodeLiveFrame(Frame, sizeof(Frame), Now, LiveClients[i].LastSent, !LiveClients[i].Primed);
+    if (Length > 0)
+    {
+      client->text(Frame, Length);
+      LiveClients[i].LastSent = Now;
+      LiveClients[i].Primed = true;
+      LiveFramesSent++;
+    }
+  }
+  xSemaphoreGive(LiveClientsLock);
+}
+
+// Live Stream.  Network Listener, runs in the Network Task.  Frames are limited to LiveStreamRate, however fast the Sampler runs.
+void LiveStreamAddSnapshot(const GTEM_Snapshot &snap)
+{
+  static uint32_t LastPush = 0;
+  static uint32_t LastCleanup = 0;
+
+  if (snap.Timestamp - LastPush < 1000UL / constrain(LiveStreamRate, 1, 20))
+    return;
+  LastPush = snap.Timestamp;
+
+  PushLiveStream(snap);
+
+  // Release closed clients about once a second
+  if (snap.Timestamp - LastCleanup >= 1000)
+  {
+    LiveSocket.cleanupClients(LiveStreamClients);
+    LastCleanup = snap.Timestamp;
+  }
+}
+
+// Initialise Live Stream Server
+void InitialiseLiveStream()
+{
+  LiveClientsLock = xSemaphoreCreateMutex();
+
+  // Dashboard, gzip'd in flash
+  LiveServer.on("/", HTTP_GET, [](AsyncWebServerRequest *request)
+                {
+                  AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", Dashboard_html_gz, Dashboard_html_gz_len);
+                  response->addHeader("Content-Encoding", "gzip");
+                  request->send(response); });
+
+  // Rolling Statistics, JSON
+  LiveServer.on("/stats", HTTP_GET, [](AsyncWebServerRequest *request)
+                {
+                  static char Json[1600];
+                  FormatStatisticsJSON(Json, sizeof(Json));
+                  request->send(200, "application/json", Json); });
+
+  // Adaptive Sampling, JSON
+  LiveServer.on("/rate", HTTP_GET, [](AsyncWebServerRequest *request)
+                {
+                  char Json[160];
+                  FormatAdaptiveRateJSON(Json, sizeof(Json));
+                  request->send(200, "application/json", Json); });
+
+  // Latency Histograms, JSON
+  LiveServer.on("/latency", HTTP_GET, [](AsyncWebServerRequest *request)
+                {
+                  static char Json[640];
+                  FormatLatencyJSON(Json, sizeof(Json));
+                  request->send(200, "application/json", Json); });
+
+  // Register Trace, binary (as 'dump trace', without the framing).  Stops recording.
+  LiveServer.on("/trace", HTTP_GET, [](AsyncWebServerRequest *request)
+                { request->send(request->beginResponse("application/octet-stream", TraceDumpLength(),
+                                                       [](uint8_t *Buffer, size_t Size, size_t Index) -> size_t
+                                                       { return TraceDumpRead(Index, Buffer, Size); })); });
+
+  LiveSocket.onEvent(LiveSocketEvent);
+  LiveServer.addHandler(&LiveSocket);
+  LiveServer.begin();
+
+  AddNetworkListener(LiveStreamAddSnapshot);
+
+  LogInfo("Live Stream \t http://%s:%d/ at %d Hz", WiFi.localIP().toString(), LiveStreamPort, LiveStreamRate);
+}
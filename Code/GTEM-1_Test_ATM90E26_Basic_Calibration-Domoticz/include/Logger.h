@@ -0,0 +1,330 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+#ifndef GTEM_LOGGER_H
+#define GTEM_LOGGER_H
+
+// Libraries
+#include <Arduino.h>
+#include <type_traits>
+#include <Queue.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Buffered Logger.  LogInfo("WiFi IP \t %s", ...) and the others store the format, the time and the arguments in a LogRecord
+// on a lock free queue, and return.  Formatting and the UART are left to the Log task, the lowest priority task, so logging
+// never waits on the serial port, from any task.  If the queue is full, the line is dropped and counted.
+//   - The format is kept as a pointer, so must be a string literal.  Text arguments are copied (LogTextSize in all).
+//   - Numbers are kept as 64 bit integers or doubles, so any %d %u %x %f style conversion works, with flags and width.
+// Lines below GTEM_LOG_LEVEL are compiled out.  Build with -D GTEM_LOG_LEVEL=4 for Debug, or 0 for none.
+#ifndef GTEM_LOG_LEVEL
+#define GTEM_LOG_LEVEL 3
+#endif
+
+enum LogLevel
+{
+  LOG_None,
+  LOG_Error,
+  LOG_Warn,
+  LOG_Info,
+  LOG_Debug
+};
+
+enum LogArgType
+{
+  LOGARG_Int,   // Signed integer
+  LOGARG_Uint,  // Unsigned integer
+  LOGARG_Float, // float or double
+  LOGARG_Text   // Offset into Text
+};
+
+boolean LogTimestamps = false; // Set to true to start each line with its time (s) and level
+
+const int LogArgsMax = 6;           // Arguments per line
+const int LogTextSize = 48;         // Bytes of text arguments per line
+const int LogLineSize = 192;        // Longest formatted line
+const uint32_t LogDrainTime = 20;   // ms between Log task checks, when idle
+const char *LogLevelName = "-EWID"; // By LogLevel
+
+union LogValue
+{
+  int64_t Int;
+  uint64_t Uint;
+  double Float;
+  uint8_t Text;
+};
+
+struct LogRecord
+{
+  uint32_t Time;             // millis()
+  const char *Format;        // printf style.  String literal
+  uint8_t Level;             // LogLevel
+  uint8_t ArgCount;          // Arguments stored
+  uint8_t TextLength;        // Bytes of Text used
+  uint8_t Types[LogArgsMax]; // LogArgType, per argument
+  LogValue Args[LogArgsMax]; // Arguments
+  char Text[LogTextSize];    // Text arguments, each NUL terminated
+};
+
+MPSCQueue<LogRecord, 32> LogQueue; // Any task to the Log task
+TaskHandle_t LogTaskHandle = NULL;
+uint32_t LogLines = 0; // Lines written
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Store one argument
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type LogStore(LogRecord &r, T Value)
+{
+  r.Types[r.ArgCount] = LOGARG_Int;
+  r.Args[r.ArgCount++].Int = Value;
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type LogStore(LogRecord &r, T Value)
+{
+  r.Types[r.ArgCount] = LOGARG_Uint;
+  r.Args[r.ArgCount++].Uint = Value;
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type LogStore(LogRecord &r, T Value)
+{
+  r.Types[r.ArgCount] = LOGARG_Float;
+  r.Args[r.ArgCount++].Float = Value;
+}
+
+inline void LogStore(LogRecord &r, const char *Value)
+{
+  // Copied, truncated if need be.  Text[LogTextSize - 1] is always NUL, for any that do not fit.
+  uint8_t Offset = r.TextLength < LogTextSize ? r.TextLength : LogTextSize - 1;
+  // Byte by byte up to the NUL, so nothing past the end of a short source array is read
+  size_t Length = 0;
+  while (Value != NULL && Offset + Length < LogTextSize - 1 && Value[Length] != 0)
+  {
+    r.Text[Offset + Length] = Value[Length];
+    Length++;
+  }
+  r.Text[Offset + Length] = 0;
+  r.TextLength = Offset + Length + 1;
+
+  r.Types[r.ArgCount] = LOGARG_Text;
+  r.Args[r.ArgCount++].Text = Offset;
+}
+
+inline void LogStore(LogRecord &r, const String &Value)
+{
+  LogStore(r, Value.c_str());
+}
+
+inline void LogPack(LogRecord &r) {}
+
+template <typename T, typename... Rest>
+void LogPack(LogRecord &r, const T &Value, const Rest &...Others)
+{
+  LogStore(r, Value);
+  LogPack(r, Others...);
+}
+
+// Queue a line.  Use the LogError/LogWarn/LogInfo/LogDebug macros, so lines below GTEM_LOG_LEVEL are compiled out.
+template <typename... Args>
+void LogWrite(uint8_t Level, const char *Format, const Args &...Values)
+{
+  static_assert(sizeof...(Args) <= LogArgsMax, "Too many Log arguments");
+
+  LogRecord r;
+  r.Time = millis();
+  r.Format = Format;
+  r.Level = Level;
+  r.ArgCount = 0;
+  r.TextLength = 0;
+  r.Text[LogTextSize - 1] = 0;
+  LogPack(r, Values...);
+  LogQueue.Push(r);
+}
+
+#if GTEM_LOG_LEVEL >= 1
+#define LogError(...) LogWrite(LOG_Error, __VA_ARGS__)
+#else
+#define LogError(...) ((void)0)
+#endif
+#if GTEM_LOG_LEVEL >= 2
+#define LogWarn(...) LogWrite(LOG_Warn, __VA_ARGS__)
+#else
+#define LogWarn(...) ((void)0)
+#endif
+#if GTEM_LOG_LEVEL >= 3
+#define LogInfo(...) LogWrite(LOG_Info, __VA_ARGS__)
+#else
+#define LogInfo(...) ((void)0)
+#endif
+#if GTEM_LOG_LEVEL >= 4
+#define LogDebug(...) LogWrite(LOG_Debug, __VA_ARGS__)
+#else
+#define LogDebug(...) ((void)0)
+#endif
+
+// Format a LogRecord into Line.  Each conversion takes the next stored argument, converted to suit if the type differs.
+// Length modifiers in the format are ignored, as the stored width is used.  Returns the length.
+size_t FormatLogRecord(const LogRecord &r, char *Line, size_t Size)
+{
+  size_t Length = 0;
+  int Arg = 0;
+  const char *f = r.Format;
+
+  if (LogTimestamps == true)
+    Length = snprintf(Line, Size, "[%5u.%03u] %c ", (unsigned)(r.Time / 1000), (unsigned)(r.Time % 1000), LogLevelName[r.Level]);
+
+  while (*f != 0 && Length < Size - 1)
+  {
+    if (*f != '%' || f[1] == '%')
+    {
+      Line[Length++] = *f;
+      f += (*f == '%') ? 2 : 1;
+      continue;
+    }
+
+    // Flags, width and precision kept.  Length modifiers replaced by the stored width.
+    char Spec[16];
+    int n = 0;
+    Spec[n++] = *f++;
+    while (*f != 0 && strchr("-+ #0123456789.", *f) != NULL && n < 10)
+      Spec[n++] = *f++;
+    while (*f != 0 && strchr("hljztL", *f) != NULL)
+      f++;
+    char Conversion = *f;
+    if (Conversion == 0)
+      break;
+    f++;
+
+    if (Arg >= r.ArgCount)
+      continue; // Missing argument.  Left out.
+    const LogValue &v = r.Args[Arg];
+    uint8_t Type = r.Types[Arg++];
+
+    int Written;
+    if (Conversion == 's')
+    {
+      strcpy(Spec + n, "s");
+      Written = snprintf(Line + Length, Size - Length, Spec, Type == LOGARG_Text ? r.Text + v.Text : "?");
+    }
+    else if (Type == LOGARG_Text)
+      Written = snprintf(Line + Length, Size - Length, "?");
+    else if (strchr("fFeEgGaA", Conversion) != NULL)
+    {
+      Spec[n++] = Conversion;
+      Spec[n] = 0;
+      Written = snprintf(Line + Length, Size - Length, Spec, Type == LOGARG_Float ? v.Float : Type == LOGARG_Int ? (double)v.Int : (double)v.Uint);
+    }
+    else if (Conversion == 'c')
+    {
+      strcpy(Spec + n, "c");
+      Written = snprintf(Line + Length, Size - Length, Spec, Type == LOGARG_Float ? (int)v.Float : (int)v.Int);
+    }
+    else
+    {
+      strcpy(Spec + n, "ll");
+      Spec[n + 2] = Conversion;
+      Spec[n + 3] = 0;
+      if (Type == LOGARG_Float)
+        Written = snprintf(Line + Length, Size - Length, Spec, (long long)v.Float);
+      else if (Conversion == 'd' || Conversion == 'i')
+        Written = snprintf(Line + Length, Size - Length, Spec, (long long)v.Int);
+      else
+        Written = snprintf(Line + Length, Size - Length, Spec, (unsigned long long)v.Uint);
+    }
+
+    if (Written > 0)
+      Length += min((size_t)Written, Size - 1 - Length);
+  }
+
+  Line[Length] = 0;
+  return Length;
+}
+
+// Serial Hold.  Taken by the Log task around each line, and by HoldLog() for the length of a binary frame (i.e. 'dump',
+// 'report binary'), so no log line lands inside one.  Created on first use.
+SemaphoreHandle_t LogSerialMutex()
+{
+  static SemaphoreHandle_t Mutex = xSemaphoreCreateMutex();
+  return Mutex;
+}
+
+// Write all queued lines to Serial.  Log task only, or before it starts.
+void DrainLog()
+{
+  LogRecord r;
+  char Line[LogLineSize];
+  while (LogQueue.Pop(r))
+  {
+    size_t Length = FormatLogRecord(r, Line, sizeof(Line) - 1); // Room for the newline, so one write per line
+    Line[Length++] = '\n';
+    xSemaphoreTake(LogSerialMutex(), portMAX_DELAY);
+    Serial.write((const uint8_t *)Line, Length);
+    xSemaphoreGive(LogSerialMutex());
+    LogLines++;
+  }
+}
+
+// Log Task.  Below every other task, so it only runs when there is nothing else to do.
+void LogTask(void *Parameter)
+{
+  for (;;)
+  {
+    DrainLog();
+    vTaskDelay(pdMS_TO_TICKS(LogDrainTime));
+  }
+}
+
+// Start the Log task.  After Serial.begin().  Lines logged before this are held until it starts.
+void InitialiseLogger()
+{
+  if (LogTaskHandle == NULL)
+    xTaskCreatePinnedToCore(LogTask, "Log", 3072, NULL, tskIDLE_PRIORITY, &LogTaskHandle, 0);
+}
+
+// Wait until every queued line is written (i.e. before a restart)
+void FlushLog()
+{
+  if (LogTaskHandle == NULL)
+    DrainLog();
+  while (LogQueue.Depth() > 0)
+    delay(1);
+  Serial.flush();
+}
+
+// Hold log lines off Serial, after writing those queued.  Before the header of a binary frame.  Lines logged meanwhile
+// are queued (or counted as dropped if the queue fills), and written after ReleaseLog().
+void HoldLog()
+{
+  FlushLog();
+  xSemaphoreTake(LogSerialMutex(), portMAX_DELAY);
+}
+
+// After the last byte (the CRC) of a binary frame
+void ReleaseLog()
+{
+  Serial.flush();
+  xSemaphoreGive(LogSerialMutex());
+}
+
+// Display Logger Statistics
+void DisplayLoggerStatistics(Print &Out = Serial)
+{
+  Out.printf("Logger \t\t\t\tLevel %c | Lines %u | Dropped %u | Queued %u | High Water %u of %u\n", LogLevelName[GTEM_LOG_LEVEL], (unsigned)LogLines,
+             (unsigned)LogQueue.Dropped(), (unsigned)LogQueue.Depth(), (unsigned)LogQueue.HighWater(), (unsigned)LogQueue.Size());
+}
+
+#endif
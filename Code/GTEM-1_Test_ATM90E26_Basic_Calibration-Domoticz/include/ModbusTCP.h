@@ -0,0 +1,278 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Modbus TCP Server.  Read Holding Registers (FC 3) and Read Input Registers (FC 4) return the same map.
+// Registers are rebuilt from each Snapshot, so polling never adds SPI traffic.
+boolean EnableModbus = false;  // Change to true to enable the Modbus TCP Server.
+const int ModbusPort = 502;    // Modbus TCP port
+const int ModbusClients = 4;   // Concurrent master connections
+const int ModbusIdleTime = 60; // Close a master connection after this many seconds without a request
+
+// Register Map.  Scaled as the ATM90E26 registers.  32 bit values are high word first.
+#define MB_LineVoltage 0    // Urms    V x 100
+#define MB_LineCurrent 1    // Irms    A x 1000
+#define MB_ActivePower 2    // Pmean   W (signed)
+#define MB_ImportPower 3    // Pmean + W
+#define MB_ExportPower 4    // Pmean - W
+#define MB_LineFrequency 5  // Freq    Hz x 100
+#define MB_PowerFactor 6    // PowerF  x 1000 (signed)
+#define MB_SysStatus 7      // SysStatus 0x01
+#define MB_MeterStatus 8    // EnStatus 0x46
+#define MB_ImportEnergy 9   // APenergy Wh since boot (32 bit, 9-10)
+#define MB_ExportEnergy 11  // ANenergy Wh since boot (32 bit, 11-12)
+#define MB_Sequence 13      // Snapshot number (32 bit, 13-14)
+#define MB_SnapshotTime 15  // Snapshot millis() (32 bit, 15-16)
+#define MB_RangeFlags 17    // Current Range (high byte) and SNAP_ Flags (low byte)
+#define MB_RegisterCount 18
+
+// Statistics Block.  From MB_Statistics, 4 registers (Mean, StdDev, Min, Max) per Metric and Window, scaled as above.
+// i.e. Line Voltage 1s at 100-103, 1min at 104-107, 15min at 108-111, then Line Current 1s at 112-115 and so on.
+#define MB_Statistics 100
+#define MB_StatisticsCount (STATS_Metrics * STATS_Windows * 4)
+const float ModbusStatisticsScale[STATS_Metrics] = {100, 1000, 1, 100, 1000};
+
+struct ModbusConnection
+{
+  WiFiClient Client;
+  uint8_t Frame[260]; // MBAP Header + PDU
+  int Length;         // Bytes received
+  uint32_t LastRequest;
+};
+
+WiFiServer ModbusServer(ModbusPort, ModbusClients);
+ModbusConnection ModbusConnections[ModbusClients];
+uint16_t ModbusRegisters[MB_RegisterCount];
+portMUX_TYPE ModbusMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Statistics
+uint32_t ModbusRequests = 0;   // Requests answered
+uint32_t ModbusExceptions = 0; // Exception responses
+uint32_t ModbusAccepted = 0;   // Connections accepted
+uint32_t ModbusRefused = 0;    // Connections refused, all slots in use
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Encode a Snapshot as the Register Map, into Registers[MB_RegisterCount]
+void ModbusEncodeRegisters(const GTEM_Snapshot &snap, uint16_t *Registers)
+{
+  uint32_t ImportWh = (uint32_t)(snap.ImportEnergy * 1000);
+  uint32_t ExportWh = (uint32_t)(snap.ExportEnergy * 1000);
+  int16_t Power = (int16_t)lroundf(snap.ActivePower);
+
+  Registers[MB_LineVoltage] = (uint16_t)lroundf(snap.LineVoltage * 100);
+  Registers[MB_LineCurrent] = (uint16_t)lroundf(snap.LineCurrent * 1000);
+  Registers[MB_ActivePower] = (uint16_t)Power;
+  Registers[MB_ImportPower] = Power > 0 ? Power : 0;
+  Registers[MB_ExportPower] = Power < 0 ? -Power : 0;
+  Registers[MB_LineFrequency] = (uint16_t)lroundf(snap.LineFrequency * 100);
+  Registers[MB_PowerFactor] = (uint16_t)(int16_t)lroundf(snap.PowerFactor * 1000);
+  Registers[MB_SysStatus] = snap.SystemStatus;
+  Registers[MB_MeterStatus] = snap.MeterStatus;
+  Registers[MB_ImportEnergy] = ImportWh >> 16;
+  Registers[MB_ImportEnergy + 1] = ImportWh & 0xFFFF;
+  Registers[MB_ExportEnergy] = ExportWh >> 16;
+  Registers[MB_ExportEnergy + 1] = ExportWh & 0xFFFF;
+  Registers[MB_Sequence] = snap.Sequence >> 16;
+  Registers[MB_Sequence + 1] = snap.Sequence & 0xFFFF;
+  Registers[MB_SnapshotTime] = snap.Timestamp >> 16;
+  Registers[MB_SnapshotTime + 1] = snap.Timestamp & 0xFFFF;
+  Registers[MB_RangeFlags] = (uint16_t)snap.Range << 8 | snap.Flags;
+}
+
+// Rebuild Register Map from Snapshot.  Snapshot Listener, runs in the Processor Task.
+void ModbusUpdateRegisters(const GTEM_Snapshot &snap)
+{
+  uint16_t Registers[MB_RegisterCount];
+  ModbusEncodeRegisters(snap, Registers);
+
+  portENTER_CRITICAL(&ModbusMux);
+  memcpy(ModbusRegisters, Registers, sizeof(ModbusRegisters));
+  portEXIT_CRITICAL(&ModbusMux);
+}
+
+// Exception Response
+int ModbusException(uint8_t *Frame, uint8_t Function, uint8_t Code)
+{
+  Frame[7] = Function | 0x80;
+  Frame[8] = Code;
+  ModbusExceptions++;
+  return 9;
+}
+
+// Read one Register.  Returns false if the Address is not mapped.
+boolean ModbusReadRegister(uint16_t Address, uint16_t &Value)
+{
+  if (Address < MB_RegisterCount)
+  {
+    portENTER_CRITICAL(&ModbusMux);
+    Value = ModbusRegisters[Address];
+    portEXIT_CRITICAL(&ModbusMux);
+    return true;
+  }
+
+  if (Address >= MB_Statistics && Address < MB_Statistics + MB_StatisticsCount)
+  {
+    StatsResult r;
+    int Index = (Address - MB_Statistics) / 4;
+    int Metric = Index / STATS_Windows;
+    GetStatistics(Metric, Index % STATS_Windows, r);
+
+    const float Field[4] = {r.Mean, r.StdDev, r.Min, r.Max};
+    Value = (uint16_t)(int16_t)lroundf(Field[(Address - MB_Statistics) % 4] * ModbusStatisticsScale[Metric]);
+    return true;
+  }
+
+  return false;
+}
+
+// Process one Request in Frame, building the Response in place.  Returns Response length.
+int ModbusProcess(uint8_t *Frame)
+{
+  uint8_t Function = Frame[7];
+  uint16_t Address = (Frame[8] << 8) | Frame[9];
+  uint16_t Quantity = (Frame[10] << 8) | Frame[11];
+  uint16_t Value;
+  int Length;
+
+  if (Function != 0x03 && Function != 0x04)
+    Length = ModbusException(Frame, Function, 0x01); // Illegal Function
+  else if (Quantity == 0 || Quantity > 125)
+    Length = ModbusException(Frame, Function, 0x03); // Illegal Data Value
+  else if (!ModbusReadRegister(Address, Value) || !ModbusReadRegister(Address + Quantity - 1, Value) ||
+           (Address < MB_RegisterCount) != (Address + Quantity - 1 < MB_RegisterCount))
+    Length = ModbusException(Frame, Function, 0x02); // Illegal Data Address.  A read may not span both blocks.
+  else
+  {
+    Frame[8] = Quantity * 2;
+    for (int i = 0; i < Quantity; i++)
+    {
+      ModbusReadRegister(Address + i, Value);
+      Frame[9 + i * 2] = Value >> 8;
+      Frame[10 + i * 2] = Value & 0xFF;
+    }
+    Length = 9 + Quantity * 2;
+  }
+
+  // MBAP Length.  Unit Identifier and PDU
+  Frame[4] = (Length - 6) >> 8;
+  Frame[5] = (Length - 6) & 0xFF;
+  ModbusRequests++;
+  return Length;
+}
+
+// Service one Connection.  Reads whatever has arrived and answers each complete request.
+void ModbusService(ModbusConnection &Connection)
+{
+  while (Connection.Client.available())
+  {
+    // MBAP Header.  Transaction, Protocol and Length (6 bytes), then Length bytes of Unit Identifier and PDU
+    int Needed = 6;
+    if (Connection.Length >= 6)
+    {
+      Needed = 6 + ((Connection.Frame[4] << 8) | Connection.Frame[5]);
+      if ((Connection.Frame[2] | Connection.Frame[3]) != 0 || Needed < 8 || Needed > (int)sizeof(Connection.Frame))
+      {
+        Connection.Client.stop(); // Not Modbus
+        return;
+      }
+    }
+
+    int Read = Connection.Client.read(Connection.Frame + Connection.Length, Needed - Connection.Length);
+    if (Read <= 0)
+      return;
+    Connection.Length += Read;
+
+    if (Connection.Length >= 8 && Connection.Length == Needed)
+    {
+      int Length;
+      if (Needed < 12)
+      {
+        Length = ModbusException(Connection.Frame, Connection.Frame[7], 0x03); // Short request
+        Connection.Frame[4] = 0;
+        Connection.Frame[5] = 3;
+      }
+      else
+        Length = ModbusProcess(Connection.Frame);
+
+      Connection.Client.write(Connection.Frame, Length);
+      Connection.Length = 0;
+      Connection.LastRequest = millis();
+    }
+  }
+}
+
+// Modbus Task.  Accepts masters into free slots and services each in turn.
+void ModbusTask(void *parameter)
+{
+  for (;;)
+  {
+    if (ModbusServer.hasClient())
+    {
+      WiFiClient NewClient = ModbusServer.available();
+      int Slot = -1;
+      for (int i = 0; i < ModbusClients && Slot < 0; i++)
+      {
+        if (!ModbusConnections[i].Client.connected())
+          Slot = i;
+      }
+
+      if (Slot >= 0)
+      {
+        ModbusConnections[Slot].Client.stop();
+        ModbusConnections[Slot].Client = NewClient;
+        ModbusConnections[Slot].Client.setNoDelay(true);
+        ModbusConnections[Slot].Length = 0;
+        ModbusConnections[Slot].LastRequest = millis();
+        ModbusAccepted++;
+      }
+      else
+      {
+        NewClient.stop();
+        ModbusRefused++;
+      }
+    }
+
+    for (int i = 0; i < ModbusClients; i++)
+    {
+      if (!ModbusConnections[i].Client.connected())
+        continue;
+
+      ModbusService(ModbusConnections[i]);
+
+      if (millis() - ModbusConnections[i].LastRequest > ModbusIdleTime * 1000UL)
+        ModbusConnections[i].Client.stop();
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+}
+
+// Initialise Modbus TCP Server.  Start before the Sampler Task.
+void InitialiseModbus()
+{
+  AddSnapshotListener(ModbusUpdateRegisters);
+  ModbusServer.begin();
+  ModbusServer.setNoDelay(true);
+  xTaskCreatePinnedToCore(ModbusTask, "Modbus", 4096, NULL, 1, NULL, 0);
+
+  LogInfo("Modbus TCP \t %s:%d", WiFi.localIP().toString(), ModbusPort);
+}
+
+// Display Modbus Statistics
+void DisplayModbusStatistics(Print &Out = Serial)
+{
+  Out.printf("Modbus Requests \t\t%u | Exceptions %u | Connections %u | Refused %u\n", (unsigned)ModbusRequests, (unsigned)ModbusExceptions, (unsigned)ModbusAccepted, (unsigned)ModbusRefused);
+}
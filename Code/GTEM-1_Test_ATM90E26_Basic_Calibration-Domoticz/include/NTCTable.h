@@ -0,0 +1,153 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// PCB NTC Temperature Table.  Temperature for every NTC_TableStep ADC codes, worked out by the compiler from the thermistor
+// Steinhart-Hart coefficients and divider below.  A reading is then one lookup and a linear interpolation, with no log().
+// Change a coefficient, and the table and its accuracy check (end of file) are rebuilt with it.
+constexpr double NTC_R1 = 10000;           // Divider Resistor.  Based on 10K
+constexpr double NTC_Cal = 1.16;           // Tweak for Calibration
+constexpr double NTC_C1 = 1.009249522e-03; // Steinhart-Hart Coefficients
+constexpr double NTC_C2 = 2.378405444e-04;
+constexpr double NTC_C3 = 2.019202697e-07;
+constexpr double NTC_RMin = 100;           // Ohms.  Below this reads as NTC_TMax
+constexpr double NTC_TMin = -55;           // ºC.  Table limits
+constexpr double NTC_TMax = 150;           // ºC
+
+const int NTC_ADCMax = 4095;                                    // 12 bit ADC
+const int NTC_TableStep = 32;                                   // ADC codes between entries
+const int NTC_TableSize = (NTC_ADCMax + 1) / NTC_TableStep + 1; // 0 to 4096 inclusive
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Natural log, at compile time.  x = m * 2^k with m in [1, 2), then ln(m) = 2 atanh((m - 1) / (m + 1)) as a series.
+constexpr double ConstLn2 = 0.693147180559945309;
+
+constexpr double ConstAtanhSeries(double y2, double term, int n)
+{
+  return n > 41 ? 0 : term / n + ConstAtanhSeries(y2, term * y2, n + 2);
+}
+
+constexpr double ConstLn(double x, int k = 0)
+{
+  return x >= 2  ? ConstLn(x / 2, k + 1)
+         : x < 1 ? ConstLn(x * 2, k - 1)
+                 : k * ConstLn2 + 2 * ConstAtanhSeries(((x - 1) / (x + 1)) * ((x - 1) / (x + 1)), (x - 1) / (x + 1), 1);
+}
+
+// NTC Resistance at an ADC code, per the divider
+constexpr double NTCResistance(double Code)
+{
+  return NTC_R1 * (NTC_ADCMax / Code - NTC_Cal);
+}
+
+constexpr double NTCSteinhartHart(double lnR)
+{
+  return 1.0 / (NTC_C1 + NTC_C2 * lnR + NTC_C3 * lnR * lnR * lnR) - 273.15;
+}
+
+constexpr double NTCClamp(double T)
+{
+  return T < NTC_TMin ? NTC_TMin : T > NTC_TMax ? NTC_TMax : T;
+}
+
+// Reference Equation.  Temperature (ºC) at an ADC code, as ReadTemperature() used to work out on every reading.
+constexpr double NTCReference(double Code)
+{
+  return Code <= 0 ? NTC_TMin : NTCResistance(Code) <= NTC_RMin ? NTC_TMax : NTCClamp(NTCSteinhartHart(ConstLn(NTCResistance(Code))));
+}
+
+// Table, built from the Reference Equation at each step
+struct NTCTable
+{
+  float Temperature[NTC_TableSize];
+};
+
+template <int... I>
+struct NTCIndexes
+{
+};
+
+template <int N, int... I>
+struct NTCMakeIndexes : NTCMakeIndexes<N - 1, N - 1, I...>
+{
+};
+
+template <int... I>
+struct NTCMakeIndexes<0, I...>
+{
+  typedef NTCIndexes<I...> Type;
+};
+
+template <int... I>
+constexpr NTCTable NTCBuildTable(NTCIndexes<I...>)
+{
+  return {{(float)NTCReference(I * NTC_TableStep)...}};
+}
+
+constexpr NTCTable NTCTemperatures = NTCBuildTable(NTCMakeIndexes<NTC_TableSize>::Type());
+
+// Temperature (ºC) at an ADC code.  Fractional codes (i.e. from averaged readings) interpolate too.
+constexpr float NTCInterpolate(int i, float Fraction)
+{
+  return NTCTemperatures.Temperature[i] + (NTCTemperatures.Temperature[i + 1] - NTCTemperatures.Temperature[i]) * Fraction;
+}
+
+constexpr float NTCTemperature(float Code)
+{
+  return Code <= 0 ? NTCTemperatures.Temperature[0]
+         : Code >= NTC_ADCMax + 1 ? NTCTemperatures.Temperature[NTC_TableSize - 1]
+                                  : NTCInterpolate((int)Code / NTC_TableStep, (Code - ((int)Code / NTC_TableStep) * NTC_TableStep) / NTC_TableStep);
+}
+
+// Accuracy Check.  Largest difference between the Table and the Reference Equation, at the middle of each step (where
+// interpolation is furthest out) from step i on, counting only -20 to 100 ºC.  Checked when compiled, so a coarser
+// NTC_TableStep or new coefficients that lose accuracy fail the build.
+constexpr double NTCAbs(double x)
+{
+  return x < 0 ? -x : x;
+}
+
+constexpr double NTCMax(double a, double b)
+{
+  return a > b ? a : b;
+}
+
+constexpr double NTCStepError(int i)
+{
+  return NTCReference(i * NTC_TableStep + NTC_TableStep / 2.0) < -20 || NTCReference(i * NTC_TableStep + NTC_TableStep / 2.0) > 100
+             ? 0
+             : NTCAbs(NTCTemperature(i * NTC_TableStep + NTC_TableStep / 2.0) - NTCReference(i * NTC_TableStep + NTC_TableStep / 2.0));
+}
+
+constexpr double NTCMaxError(int i)
+{
+  return i >= NTC_TableSize - 1 ? 0 : NTCMax(NTCStepError(i), NTCMaxError(i + 1));
+}
+
+// True if no entry from i on is below the one before
+constexpr bool NTCIncreasing(int i)
+{
+  return i >= NTC_TableSize || (NTCTemperatures.Temperature[i] >= NTCTemperatures.Temperature[i - 1] && NTCIncreasing(i + 1));
+}
+
+static_assert(NTCTemperatures.Temperature[0] == NTC_TMin && NTCTemperatures.Temperature[NTC_TableSize - 1] == NTC_TMax, "NTC Table ends not at the limits");
+static_assert(NTCTemperatures.Temperature[0] == (float)NTCReference(0) && NTCTemperatures.Temperature[NTC_TableSize - 1] == (float)NTCReference(NTC_ADCMax + 1),
+              "NTC Table ends not from the Reference Equation");
+static_assert(NTCTemperature(0) == NTC_TMin && NTCTemperature(-1) == NTC_TMin, "NTC Temperature not clamped at ADC 0");
+static_assert(NTCTemperature(NTC_ADCMax) == NTC_TMax && NTCTemperature(NTC_ADCMax + 1) == NTC_TMax, "NTC Temperature not clamped at ADC 4095");
+static_assert(NTCIncreasing(1), "NTC Table not increasing with ADC code");
+static_assert(NTCMaxError(0) < 0.1, "NTC Table more than 0.1 ºC from the Reference Equation.  Reduce NTC_TableStep");
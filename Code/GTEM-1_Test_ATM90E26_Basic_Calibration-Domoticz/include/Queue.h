@@ -0,0 +1,156 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+#ifndef GTEM_QUEUE_H
+#define GTEM_QUEUE_H
+
+// Libraries
+#include <atomic>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Lock Free Single Producer, Single Consumer Queue.  Static storage, no heap and no locks, so it is safe between a task
+// on each core.  Only one task may Push and only one task may Pop.  Capacity must be a power of 2.
+// Head and Tail are running totals, so the ring position is total & (Capacity - 1), and Head - Tail is the depth.
+template <typename T, uint32_t Capacity>
+class SPSCQueue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "SPSCQueue Capacity must be a power of 2");
+
+public:
+  // Add a copy of Item.  Returns false, and counts a drop, if full.  Producer only.
+  bool Push(const T &Item)
+  {
+    uint32_t Head = _head.load(std::memory_order_relaxed);
+    uint32_t Depth = Head - _tail.load(std::memory_order_acquire);
+    if (Depth >= Capacity)
+    {
+      _dropped++;
+      return false;
+    }
+
+    _items[Head & (Capacity - 1)] = Item;
+    _head.store(Head + 1, std::memory_order_release);
+
+    if (Depth + 1 > _highwater)
+      _highwater = Depth + 1;
+    return true;
+  }
+
+  // Remove the oldest Item.  Returns false if empty.  Consumer only.
+  bool Pop(T &Item)
+  {
+    uint32_t Tail = _tail.load(std::memory_order_relaxed);
+    if (Tail == _head.load(std::memory_order_acquire))
+      return false;
+
+    Item = _items[Tail & (Capacity - 1)];
+    _tail.store(Tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t Depth() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+  uint32_t HighWater() const { return _highwater; } // Deepest seen
+  uint32_t Dropped() const { return _dropped; }     // Items refused as full
+  uint32_t Size() const { return Capacity; }
+
+private:
+  T _items[Capacity];
+  std::atomic<uint32_t> _head{0}; // Written by the Producer
+  std::atomic<uint32_t> _tail{0}; // Written by the Consumer
+  uint32_t _highwater = 0;
+  uint32_t _dropped = 0;
+};
+
+// Lock Free Multiple Producer, Single Consumer Queue.  As SPSCQueue, but any task (on either core) may Push.  Each slot
+// carries a sequence number, so a Producer claims a slot by a compare and swap of the Head, fills it, then publishes it.
+// Only one task may Pop.  Capacity must be a power of 2.
+template <typename T, uint32_t Capacity>
+class MPSCQueue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "MPSCQueue Capacity must be a power of 2");
+
+public:
+  MPSCQueue()
+  {
+    for (uint32_t i = 0; i < Capacity; i++)
+      _slots[i].Sequence.store(i, std::memory_order_relaxed);
+  }
+
+  // Add a copy of Item.  Returns false, and counts a drop, if full.  Any task.
+  bool Push(const T &Item)
+  {
+    uint32_t Head = _head.load(std::memory_order_relaxed);
+    Slot *s;
+    for (;;)
+    {
+      s = &_slots[Head & (Capacity - 1)];
+      int32_t Lag = (int32_t)(s->Sequence.load(std::memory_order_acquire) - Head);
+      if (Lag == 0)
+      {
+        if (_head.compare_exchange_weak(Head, Head + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (Lag < 0)
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      else
+        Head = _head.load(std::memory_order_relaxed);
+    }
+
+    s->Item = Item;
+    s->Sequence.store(Head + 1, std::memory_order_release);
+
+    uint32_t Depth = Head + 1 - _tail.load(std::memory_order_relaxed);
+    if (Depth > _highwater.load(std::memory_order_relaxed))
+      _highwater.store(Depth, std::memory_order_relaxed); // Statistic only.  A race between Producers may under report
+    return true;
+  }
+
+  // Remove the oldest Item.  Returns false if empty.  Consumer only.
+  bool Pop(T &Item)
+  {
+    uint32_t Tail = _tail.load(std::memory_order_relaxed);
+    Slot &s = _slots[Tail & (Capacity - 1)];
+    if (s.Sequence.load(std::memory_order_acquire) != Tail + 1)
+      return false;
+
+    Item = s.Item;
+    s.Sequence.store(Tail + Capacity, std::memory_order_release);
+    _tail.store(Tail + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  uint32_t Depth() const { return _head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_relaxed); }
+  uint32_t HighWater() const { return _highwater.load(std::memory_order_relaxed); } // Deepest seen
+  uint32_t Dropped() const { return _dropped.load(std::memory_order_relaxed); }     // Items refused as full
+  uint32_t Size() const { return Capacity; }
+
+private:
+  struct Slot
+  {
+    std::atomic<uint32_t> Sequence; // Position when free, Position + 1 when filled
+    T Item;
+  };
+
+  Slot _slots[Capacity];
+  std::atomic<uint32_t> _head{0}; // Claimed by the Producers
+  std::atomic<uint32_t> _tail{0}; // Written by the Consumer
+  std::atomic<uint32_t> _highwater{0};
+  std::atomic<uint32_t> _dropped{0};
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <Arduino.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Register Trace.  Records each ATM90E26 SPI transfer (bus address byte, value and time) into a RAM ring, for offline
+// analysis of odd readings.  Dumped with 'dump trace', or from /trace when the Live Stream server runs, and decoded on a PC
+// with tools/gtem_trace.py.  Two modes:
+//   Ring  - Every transfer made by the firmware, as it runs.  Oldest overwritten, so the latest TraceSize are kept.
+//   Burst - The Sampler is paused, and the TraceBurstRegisters read back to back at the full bus rate until the ring is
+//           full.  About 6500 reads/s, so 0.3 s of raw register stream.
+// Recording stops when a dump starts, so the dump is consistent.  Build with -D GTEM_TRACE=0 to remove it.
+#ifndef GTEM_TRACE
+#define GTEM_TRACE 1
+#endif
+
+enum TraceMode
+{
+  TRACE_Off,
+  TRACE_Ring,
+  TRACE_Burst
+};
+
+// Trace Entry.  8 bytes, little endian, as dumped.
+struct TraceEntry
+{
+  uint32_t Time;   // esp_timer us, low 32 bits
+  uint8_t Address; // As sent on the bus.  Bit 7 set for a Read, clear for a Write
+  uint8_t Flags;   // Bit 0 - Core
+  uint16_t Value;  // Read or Written
+};
+
+const uint32_t TraceSize = 2048; // Entries.  16 KB
+const uint8_t TraceFormat = 1;   // Dump header version
+const uint8_t TraceBurstRegisters[] = {SysStatus, EnStatus, Urms, Irms, Pmean, Qmean, Freq, PowerF, Pangle, Smean};
+
+TraceEntry TraceRing[TraceSize];
+volatile uint8_t TraceState = TRACE_Off;
+uint32_t TraceCount = 0;    // Entries recorded since cleared.  Ring position is TraceCount % TraceSize
+uint32_t TraceDumpCount = 0; // Entries in the current dump
+portMUX_TYPE TraceMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t TraceBurstHandle = NULL;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Record one transfer.  Called by the SPI Transport (EnergyATM90E26.h).
+void TraceTransfer(uint8_t Address, uint16_t Value)
+{
+#if GTEM_TRACE
+  if (TraceState == TRACE_Off)
+    return;
+
+  uint32_t Now = (uint32_t)esp_timer_get_time();
+  portENTER_CRITICAL(&TraceMux);
+  if (TraceState != TRACE_Off)
+  {
+    TraceRing[TraceCount % TraceSize] = {Now, Address, (uint8_t)xPortGetCoreID(), Value};
+    TraceCount++;
+    if (TraceState == TRACE_Burst && TraceCount >= TraceSize)
+      TraceState = TRACE_Off;
+  }
+  portEXIT_CRITICAL(&TraceMux);
+#endif
+}
+
+// Start Ring recording, from empty
+void StartTrace()
+{
+  portENTER_CRITICAL(&TraceMux);
+  TraceCount = 0;
+  TraceState = TRACE_Ring;
+  portEXIT_CRITICAL(&TraceMux);
+}
+
+void StopTrace()
+{
+  TraceState = TRACE_Off;
+}
+
+// Burst Task.  Reads the Burst Registers until the ring is full, then resumes the Sampler and ends.
+void TraceBurstTask(void *Parameter)
+{
+  ATM90E26_SPI *ic = (ATM90E26_SPI *)Parameter;
+
+  PauseSampler();
+  while (TraceState == TRACE_Burst)
+  {
+    for (size_t i = 0; i < sizeof(TraceBurstRegisters) && TraceState == TRACE_Burst; i++)
+      ic->GetRegister(TraceBurstRegisters[i]);
+    taskYIELD();
+  }
+  ResumeSampler();
+
+  TraceBurstHandle = NULL;
+  vTaskDelete(NULL);
+}
+
+// Start a Burst capture, from empty.  Same priority as loop(), on the same core, so the Scheduler still runs.
+void StartTraceBurst(ATM90E26_SPI &ic)
+{
+  if (TraceBurstHandle != NULL)
+    return;
+
+  portENTER_CRITICAL(&TraceMux);
+  TraceCount = 0;
+  TraceState = TRACE_Burst;
+  portEXIT_CRITICAL(&TraceMux);
+  xTaskCreatePinnedToCore(TraceBurstTask, "Trace", 2048, &ic, 1, &TraceBurstHandle, 1);
+}
+
+// Trace Dump.  A 12 byte header, "GTRC", format, entry size, flags (bit 0 - ring wrapped) and a 32 bit count, then the
+// entries oldest first.  Length() stops recording.
+uint32_t TraceDumpLength()
+{
+  StopTrace();
+  while (TraceBurstHandle != NULL)
+    delay(1);
+  TraceDumpCount = min(TraceCount, TraceSize);
+  return 12 + TraceDumpCount * sizeof(TraceEntry);
+}
+
+// Entry of the current dump, 0 the oldest
+const TraceEntry &TraceDumpEntry(uint32_t Entry)
+{
+  return TraceRing[(TraceCount - TraceDumpCount + Entry) % TraceSize];
+}
+
+size_t TraceDumpRead(uint32_t Offset, uint8_t *Buffer, size_t Size)
+{
+  uint8_t Header[12] = {'G', 'T', 'R', 'C', TraceFormat, sizeof(TraceEntry), TraceCount > TraceSize ? (uint8_t)1 : (uint8_t)0, 0};
+  memcpy(Header + 8, &TraceDumpCount, 4);
+
+  size_t Count = 0;
+  for (; Count < Size && Offset < 12; Count++, Offset++)
+    Buffer[Count] = Header[Offset];
+
+  for (; Count < Size && Offset < 12 + TraceDumpCount * sizeof(TraceEntry); Count++, Offset++)
+    Buffer[Count] = ((const uint8_t *)&TraceDumpEntry((Offset - 12) / sizeof(TraceEntry)))[(Offset - 12) % sizeof(TraceEntry)];
+  return Count;
+}
+
+// Display Trace Status
+void DisplayTraceStatistics(Print &Out = Serial)
+{
+  const char *StateName[] = {"Off", "Ring", "Burst"};
+  uint32_t Held = min(TraceCount, TraceSize);
+  uint32_t Span = 0;
+  if (Held > 1)
+    Span = TraceRing[(TraceCount - 1) % TraceSize].Time - TraceRing[(TraceCount - Held) % TraceSize].Time;
+  Out.printf("Register Trace \t\t\t%s | Recorded %u | Held %u of %u | Span %u us\n", StateName[TraceState], (unsigned)TraceCount, (unsigned)Held,
+             (unsigned)TraceSize, (unsigned)Span);
+}
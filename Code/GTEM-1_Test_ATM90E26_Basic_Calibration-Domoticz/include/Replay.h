@@ -0,0 +1,419 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <Arduino.h>
+#include <rom/crc.h> // ESP32 ROM CRC32
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Replay.  Feeds recorded or synthetic ATM90E26 register values through the firmware path, as fast as it runs, with no
+// board on the mains.  Each Snapshot passes the driver (register scaling and Energy accumulation), the Snapshot Pacer,
+// Filters, Statistics and each output encoder (Live Stream frame, Modbus registers, InfluxDB line protocol).
+// One line of JSON per Scenario gives throughput, time per stage and a CRC32 digest of each stage's output, i.e.
+// {"replay":"GTEM","version":"GTEM Test 230510","scenario":"steps","snapshots":1420,"sim_ms":60000,"us":48211,"speedup":1244,
+//  "stages":[{"name":"capture","ns_mean":9120,"ns_max":15300,"digest":"5c0e11a2"},...]}
+// Same input and same code give the same digests, so tools/gtem_replay.py compares them against a saved golden file.
+// Scenarios are generated from a fixed seed, or read from the Register Trace ('trace on' or 'trace burst' first).
+// Replay has its own driver, Filter, Statistics, Adaptive state and Modbus map.  The Sampler is paused while it runs.
+const uint32_t ReplayMaxSnapshots = 20000;     // Per Scenario
+const int64_t ReplayEpochMs = 1700000000000LL; // Unix time (ms) of Replay time 0, for InfluxDB
+const uint32_t ReplayTraceScan = 64;           // Trace entries searched for the next read of a register
+
+// Simulated Load.  Written into the register file by ReplaySetLoad().
+struct ReplayLoad
+{
+  float LineVoltage;   // V
+  float LineCurrent;   // A
+  float ActivePower;   // W.  Negative Export
+  float LineFrequency; // Hz
+  float PowerFactor;
+  uint16_t SystemStatus;
+};
+
+// Scenario Generator.  Load at Time (ms) since the start.
+typedef void (*ReplayGenerator)(uint32_t Time, ReplayLoad &Load);
+
+struct ReplayScenario
+{
+  const char *Name;
+  ReplayGenerator Generator; // NULL replays the Register Trace
+  uint32_t Duration;         // ms
+};
+
+enum ReplayStageId
+{
+  REPLAY_Capture,
+  REPLAY_Pacer,
+  REPLAY_Filter,
+  REPLAY_Statistics,
+  REPLAY_LiveFrame,
+  REPLAY_Modbus,
+  REPLAY_Influx,
+  REPLAY_Stages
+};
+
+struct ReplayStage
+{
+  uint32_t Runs;
+  uint64_t Cycles;
+  uint32_t CyclesMax;
+  uint32_t Digest; // CRC32 of every output of the stage, in order
+};
+
+const char *ReplayStageName[REPLAY_Stages] = {"capture", "pacer", "filter", "statistics", "live_frame", "modbus", "influx_batch"};
+
+// Simulated ATM90E26
+uint16_t ReplayRegisters[0x80]; // Register file.  Energy registers clear on read
+uint64_t ReplayEnergy[2];       // Import and Export W.ms not yet in APenergy / ANenergy
+uint32_t ReplaySeed;            // Noise, xorshift32
+uint32_t ReplayTime;            // ms since start
+boolean ReplayFromTrace = false;
+uint32_t ReplayCursor;          // Next Trace entry
+
+// Replay Transport.  Reads the simulated register file, as the SPI Transport reads the ATM90E26.
+struct ReplayTransport
+{
+  static void Begin(int cs) {}
+
+  static unsigned short Read(int cs, unsigned char address)
+  {
+    address &= 0x7F;
+
+    // Next read of this register in the Trace.  Replay time follows the Trace.
+    if (ReplayFromTrace)
+    {
+      for (uint32_t i = ReplayCursor; i < TraceDumpCount && i < ReplayCursor + ReplayTraceScan; i++)
+      {
+        const TraceEntry &Entry = TraceDumpEntry(i);
+        if (Entry.Address == (address | 0x80))
+        {
+          ReplayRegisters[address] = Entry.Value;
+          ReplayTime = (Entry.Time - TraceDumpEntry(0).Time) / 1000;
+          ReplayCursor = i + 1;
+          break;
+        }
+      }
+    }
+
+    unsigned short val = ReplayRegisters[address];
+    if (address >= APenergy && address <= Rtenergy)
+      ReplayRegisters[address] = 0;
+    return val;
+  }
+
+  static void Write(int cs, unsigned char address, unsigned short val)
+  {
+    ReplayRegisters[address & 0x7F] = val;
+  }
+
+  // One task only, so nothing to hold
+  static void Lock(int cs) {}
+  static void Unlock(int cs) {}
+};
+
+typedef ATM90E26<0, ReplayTransport> ATM90E26_Replay;
+
+ReplayStage ReplayStages[REPLAY_Stages];
+FilterState ReplayFilters[STATS_Metrics];
+StatsWindow ReplayStatistics[STATS_Metrics][STATS_Windows];
+uint16_t ReplayModbus[MB_RegisterCount];
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Noise, -Amplitude to +Amplitude
+float ReplayNoise(float Amplitude)
+{
+  ReplaySeed ^= ReplaySeed << 13;
+  ReplaySeed ^= ReplaySeed >> 17;
+  ReplaySeed ^= ReplaySeed << 5;
+  return Amplitude * ((ReplaySeed & 0xFFFF) / 32767.5f - 1);
+}
+
+// Mains, with a little noise on Voltage and Frequency
+void ReplayMains(ReplayLoad &Load, float Voltage, float Power, float PowerFactor)
+{
+  Load.LineVoltage = Voltage + ReplayNoise(0.3);
+  Load.LineFrequency = 50 + ReplayNoise(0.02);
+  Load.ActivePower = Power;
+  Load.PowerFactor = Power < 0 ? -PowerFactor : PowerFactor;
+  Load.LineCurrent = fabsf(Power) / (Load.LineVoltage * PowerFactor);
+  Load.SystemStatus = 0;
+}
+
+// Load steps.  Standby, kettle, fridge and back, 10 s apart.
+void ReplaySteps(uint32_t Time, ReplayLoad &Load)
+{
+  const float Steps[] = {5, 2950, 2950, 120, 650, 5};
+  ReplayMains(Load, 240, Steps[(Time / 10000) % 6] + ReplayNoise(2), 0.97);
+}
+
+// Solar Export and Import.  Flips every 5 s as cloud passes.
+void ReplayFlip(uint32_t Time, ReplayLoad &Load)
+{
+  ReplayMains(Load, 243, ((Time / 5000) % 2 ? 850 : -1400) + ReplayNoise(15), 0.92);
+}
+
+// Voltage Sags.  To 185 V for 300 ms every 7 s, with SagWarn set.
+void ReplaySag(uint32_t Time, ReplayLoad &Load)
+{
+  boolean Sag = Time % 7000 >= 6700;
+  ReplayMains(Load, Sag ? 185 : 238, 1200 + ReplayNoise(10), 0.95);
+  if (Sag)
+    Load.SystemStatus = 0x0002;
+}
+
+// Noisy low current.  A few W of standby either side of the Deadzones.
+void ReplayNoisy(uint32_t Time, ReplayLoad &Load)
+{
+  ReplayMains(Load, 240, 3 + ReplayNoise(6), 0.5 + ReplayNoise(0.3));
+  Load.LineCurrent = 0.04 + ReplayNoise(0.03);
+}
+
+const ReplayScenario ReplayScenarios[] = {
+    {"steps", ReplaySteps, 60000},
+    {"flip", ReplayFlip, 60000},
+    {"sag", ReplaySag, 60000},
+    {"noise", ReplayNoisy, 60000},
+    {"trace", NULL, 0}};
+
+// Write a Load into the register file, as the ATM90E26 would measure it.  Energy builds up over Elapsed ms.
+void ReplaySetLoad(const ReplayLoad &Load, uint32_t Elapsed)
+{
+  float PowerFactor = constrain(fabsf(Load.PowerFactor), 0.0f, 1.0f);
+
+  ReplayRegisters[Urms] = (uint16_t)lroundf(Load.LineVoltage * 100);
+  ReplayRegisters[Irms] = (uint16_t)lroundf(max(Load.LineCurrent, 0.0f) * 1000);
+  ReplayRegisters[Pmean] = (uint16_t)(int16_t)lroundf(Load.ActivePower);
+  ReplayRegisters[Freq] = (uint16_t)lroundf(Load.LineFrequency * 100);
+  ReplayRegisters[PowerF] = (uint16_t)lroundf(PowerFactor * 1000) | (Load.PowerFactor < 0 ? 0x8000 : 0);
+  ReplayRegisters[SysStatus] = Load.SystemStatus;
+  ReplayRegisters[EnStatus] = Load.ActivePower < 0 ? 0x3801 : 0x2801; // RevP when Exporting
+
+  // Energy, in 0.1 Wh (360000 W.ms) counts
+  int Direction = Load.ActivePower < 0 ? 1 : 0;
+  ReplayEnergy[Direction] += (uint64_t)(fabsf(Load.ActivePower) * Elapsed);
+  uint16_t &Counter = ReplayRegisters[Direction ? ANenergy : APenergy];
+  uint32_t Counts = min((uint32_t)(ReplayEnergy[Direction] / 360000), (uint32_t)(0xFFFF - Counter));
+  Counter += Counts;
+  ReplayEnergy[Direction] -= (uint64_t)Counts * 360000;
+}
+
+// Record one run of a Stage, started at Start (cycle count)
+void ReplayStageTime(int Stage, uint32_t Start)
+{
+  uint32_t Cycles = ESP.getCycleCount() - Start;
+  ReplayStage &s = ReplayStages[Stage];
+  s.Runs++;
+  s.Cycles += Cycles;
+  if (Cycles > s.CyclesMax)
+    s.CyclesMax = Cycles;
+}
+
+// Add a Stage Output to its Digest
+void ReplayDigest(int Stage, const void *Output, size_t Length)
+{
+  ReplayStages[Stage].Digest = crc32_le(ReplayStages[Stage].Digest, (const uint8_t *)Output, Length);
+}
+
+// Run one Scenario, and print its result.  Returns Snapshots replayed.
+uint32_t RunReplay(const ReplayScenario &Scenario, const char *Version)
+{
+  static ATM90E26_Replay ic; // Energy totals restart with each Scenario
+  GTEM_Snapshot Snap = {};
+  GTEM_Snapshot Last = {};
+  ReplayLoad Load;
+  char Frame[160];
+  uint32_t Start;
+  uint32_t Count = 0;
+  uint32_t Interval = 0;
+  int InfluxPoints = 0;
+
+  ic = ATM90E26_Replay();
+  memset(ReplayRegisters, 0, sizeof(ReplayRegisters));
+  memset(ReplayEnergy, 0, sizeof(ReplayEnergy));
+  memset(ReplayStages, 0, sizeof(ReplayStages));
+  memset(ReplayFilters, 0, sizeof(ReplayFilters));
+  memset(ReplayStatistics, 0, sizeof(ReplayStatistics));
+  memset(ReplayModbus, 0, sizeof(ReplayModbus));
+  memset(&Adaptive, 0, sizeof(Adaptive));
+  ReplaySeed = 0x47544D31; // "GTM1"
+  ReplayTime = 0;
+  ReplayCursor = 0;
+  ReplayFromTrace = Scenario.Generator == NULL;
+
+  int64_t Began = esp_timer_get_time();
+  while (Count < ReplayMaxSnapshots)
+  {
+    uint32_t Cursor = ReplayCursor;
+    if (ReplayFromTrace ? ReplayCursor >= TraceDumpCount : ReplayTime >= Scenario.Duration)
+      break;
+    if (!ReplayFromTrace)
+    {
+      Scenario.Generator(ReplayTime, Load);
+      ReplaySetLoad(Load, Interval);
+    }
+
+    // Driver
+    Start = ESP.getCycleCount();
+    CaptureSnapshot(ic, Snap);
+    Snap.Sequence = ++Count;
+    Snap.Timestamp = ReplayTime;
+    ReplayStageTime(REPLAY_Capture, Start);
+    ReplayDigest(REPLAY_Capture, &Snap, sizeof(Snap));
+    if (ReplayFromTrace && ReplayCursor == Cursor) // Nothing more the Snapshot reads
+      break;
+
+    // Snapshot Pacer.  Sets the pace of synthetic time, as it sets the Sampler's.
+    Start = ESP.getCycleCount();
+    Interval = EnableAdaptiveRate == true ? AdaptiveSnapshotInterval(Snap) : 1000 / constrain(SnapshotRate, 1, 20);
+    ReplayStageTime(REPLAY_Pacer, Start);
+    ReplayDigest(REPLAY_Pacer, &Interval, sizeof(Interval));
+    if (!ReplayFromTrace)
+      ReplayTime += Interval;
+
+    // Filters
+    if (EnableFilters == true)
+    {
+      float *Values[STATS_Metrics] = {&Snap.LineVoltage, &Snap.LineCurrent, &Snap.ActivePower, &Snap.LineFrequency, &Snap.PowerFactor};
+      Start = ESP.getCycleCount();
+      for (int m = 0; m < STATS_Metrics; m++)
+        *Values[m] = FilterApply(Config.Filters[m], ReplayFilters[m], *Values[m]);
+      ReplayStageTime(REPLAY_Filter, Start);
+      ReplayDigest(REPLAY_Filter, &Snap.LineVoltage, STATS_Metrics * sizeof(float));
+    }
+
+    // Statistics
+    const float Values[STATS_Metrics] = {Snap.LineVoltage, Snap.LineCurrent, Snap.ActivePower, Snap.LineFrequency, Snap.PowerFactor};
+    if (Count == 1)
+    {
+      for (int m = 0; m < STATS_Metrics; m++)
+      {
+        for (int w = 0; w < STATS_Windows; w++)
+          ReplayStatistics[m][w].Start = Snap.Timestamp;
+      }
+    }
+    Start = ESP.getCycleCount();
+    for (int m = 0; m < STATS_Metrics; m++)
+    {
+      for (int w = 0; w < STATS_Windows; w++)
+        StatsWindowAdd(ReplayStatistics[m][w], StatsWindowTime[w] / StatsBuckets, Snap.Timestamp, Values[m]);
+    }
+    ReplayStageTime(REPLAY_Statistics, Start);
+    for (int m = 0; m < STATS_Metrics; m++)
+    {
+      for (int w = 0; w < STATS_Windows; w++)
+        ReplayDigest(REPLAY_Statistics, &ReplayStatistics[m][w].Buckets[ReplayStatistics[m][w].Current], sizeof(StatsBucket));
+    }
+
+    // Live Stream frame, a delta from the last
+    Start = ESP.getCycleCount();
+    int Length = EncodeLiveFrame(Frame, sizeof(Frame), Snap, Last, Count == 1);
+    ReplayStageTime(REPLAY_LiveFrame, Start);
+    ReplayDigest(REPLAY_LiveFrame, Frame, Length);
+
+    // Modbus registers, into Replay's own map.  Masters keep reading the live one.
+    Start = ESP.getCycleCount();
+    ModbusEncodeRegisters(Snap, ReplayModbus);
+    ReplayStageTime(REPLAY_Modbus, Start);
+    ReplayDigest(REPLAY_Modbus, ReplayModbus, sizeof(ReplayModbus));
+
+    // InfluxDB batch.  Its buffers are the writer's, so only while it is not running.
+    if (EnableInfluxDB == false)
+    {
+      InfluxPoint &Point = InfluxBatch[InfluxPoints++];
+      Point = {Snap.Timestamp, Snap.LineVoltage, Snap.LineCurrent, Snap.ActivePower, Snap.LineFrequency, Snap.PowerFactor};
+      if (InfluxPoints == InfluxBatchPoints)
+      {
+        Start = ESP.getCycleCount();
+        InfluxLatencyLast = Snap.Timestamp; // Points only
+        Length = InfluxFormatBatch(InfluxPoints, ReplayEpochMs + Snap.Timestamp, Snap.Timestamp, "replay");
+        ReplayStageTime(REPLAY_Influx, Start);
+        ReplayDigest(REPLAY_Influx, InfluxBody, Length);
+        InfluxPoints = 0;
+      }
+    }
+
+    Last = Snap;
+  }
+  int64_t Time = esp_timer_get_time() - Began;
+  uint32_t SimTime = ReplayTime;
+
+  Serial.printf("{\"replay\":\"GTEM\",\"version\":\"%s\",\"scenario\":\"%s\",\"snapshots\":%u,\"sim_ms\":%u,\"us\":%lld,\"speedup\":%lld,\"stages\":[",
+                Version, Scenario.Name, (unsigned)Count, (unsigned)SimTime, (long long)Time, (long long)(Time > 0 ? SimTime * 1000LL / Time : 0));
+  boolean First = true;
+  for (int i = 0; i < REPLAY_Stages; i++)
+  {
+    const ReplayStage &s = ReplayStages[i];
+    if (s.Runs == 0)
+      continue;
+    Serial.printf("%s{\"name\":\"%s\",\"runs\":%u,\"ns_mean\":%u,\"ns_max\":%u,\"digest\":\"%08x\"}", First ? "" : ",", ReplayStageName[i], (unsigned)s.Runs,
+                  (unsigned)(s.Cycles * 1000 / s.Runs / ESP.getCpuFreqMHz()), (unsigned)(s.CyclesMax * 1000ULL / ESP.getCpuFreqMHz()), (unsigned)s.Digest);
+    First = false;
+  }
+  Serial.println("]}");
+
+  return Count;
+}
+
+// Run the named Scenario, or all of them ('all').  The trace Scenario replays the Register Trace, if one is held.
+boolean RunReplays(const char *Name, const char *Version)
+{
+  const ReplayScenario *Found = NULL;
+  boolean All = strcasecmp(Name, "all") == 0;
+  for (size_t i = 0; i < sizeof(ReplayScenarios) / sizeof(ReplayScenarios[0]); i++)
+  {
+    if (All || strcasecmp(Name, ReplayScenarios[i].Name) == 0)
+      Found = &ReplayScenarios[i];
+  }
+  if (Found == NULL)
+    return false;
+
+  // Live state the Replay shares, kept aside and put back after
+  static AdaptiveState Saved;
+  uint32_t SavedInfluxLatency = InfluxLatencyLast;
+  uint64_t SavedTierTime[TIER_Count];
+  uint32_t SavedTierChanges = SampleTierChanges;
+  uint32_t SavedSteps = SampleSteps;
+
+  PauseSampler();
+  memcpy(&Saved, &Adaptive, sizeof(Saved));
+  memcpy(SavedTierTime, SampleTierTime, sizeof(SavedTierTime));
+
+  TraceDumpLength(); // Stops the Trace, and holds what it recorded
+  for (size_t i = 0; i < sizeof(ReplayScenarios) / sizeof(ReplayScenarios[0]); i++)
+  {
+    const ReplayScenario &Scenario = ReplayScenarios[i];
+    if (!All && &Scenario != Found)
+      continue;
+    if (Scenario.Generator == NULL && TraceDumpCount == 0)
+    {
+      Serial.println("No Register Trace held.  'trace on' or 'trace burst' first");
+      continue;
+    }
+    RunReplay(Scenario, Version);
+  }
+
+  portENTER_CRITICAL(&AdaptiveMux);
+  memcpy(&Adaptive, &Saved, sizeof(Saved));
+  memcpy(SampleTierTime, SavedTierTime, sizeof(SavedTierTime));
+  SampleTierChanges = SavedTierChanges;
+  SampleSteps = SavedSteps;
+  portEXIT_CRITICAL(&AdaptiveMux);
+  InfluxLatencyLast = SavedInfluxLatency;
+
+  ResumeSampler();
+  return true;
+}
@@ -0,0 +1,155 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Cooperative Scheduler.  loop() runs each Job when it is due, then sleeps until the next, rather than using delay().
+// Jobs are Periodic, or One Shot (run once, then re-armed as needed).  Jobs must not block for long, as a slow Job
+// delays the others.  Timing is by esp_timer (us), so each Job's jitter and overruns can be measured.
+typedef void (*JobFunction)();
+
+struct SchedulerJob
+{
+  const char *Name;
+  JobFunction Function;
+  uint32_t Period;      // ms.  0 for One Shot
+  int64_t Due;          // esp_timer us
+  boolean Active;       // Armed
+  uint32_t Runs;        // Times run
+  uint32_t Overruns;    // Periods missed, as the Job (or one before it) ran late
+  uint32_t JitterLast;  // us late, last run
+  uint32_t JitterMax;   // us late, worst
+  uint64_t JitterTotal; // us late, total
+  uint32_t TimeMax;     // us run time, worst
+};
+
+const int SchedulerJobsMax = 12;
+SchedulerJob SchedulerJobs[SchedulerJobsMax];
+int SchedulerJobCount = 0;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Add a Job, first due after Delay ms.  Period 0 for One Shot.  Returns Job Id, or -1 if full.
+int AddJob(const char *Name, JobFunction Function, uint32_t Period, uint32_t Delay = 0)
+{
+  if (SchedulerJobCount >= SchedulerJobsMax)
+    return -1;
+
+  SchedulerJob &Job = SchedulerJobs[SchedulerJobCount];
+  memset(&Job, 0, sizeof(Job));
+  Job.Name = Name;
+  Job.Function = Function;
+  Job.Period = Period;
+  Job.Due = esp_timer_get_time() + Delay * 1000LL;
+  Job.Active = true;
+  return SchedulerJobCount++;
+}
+
+// Add a One Shot Job, unarmed.  Arm with ScheduleJob().  Returns Job Id, or -1 if full.
+int AddOneShotJob(const char *Name, JobFunction Function)
+{
+  int Id = AddJob(Name, Function, 0);
+  if (Id >= 0)
+    SchedulerJobs[Id].Active = false;
+  return Id;
+}
+
+// (Re)arm a Job, due after Delay ms
+void ScheduleJob(int Id, uint32_t Delay)
+{
+  if (Id < 0 || Id >= SchedulerJobCount)
+    return;
+  SchedulerJobs[Id].Due = esp_timer_get_time() + Delay * 1000LL;
+  SchedulerJobs[Id].Active = true;
+}
+
+// Change a Periodic Job's Period.  Next due one new Period from now.
+void SetJobPeriod(int Id, uint32_t Period)
+{
+  if (Id < 0 || Id >= SchedulerJobCount || Period == 0)
+    return;
+  SchedulerJobs[Id].Period = Period;
+  SchedulerJobs[Id].Due = esp_timer_get_time() + Period * 1000LL;
+}
+
+// Disarm a Job
+void CancelJob(int Id)
+{
+  if (Id >= 0 && Id < SchedulerJobCount)
+    SchedulerJobs[Id].Active = false;
+}
+
+// Run each Job that is due, then sleep until the next is due.  Call from loop().
+void RunScheduler()
+{
+  for (int i = 0; i < SchedulerJobCount; i++)
+  {
+    SchedulerJob &Job = SchedulerJobs[i];
+    int64_t Start = esp_timer_get_time();
+    if (!Job.Active || Start < Job.Due)
+      continue;
+
+    uint32_t Jitter = (uint32_t)(Start - Job.Due);
+    Job.JitterLast = Jitter;
+    Job.JitterTotal += Jitter;
+    if (Jitter > Job.JitterMax)
+      Job.JitterMax = Jitter;
+
+    // One Shot Jobs disarm first, so may re-arm themselves
+    if (Job.Period == 0)
+      Job.Active = false;
+
+    Job.Function();
+    Job.Runs++;
+
+    int64_t End = esp_timer_get_time();
+    if ((uint32_t)(End - Start) > Job.TimeMax)
+      Job.TimeMax = (uint32_t)(End - Start);
+
+    // Periodic Jobs keep their phase.  Any periods already passed are skipped, and counted.
+    if (Job.Period > 0)
+    {
+      Job.Due += Job.Period * 1000LL;
+      while (Job.Due <= End)
+      {
+        Job.Due += Job.Period * 1000LL;
+        Job.Overruns++;
+      }
+    }
+  }
+
+  // Sleep until the next Job is due, waking at least every 100 ms
+  int64_t Now = esp_timer_get_time();
+  int64_t Next = Now + 100000;
+  for (int i = 0; i < SchedulerJobCount; i++)
+  {
+    if (SchedulerJobs[i].Active && SchedulerJobs[i].Due < Next)
+      Next = SchedulerJobs[i].Due;
+  }
+
+  if (Next - Now >= 1000)
+    vTaskDelay(pdMS_TO_TICKS((Next - Now) / 1000));
+}
+
+// Display Scheduler Statistics
+void DisplaySchedulerStatistics(Print &Out = Serial)
+{
+  Out.println("Scheduler Jobs \t\t\tPeriod\tRuns\tOverrun\tJitter us Last/Mean/Max\tRun us Max");
+  for (int i = 0; i < SchedulerJobCount; i++)
+  {
+    SchedulerJob &Job = SchedulerJobs[i];
+    Out.printf("%-16s \t\t%u\t%u\t%u\t%u / %u / %u\t\t%u\n", Job.Name, (unsigned)Job.Period, (unsigned)Job.Runs, (unsigned)Job.Overruns,
+                  (unsigned)Job.JitterLast, (unsigned)(Job.Runs ? Job.JitterTotal / Job.Runs : 0), (unsigned)Job.JitterMax, (unsigned)Job.TimeMax);
+  }
+}
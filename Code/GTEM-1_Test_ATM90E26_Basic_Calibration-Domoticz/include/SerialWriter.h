@@ -0,0 +1,113 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <Arduino.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Buffered Serial Writer.  Text printed to SerialOut is held in a RAM ring, and passed on to the UART by the 'Serial Writer'
+// Scheduler Job only as the UART has room, so a long report takes memory time, not 115200 baud time.  If the ring fills, the
+// writer waits on the UART for the oldest chunk (a Stall) rather than lose text.  Used from loop() only.
+const size_t SerialWriterSize = 8192;      // Bytes.  Holds a full Diagnostic Report
+const uint32_t SerialWriterDrainTime = 10; // ms between drains.  The UART FIFO empties in about 11 ms at 115200
+
+class SerialWriter : public Print
+{
+public:
+  size_t write(uint8_t c) override
+  {
+    return write(&c, 1);
+  }
+
+  size_t write(const uint8_t *Data, size_t Size) override
+  {
+    for (size_t i = 0; i < Size; i++)
+    {
+      if (_count == SerialWriterSize)
+      {
+        Stalls++;
+        Send(SerialWriterSize - _head < _count ? SerialWriterSize - _head : _count);
+      }
+      _ring[(_head + _count) % SerialWriterSize] = Data[i];
+      _count++;
+    }
+    if (_count > HighWater)
+      HighWater = _count;
+    Bytes += Size;
+    return Size;
+  }
+
+  // Pass on as much as the UART will take now, without waiting
+  void Drain()
+  {
+    int Room = Serial.availableForWrite();
+    while (_count > 0 && Room > 0)
+    {
+      size_t Chunk = SerialWriterSize - _head < _count ? SerialWriterSize - _head : _count;
+      if (Chunk > (size_t)Room)
+        Chunk = Room;
+      Send(Chunk);
+      Room -= Chunk;
+    }
+  }
+
+  // Pass on everything, waiting on the UART.  Before any direct Serial output that must not interleave (i.e. binary dumps).
+  void flush() override
+  {
+    while (_count > 0)
+      Send(SerialWriterSize - _head < _count ? SerialWriterSize - _head : _count);
+    Serial.flush();
+  }
+
+  size_t Pending()
+  {
+    return _count;
+  }
+
+  uint32_t Bytes = 0;   // Bytes written
+  uint32_t Stalls = 0;  // Writes that waited on the UART, as the ring was full
+  size_t HighWater = 0; // Most bytes held
+
+private:
+  void Send(size_t Chunk)
+  {
+    Serial.write(&_ring[_head], Chunk);
+    _head = (_head + Chunk) % SerialWriterSize;
+    _count -= Chunk;
+  }
+
+  uint8_t _ring[SerialWriterSize];
+  size_t _head = 0;
+  size_t _count = 0;
+};
+
+SerialWriter SerialOut;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Serial Writer Job
+void SerialWriterJob()
+{
+  SerialOut.Drain();
+}
+
+// Display Serial Writer Statistics
+void DisplaySerialWriterStatistics(Print &Out = Serial)
+{
+  Out.println("Serial Writer \t\t\tBytes\tPending\tHigh\tStalls");
+  Out.printf("%-16s \t\t%u\t%u\t%u\t%u\n", "Ring", (unsigned)SerialOut.Bytes, (unsigned)SerialOut.Pending(), (unsigned)SerialOut.HighWater,
+             (unsigned)SerialOut.Stalls);
+}
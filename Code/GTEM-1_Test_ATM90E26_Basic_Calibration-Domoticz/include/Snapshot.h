@@ -0,0 +1,304 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// Libraries
+#include <Queue.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Measurement Snapshot.  One set of readings captured together by the Sampler Task, and shared with the outputs.
+struct GTEM_Snapshot
+{
+  uint32_t Sequence;     // Incremented on every capture
+  uint32_t Timestamp;    // millis() at capture
+  float LineVoltage;     // Urms - Line Voltage RMS (V)
+  float LineCurrent;     // Irms - Line Current RMS (A)
+  float ActivePower;     // Pmean - Line Mean Active Power (W).  Positive Import, Negative Export
+  float LineFrequency;   // Freq - Line Voltage Frequency (Hz)
+  float PowerFactor;     // PowerF - Line Power Factor
+  uint16_t SystemStatus; // SysStatus 0x01
+  uint16_t MeterStatus;  // EnStatus 0x46
+  uint8_t Range;         // Current Range at capture (CurrentRange.h)
+  uint8_t Flags;         // SNAP_ bits
+  double ImportEnergy;   // APenergy - Forward Active Energy since boot (kWh)
+  double ExportEnergy;   // ANenergy - Reverse Active Energy since boot (kWh)
+};
+
+// Snapshot Flags
+#define SNAP_RangeSwitch 0x01 // Captured while the Current Range settles after a switch.  Left out of the Statistics and the
+                              // Filter history, and sent with the Range to the Live Stream (fl), InfluxDB (flags) and Modbus (17)
+
+// Snapshot Pipeline.  Three tasks, joined by lock free queues, so a slow output never delays a capture.
+//   Sampler   - Core 1, priority 3.  Captures the ATM90E26 registers at SnapshotRate (or as paced) into SamplerQueue.
+//   Processor - Core 1, priority 2.  Filters, publishes as Latest and runs the Snapshot Listeners, then passes to NetworkQueue.
+//   Network   - Core 0, priority 1.  Runs the Network Listeners, which hand each Snapshot to the network outputs.
+int SnapshotRate = 10; // Sampler Rate in Hz (1 to 20).  The Normal rate when Adaptive Sampling is enabled
+
+SPSCQueue<GTEM_Snapshot, 16> SamplerQueue; // Sampler to Processor
+SPSCQueue<GTEM_Snapshot, 32> NetworkQueue; // Processor to Network
+
+GTEM_Snapshot LatestSnapshot = {};                       // Last processed Snapshot.  Use GetLatestSnapshot() to read
+portMUX_TYPE SnapshotMux = portMUX_INITIALIZER_UNLOCKED; // Guards LatestSnapshot between tasks
+TaskHandle_t SnapshotTaskHandle = NULL;                  // Sampler
+TaskHandle_t ProcessorTaskHandle = NULL;
+TaskHandle_t NetworkTaskHandle = NULL;
+volatile boolean SamplerPause = false;                   // Set by PauseSampler()
+volatile boolean SamplerPaused = false;                  // Sampler is idle, and not using SPI
+
+// Snapshot Filter.  Applied to each capture before it is published, i.e. FilterSnapshot() in Filters.h.
+typedef void (*SnapshotProcessor)(GTEM_Snapshot &snap);
+SnapshotProcessor SnapshotFilter = NULL;
+
+// Snapshot Range.  Checks each raw capture against the Current Range, switching it if needed, and flags the capture.
+// i.e. CurrentRangeCapture() in CurrentRange.h.
+SnapshotProcessor SnapshotRange = NULL;
+
+// Snapshot Pacer.  Chooses the interval to the next capture from each raw capture, i.e. AdaptiveSnapshotInterval() in AdaptiveRate.h.
+// Returns ms.  If not set, the Sampler runs at SnapshotRate.
+typedef uint32_t (*SnapshotScheduler)(const GTEM_Snapshot &snap);
+SnapshotScheduler SnapshotPacer = NULL;
+
+// Snapshot Listeners.  Called from the Processor Task on every Snapshot, so must be quick and never block.
+// Network Listeners.  Called from the Network Task on every Snapshot.  May take longer, but never block on a server.
+typedef void (*SnapshotListener)(const GTEM_Snapshot &snap);
+const int SnapshotListenersMax = 4;
+SnapshotListener SnapshotListeners[SnapshotListenersMax];
+SnapshotListener NetworkListeners[SnapshotListenersMax];
+int SnapshotListenerCount = 0;
+int NetworkListenerCount = 0;
+
+// Stage Statistics.  Execution time per Snapshot, in us.
+enum PipelineStageId
+{
+  STAGE_Sampler,
+  STAGE_Processor,
+  STAGE_Network,
+  STAGE_Count
+};
+
+struct PipelineStage
+{
+  uint32_t Runs;      // Snapshots handled
+  uint32_t TimeLast;  // us
+  uint32_t TimeMax;   // us
+  uint64_t TimeTotal; // us
+};
+
+const char *PipelineStageName[STAGE_Count] = {"Sampler", "Processor", "Network"};
+PipelineStage PipelineStages[STAGE_Count] = {};
+portMUX_TYPE PipelineMux = portMUX_INITIALIZER_UNLOCKED;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Capture the Measurement Registers into a Snapshot.  Energy registers are cleared on read, so the driver running totals are used.
+// Any ATM90E26 driver, i.e. the Replay driver (Replay.h).
+template <class EnergyIC>
+void CaptureSnapshot(EnergyIC &ic, GTEM_Snapshot &snap)
+{
+  snap.Timestamp = millis();
+  snap.LineVoltage = ic.GetLineVoltage();
+  snap.LineCurrent = ic.GetLineCurrent();
+  snap.ActivePower = ic.GetActivePower();
+  snap.LineFrequency = ic.GetFrequency();
+  snap.PowerFactor = ic.GetPowerFactor();
+  snap.SystemStatus = ic.GetSysStatus();
+  snap.MeterStatus = ic.GetMeterStatus();
+  snap.Flags = 0;
+  ic.GetImportEnergy();
+  ic.GetExportEnergy();
+  snap.ImportEnergy = ic.GetImportEnergyTotal();
+  snap.ExportEnergy = ic.GetExportEnergyTotal();
+}
+
+// Store Snapshot as Latest
+void PublishSnapshot(const GTEM_Snapshot &snap)
+{
+  portENTER_CRITICAL(&SnapshotMux);
+  LatestSnapshot = snap;
+  portEXIT_CRITICAL(&SnapshotMux);
+}
+
+// Copy of Latest Snapshot
+void GetLatestSnapshot(GTEM_Snapshot &snap)
+{
+  portENTER_CRITICAL(&SnapshotMux);
+  snap = LatestSnapshot;
+  portEXIT_CRITICAL(&SnapshotMux);
+}
+
+// Register a Listener, before StartSnapshotTask()
+void AddSnapshotListener(SnapshotListener listener)
+{
+  if (SnapshotListenerCount < SnapshotListenersMax)
+    SnapshotListeners[SnapshotListenerCount++] = listener;
+}
+
+// Register a Network Listener, before StartSnapshotTask()
+void AddNetworkListener(SnapshotListener listener)
+{
+  if (NetworkListenerCount < SnapshotListenersMax)
+    NetworkListeners[NetworkListenerCount++] = listener;
+}
+
+// Record one run of a Stage, started at Start (esp_timer_get_time())
+void PipelineStageTime(int Stage, int64_t Start)
+{
+  uint32_t Time = (uint32_t)(esp_timer_get_time() - Start);
+
+  portENTER_CRITICAL(&PipelineMux);
+  PipelineStage &s = PipelineStages[Stage];
+  s.Runs++;
+  s.TimeLast = Time;
+  s.TimeTotal += Time;
+  if (Time > s.TimeMax)
+    s.TimeMax = Time;
+  portEXIT_CRITICAL(&PipelineMux);
+}
+
+// Sampler Task.  SPI.beginTransaction() holds the bus lock, so reads may interleave safely with loop().
+void SnapshotTask(void *parameter)
+{
+  ATM90E26_SPI *ic = (ATM90E26_SPI *)parameter;
+  GTEM_Snapshot snap = {};
+  TickType_t LastWake = xTaskGetTickCount();
+
+  for (;;)
+  {
+    int64_t Start = esp_timer_get_time();
+    uint32_t Interval = 1000 / constrain(SnapshotRate, 1, 20);
+
+    SamplerPaused = SamplerPause;
+    if (SamplerPaused)
+    {
+      vTaskDelayUntil(&LastWake, pdMS_TO_TICKS(10));
+      continue;
+    }
+
+    // Faulty ATM90E26.  Nothing captured until it is Recovered
+    if (EnableHealthCheck == true && !CheckEnergyIC(*ic))
+    {
+      PipelineStageTime(STAGE_Sampler, Start);
+      vTaskDelayUntil(&LastWake, pdMS_TO_TICKS(Interval));
+      continue;
+    }
+
+    CaptureSnapshot(*ic, snap);
+    snap.Sequence++;
+    if (SnapshotRange != NULL)
+      SnapshotRange(snap);
+    if (SnapshotPacer != NULL)
+      Interval = SnapshotPacer(snap);
+
+    SamplerQueue.Push(snap);
+    xTaskNotifyGive(ProcessorTaskHandle);
+    PipelineStageTime(STAGE_Sampler, Start);
+
+    vTaskDelayUntil(&LastWake, pdMS_TO_TICKS(Interval));
+  }
+}
+
+// Processor Task.  Woken by the Sampler.
+void ProcessorTask(void *parameter)
+{
+  GTEM_Snapshot snap;
+
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    while (SamplerQueue.Pop(snap))
+    {
+      int64_t Start = esp_timer_get_time();
+
+      if (SnapshotFilter != NULL)
+        SnapshotFilter(snap);
+      PublishSnapshot(snap);
+
+      for (int i = 0; i < SnapshotListenerCount; i++)
+        SnapshotListeners[i](snap);
+
+      if (NetworkListenerCount > 0)
+      {
+        NetworkQueue.Push(snap);
+        xTaskNotifyGive(NetworkTaskHandle);
+      }
+      PipelineStageTime(STAGE_Processor, Start);
+    }
+  }
+}
+
+// Network Task.  Woken by the Processor.
+void NetworkTask(void *parameter)
+{
+  GTEM_Snapshot snap;
+
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    while (NetworkQueue.Pop(snap))
+    {
+      int64_t Start = esp_timer_get_time();
+
+      for (int i = 0; i < NetworkListenerCount; i++)
+        NetworkListeners[i](snap);
+
+      PipelineStageTime(STAGE_Network, Start);
+    }
+  }
+}
+
+// Pause the Sampler between captures, i.e. for exclusive use of the ATM90E26.  Waits up to 1 s for it to stop.
+void PauseSampler()
+{
+  SamplerPause = true;
+  for (int i = 0; i < 100 && SnapshotTaskHandle != NULL && !SamplerPaused; i++)
+    delay(10);
+}
+
+void ResumeSampler()
+{
+  SamplerPause = false;
+}
+
+// Start Snapshot Pipeline (Once).  Consumers first, so the Sampler always has a task to wake.
+void StartSnapshotTask(ATM90E26_SPI &ic)
+{
+  if (SnapshotTaskHandle == NULL)
+  {
+    xTaskCreatePinnedToCore(NetworkTask, "Network", 4096, NULL, 1, &NetworkTaskHandle, 0);
+    xTaskCreatePinnedToCore(ProcessorTask, "Processor", 4096, NULL, 2, &ProcessorTaskHandle, 1);
+    xTaskCreatePinnedToCore(SnapshotTask, "Snapshot", 4096, &ic, 3, &SnapshotTaskHandle, 1);
+  }
+}
+
+// Display Pipeline Statistics
+void DisplayPipelineStatistics(Print &Out = Serial)
+{
+  PipelineStage Stages[STAGE_Count];
+
+  portENTER_CRITICAL(&PipelineMux);
+  memcpy(Stages, PipelineStages, sizeof(Stages));
+  portEXIT_CRITICAL(&PipelineMux);
+
+  Out.println("Pipeline \t\t\tRuns\tLast us\tMean us\tMax us");
+  for (int i = 0; i < STAGE_Count; i++)
+    Out.printf("%-16s \t\t%u\t%u\t%u\t%u\n", PipelineStageName[i], (unsigned)Stages[i].Runs, (unsigned)Stages[i].TimeLast,
+                  (unsigned)(Stages[i].Runs ? Stages[i].TimeTotal / Stages[i].Runs : 0), (unsigned)Stages[i].TimeMax);
+
+  Out.printf("Sampler Queue \t\t\t%u / %u | High Water %u | Dropped %u\n", (unsigned)SamplerQueue.Depth(), (unsigned)SamplerQueue.Size(),
+                (unsigned)SamplerQueue.HighWater(), (unsigned)SamplerQueue.Dropped());
+  Out.printf("Network Queue \t\t\t%u / %u | High Water %u | Dropped %u\n", (unsigned)NetworkQueue.Depth(), (unsigned)NetworkQueue.Size(),
+                (unsigned)NetworkQueue.HighWater(), (unsigned)NetworkQueue.Dropped());
+}
@@ -0,0 +1,228 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Streaming Statistics.  Count, Mean, Standard Deviation, Min and Max of each metric over several rolling windows at once.
+// Each window is a ring of fixed time buckets.  A sample updates the current bucket only (Welford), and a window is the
+// merge of its buckets, so memory is fixed and the cost per sample is constant.  The window rolls one bucket at a time,
+// so it spans between 11/12 and 12/12 of its length.
+boolean EnableStatistics = true; // Set to true to run the Sampler and keep rolling statistics
+
+enum StatsMetric
+{
+  STATS_LineVoltage,
+  STATS_LineCurrent,
+  STATS_ActivePower,
+  STATS_LineFrequency,
+  STATS_PowerFactor,
+  STATS_Metrics
+};
+
+enum StatsWindowId
+{
+  STATS_1s,
+  STATS_1min,
+  STATS_15min,
+  STATS_Windows
+};
+
+const char *StatsMetricName[STATS_Metrics] = {"Line Voltage", "Line Current", "Active Power", "Line Frequency", "Power Factor"};
+const char *StatsMetricKey[STATS_Metrics] = {"v", "i", "p", "f", "pf"};
+const char *StatsWindowName[STATS_Windows] = {"1s", "1min", "15min"};
+const uint32_t StatsWindowTime[STATS_Windows] = {1000, 60000, 900000}; // ms
+const int StatsBuckets = 12;                                            // Buckets per window
+
+// Partial Welford aggregate
+struct StatsBucket
+{
+  uint32_t Count;
+  float Mean;
+  float M2; // Sum of squared differences from the Mean
+  float Min;
+  float Max;
+};
+
+struct StatsWindow
+{
+  uint32_t Start; // millis() at start of current bucket
+  uint8_t Current;
+  StatsBucket Buckets[StatsBuckets];
+};
+
+// Query Result
+struct StatsResult
+{
+  uint32_t Count;
+  float Mean;
+  float StdDev;
+  float Min;
+  float Max;
+};
+
+StatsWindow Statistics[STATS_Metrics][STATS_Windows];
+portMUX_TYPE StatisticsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Add one value to a Bucket (Welford)
+void StatsBucketAdd(StatsBucket &b, float Value)
+{
+  b.Count++;
+  float Delta = Value - b.Mean;
+  b.Mean += Delta / b.Count;
+  b.M2 += Delta * (Value - b.Mean);
+  if (b.Count == 1 || Value < b.Min)
+    b.Min = Value;
+  if (b.Count == 1 || Value > b.Max)
+    b.Max = Value;
+}
+
+// Merge Bucket b into a (Chan et al. parallel variance)
+void StatsBucketMerge(StatsBucket &a, const StatsBucket &b)
+{
+  if (b.Count == 0)
+    return;
+  if (a.Count == 0)
+  {
+    a = b;
+    return;
+  }
+
+  uint32_t Count = a.Count + b.Count;
+  float Delta = b.Mean - a.Mean;
+  a.Mean += Delta * b.Count / Count;
+  a.M2 += b.M2 + Delta * Delta * ((float)a.Count * b.Count / Count);
+  a.Min = min(a.Min, b.Min);
+  a.Max = max(a.Max, b.Max);
+  a.Count = Count;
+}
+
+// Add Value at Time to a Window, rolling on any buckets that have expired
+void StatsWindowAdd(StatsWindow &w, uint32_t BucketTime, uint32_t Time, float Value)
+{
+  uint32_t Elapsed = (Time - w.Start) / BucketTime;
+  if (Elapsed > 0)
+  {
+    for (uint32_t i = 0; i < Elapsed && i < StatsBuckets; i++)
+    {
+      w.Current = (w.Current + 1) % StatsBuckets;
+      w.Buckets[w.Current].Count = 0;
+      w.Buckets[w.Current].Mean = 0;
+      w.Buckets[w.Current].M2 = 0;
+    }
+    w.Start += Elapsed * BucketTime;
+  }
+  StatsBucketAdd(w.Buckets[w.Current], Value);
+}
+
+// Add a Snapshot to every Window.  Snapshot Listener, runs in the Processor Task.
+void StatisticsAddSnapshot(const GTEM_Snapshot &snap)
+{
+  if (snap.Flags & SNAP_RangeSwitch)
+    return;
+
+  const float Values[STATS_Metrics] = {snap.LineVoltage, snap.LineCurrent, snap.ActivePower, snap.LineFrequency, snap.PowerFactor};
+
+  portENTER_CRITICAL(&StatisticsMux);
+  for (int m = 0; m < STATS_Metrics; m++)
+  {
+    for (int w = 0; w < STATS_Windows; w++)
+      StatsWindowAdd(Statistics[m][w], StatsWindowTime[w] / StatsBuckets, snap.Timestamp, Values[m]);
+  }
+  portEXIT_CRITICAL(&StatisticsMux);
+}
+
+// Statistics of one Metric over one Window
+void GetStatistics(int Metric, int Window, StatsResult &Result)
+{
+  StatsBucket Total = {};
+  StatsWindow &w = Statistics[Metric][Window];
+  uint32_t BucketTime = StatsWindowTime[Window] / StatsBuckets;
+
+  portENTER_CRITICAL(&StatisticsMux);
+  // Buckets older than the window (no samples for a while) are skipped
+  uint32_t Age = (millis() - w.Start) / BucketTime;
+  for (int i = Age; i < StatsBuckets; i++)
+    StatsBucketMerge(Total, w.Buckets[(w.Current + StatsBuckets - i + Age) % StatsBuckets]);
+  portEXIT_CRITICAL(&StatisticsMux);
+
+  Result.Count = Total.Count;
+  Result.Mean = Total.Mean;
+  Result.StdDev = Total.Count > 1 ? sqrtf(Total.M2 / (Total.Count - 1)) : 0;
+  Result.Min = Total.Min;
+  Result.Max = Total.Max;
+}
+
+// Mean of one Metric over one Window, or Default if there is none (Statistics off, no Window, or no samples yet)
+float GetStatisticsMean(int Metric, int Window, float Default)
+{
+  StatsResult r;
+  if (EnableStatistics == false || Window < 0 || Window >= STATS_Windows)
+    return Default;
+  GetStatistics(Metric, Window, r);
+  return r.Count > 0 ? r.Mean : Default;
+}
+
+// Initialise Statistics.  Start before the Sampler Task.
+void InitialiseStatistics()
+{
+  uint32_t Now = millis();
+  for (int m = 0; m < STATS_Metrics; m++)
+  {
+    for (int w = 0; w < STATS_Windows; w++)
+      Statistics[m][w].Start = Now;
+  }
+  AddSnapshotListener(StatisticsAddSnapshot);
+}
+
+// Statistics as JSON.  {"v":{"1s":{"n":10,"mean":247.1,"sd":0.05,"min":247.0,"max":247.2},...},...}
+int FormatStatisticsJSON(char *Out, size_t Size)
+{
+  StatsResult r;
+  int Length = snprintf(Out, Size, "{");
+
+  for (int m = 0; m < STATS_Metrics && Length < (int)Size; m++)
+  {
+    Length += snprintf(Out + Length, Size - Length, "%s\"%s\":{", m ? "," : "", StatsMetricKey[m]);
+    for (int w = 0; w < STATS_Windows && Length < (int)Size; w++)
+    {
+      GetStatistics(m, w, r);
+      Length += snprintf(Out + Length, Size - Length, "%s\"%s\":{\"n\":%u,\"mean\":%.4f,\"sd\":%.4f,\"min\":%.4f,\"max\":%.4f}",
+                         w ? "," : "", StatsWindowName[w], (unsigned)r.Count, r.Mean, r.StdDev, r.Min, r.Max);
+    }
+    if (Length < (int)Size)
+      Length += snprintf(Out + Length, Size - Length, "}");
+  }
+  if (Length < (int)Size)
+    Length += snprintf(Out + Length, Size - Length, "}");
+
+  return Length < (int)Size ? Length : 0;
+}
+
+// Display Statistics Table
+void DisplayStatistics(Print &Out = Serial)
+{
+  StatsResult r;
+
+  Out.println("Statistics \t\t\tWindow\tCount\tMean\t\tStdDev\t\tMin\t\tMax");
+  for (int m = 0; m < STATS_Metrics; m++)
+  {
+    for (int w = 0; w < STATS_Windows; w++)
+    {
+      GetStatistics(m, w, r);
+      Out.printf("%-16s \t\t%s\t%u\t%-10.3f\t%-10.3f\t%-10.3f\t%-10.3f\n", w ? "" : StatsMetricName[m], StatsWindowName[w], (unsigned)r.Count, r.Mean, r.StdDev, r.Min, r.Max);
+    }
+  }
+}
@@ -0,0 +1,200 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <Arduino.h>
+#include <dirent.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Filter Trace Checks.  Runs Register Traces (tools/gtem_trace.py CSV) through each Metric's Filter chain (Filters.h) with
+// the default Settings, and checks what the chain is there for:
+//   Noise     - The filtered value moves less from sample to sample than the raw value
+//   Spikes    - A single sample spike (away from both neighbours by FilterSpikeSteps typical steps) does not reach the output
+//   Deadzone  - The filtered value changes between zero and not zero no more often than the raw value crosses the Deadzone
+//   Tracking  - The last 10 filtered values settle within 2% (or 3 typical steps) of the median of the last 10 raw values
+// native/traces holds standby, spikes with a load step, and export flips.  A board capture (gtem_trace.py capture.bin
+// -o trace.csv) can be added there, and is checked the same way.
+const int FilterTraceMax = 4000;    // Samples per Metric
+const float FilterSpikeSteps = 8.0; // Spike size, in typical (median) steps
+
+struct FilterTrace
+{
+  int Count;
+  float Raw[FilterTraceMax];
+  float Filtered[FilterTraceMax];
+};
+
+FilterTrace FilterTraces[STATS_Metrics];
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Metric of a register Address, or -1
+int FilterTraceMetric(int Address)
+{
+  switch (Address)
+  {
+  case Urms:
+    return STATS_LineVoltage;
+  case Irms:
+    return STATS_LineCurrent;
+  case Pmean:
+    return STATS_ActivePower;
+  case Freq:
+    return STATS_LineFrequency;
+  case PowerF:
+    return STATS_PowerFactor;
+  }
+  return -1;
+}
+
+// Load the reads of each Metric from a trace CSV.  time_us,op,address,register,raw,value,unit,core
+boolean LoadFilterTrace(const char *Path)
+{
+  FILE *File = fopen(Path, "r");
+  if (File == NULL)
+    return false;
+
+  char Line[160];
+  memset(FilterTraces, 0, sizeof(FilterTraces));
+  while (fgets(Line, sizeof(Line), File) != NULL)
+  {
+    char *Fields[8];
+    int n = 0;
+    for (char *Field = strtok(Line, ",\r\n"); Field != NULL && n < 8; Field = strtok(NULL, ",\r\n"))
+      Fields[n++] = Field;
+    if (n < 6 || strcmp(Fields[1], "R") != 0)
+      continue;
+
+    int Metric = FilterTraceMetric(strtol(Fields[2], NULL, 16));
+    if (Metric >= 0 && FilterTraces[Metric].Count < FilterTraceMax)
+      FilterTraces[Metric].Raw[FilterTraces[Metric].Count++] = atof(Fields[5]);
+  }
+  fclose(File);
+  return true;
+}
+
+// Median of Count values
+float FilterTraceMedian(const float *Values, int Count)
+{
+  static float Sorted[FilterTraceMax];
+  memcpy(Sorted, Values, Count * sizeof(float));
+  std::sort(Sorted, Sorted + Count);
+  return Count % 2 ? Sorted[Count / 2] : (Sorted[Count / 2 - 1] + Sorted[Count / 2]) / 2;
+}
+
+// Check one Metric of the loaded trace.  Prints a row, returns true if it passes.
+boolean CheckFilterTrace(const char *Name, int Metric)
+{
+  FilterTrace &t = FilterTraces[Metric];
+  const FilterConfig &Filter = Config.Filters[Metric];
+  FilterState State = {};
+  static float Steps[FilterTraceMax];
+  int n = t.Count;
+
+  for (int i = 0; i < n; i++)
+    t.Filtered[i] = FilterApply(Filter, State, t.Raw[i]);
+
+  // Noise.  Mean step, raw and filtered
+  double RawMoves = 0;
+  double FilteredMoves = 0;
+  for (int i = 1; i < n; i++)
+  {
+    Steps[i - 1] = fabsf(t.Raw[i] - t.Raw[i - 1]);
+    RawMoves += Steps[i - 1];
+    FilteredMoves += fabsf(t.Filtered[i] - t.Filtered[i - 1]);
+  }
+  float Step = FilterTraceMedian(Steps, n - 1);
+  float Noise = RawMoves > 0 ? FilteredMoves / RawMoves : 0;
+
+  // Spikes, and those that reached the output
+  int Spikes = 0;
+  int Passed = 0;
+  for (int i = 1; i < n - 1; i++)
+  {
+    float Before = t.Raw[i] - t.Raw[i - 1];
+    float After = t.Raw[i] - t.Raw[i + 1];
+    float Size = min(fabsf(Before), fabsf(After));
+    if ((Before > 0) != (After > 0) || Size <= FilterSpikeSteps * Step || Size == 0)
+      continue;
+    Spikes++;
+    if (fabsf(t.Filtered[i] - t.Filtered[i - 1]) > Size / 2)
+      Passed++;
+  }
+
+  // Deadzone flicker
+  int RawFlips = 0;
+  int Flips = 0;
+  for (int i = 1; i < n && Filter.Deadzone > 0; i++)
+  {
+    RawFlips += (fabsf(t.Raw[i]) < Filter.Deadzone) != (fabsf(t.Raw[i - 1]) < Filter.Deadzone);
+    Flips += (t.Filtered[i] == 0) != (t.Filtered[i - 1] == 0);
+  }
+
+  // Tracking.  Not checked when the level sits in the Deadzone.
+  int Tail = min(n, 10);
+  float Level = FilterTraceMedian(t.Raw + n - Tail, Tail);
+  float Settled = 0;
+  for (int i = n - Tail; i < n; i++)
+    Settled += t.Filtered[i] / Tail;
+  boolean Tracked = fabsf(Level) < Filter.Deadzone + Filter.Hysteresis || fabsf(Settled - Level) <= max(0.02f * fabsf(Level), 3 * Step);
+
+  boolean Pass = Noise <= 1.0 && Passed == 0 && Flips <= RawFlips && Tracked;
+  Serial.printf("%-14s %-16s %7d %7d %7d %6d %6d %7.2f %8s   %s\n", Name, StatsMetricName[Metric], n, Spikes, Passed, RawFlips, Flips, Noise,
+                Tracked ? "yes" : "NO", Pass ? "ok" : "FAIL");
+  return Pass;
+}
+
+// Check every trace in a directory.  Returns the failures.
+int RunFilterTraces(const char *Directory)
+{
+  int Failures = 0;
+  int Traces = 0;
+  DIR *Dir = opendir(Directory);
+  if (Dir == NULL)
+  {
+    Serial.printf("No trace directory %s\n", Directory);
+    return 1;
+  }
+
+  Serial.println("Trace          Metric           Samples  Spikes  Passed  Raw Flips Flips   Noise  Tracked");
+  for (struct dirent *Entry = readdir(Dir); Entry != NULL; Entry = readdir(Dir))
+  {
+    size_t Length = strlen(Entry->d_name);
+    if (Length < 5 || strcmp(Entry->d_name + Length - 4, ".csv") != 0)
+      continue;
+
+    char Path[512];
+    snprintf(Path, sizeof(Path), "%s/%s", Directory, Entry->d_name);
+    if (!LoadFilterTrace(Path))
+    {
+      Serial.printf("%-14s cannot be read\n", Entry->d_name);
+      Failures++;
+      continue;
+    }
+    Traces++;
+    for (int m = 0; m < STATS_Metrics; m++)
+    {
+      if (FilterTraces[m].Count > 1 && !CheckFilterTrace(Entry->d_name, m))
+        Failures++;
+    }
+  }
+  closedir(Dir);
+
+  if (Traces == 0)
+    Failures++;
+  Serial.printf("%d traces, %d failures\n", Traces, Failures);
+  return Failures;
+}
@@ -0,0 +1,100 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Libraries
+#include <Arduino.h>
+#include <math.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// NTC Table Check.  NTCTable.h checks the Table at compile time, at the middle of each step only, against its own
+// compile time log.  Here every ADC code, and the quarter codes between them, is read through NTCTemperature() as
+// ReadTemperature() does, and compared with the Steinhart-Hart equation using the C library log().
+const float NTCCheckLimit = 0.1;    // ºC.  Largest difference allowed from -20 to 100 ºC, as NTCTable.h
+const int NTCCheckSubSteps = 4;     // Readings per ADC code
+const int NTCCheckShowStep = 256;   // ADC codes between the rows shown
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Steinhart-Hart with the C library log(), clamped as NTCReference()
+double NTCLibraryReference(double Code)
+{
+  if (Code <= 0)
+    return NTC_TMin;
+  double R = NTCResistance(Code);
+  if (R <= NTC_RMin)
+    return NTC_TMax;
+  return NTCClamp(NTCSteinhartHart(log(R)));
+}
+
+// Check the Table at every code.  Returns the failures.
+int RunNTCCheck()
+{
+  int Failures = 0;
+  double MaxError = 0;
+  double MaxErrorCode = 0;
+  double MaxErrorAll = 0;
+  double MaxLnError = 0;
+  float Last = NTC_TMin;
+
+  Serial.println("ADC     Table ºC   Reference ºC   Difference");
+  for (int i = 0; i <= (NTC_ADCMax + 1) * NTCCheckSubSteps; i++)
+  {
+    double Code = (double)i / NTCCheckSubSteps;
+    float Table = NTCTemperature(Code);
+    double Reference = NTCLibraryReference(Code);
+    double Error = fabs(Table - Reference);
+
+    if (Code > 0 && NTCResistance(Code) > NTC_RMin)
+      MaxLnError = max(MaxLnError, fabs(ConstLn(NTCResistance(Code)) - log(NTCResistance(Code))));
+    MaxErrorAll = max(MaxErrorAll, Error);
+    if (Reference >= -20 && Reference <= 100 && Error > MaxError)
+    {
+      MaxError = Error;
+      MaxErrorCode = Code;
+    }
+    if (Table < Last)
+    {
+      Serial.printf("FAIL  Table falls at ADC %.2f, %.3f to %.3f ºC\n", Code, Last, Table);
+      Failures++;
+    }
+    Last = Table;
+
+    if (i % (NTCCheckShowStep * NTCCheckSubSteps) == 0)
+      Serial.printf("%-7.0f %8.3f   %12.3f   %10.4f\n", Code, Table, Reference, Table - Reference);
+  }
+
+  // Ends and clamping
+  struct
+  {
+    float Code;
+    float Expected;
+  } Ends[] = {{-100, NTC_TMin}, {0, NTC_TMin}, {NTC_ADCMax, NTC_TMax}, {NTC_ADCMax + 1, NTC_TMax}, {10000, NTC_TMax}};
+  for (auto &End : Ends)
+  {
+    if (NTCTemperature(End.Code) != End.Expected)
+    {
+      Serial.printf("FAIL  ADC %.0f reads %.3f ºC, expected %.0f ºC\n", End.Code, NTCTemperature(End.Code), End.Expected);
+      Failures++;
+    }
+  }
+
+  if (MaxError >= NTCCheckLimit)
+    Failures++;
+  Serial.printf("Largest difference -20 to 100 ºC %.4f ºC at ADC %.2f (limit %.2f), anywhere %.4f ºC, compile time log %.2g from log()\n", MaxError,
+                MaxErrorCode, NTCCheckLimit, MaxErrorAll, MaxLnError);
+  Serial.printf("NTC Table %s\n", Failures ? "FAIL" : "ok");
+  return Failures;
+}
@@ -0,0 +1,185 @@
+// Host Arduino Core for the native build.  Only what the GTEM modules use.  Serial writes to stdout.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#define HEX 16
+#define DEC 10
+#define SERIAL_8N1 0
+#define PI 3.1415926535897932384626433832795
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define PROGMEM
+#define IRAM_ATTR
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define digitalPinToInterrupt(p) (p)
+
+using std::max;
+using std::min;
+template <typename T> T constrain(T x, T a, T b) { return x < a ? a : (x > b ? b : x); }
+
+inline size_t strlcpy(char *d, const char *s, size_t n)
+{
+  size_t l = strlen(s);
+  if (n)
+  {
+    size_t c = l < n - 1 ? l : n - 1;
+    memcpy(d, s, c);
+    d[c] = 0;
+  }
+  return l;
+}
+
+class String
+{
+public:
+  String(const char *c = "") : s(c) {}
+  String(const std::string &c) : s(c) {}
+  String(int v, int base = DEC) : s(base == HEX ? Format("%X", v) : std::to_string(v)) {}
+  String(unsigned v, int base = DEC) : s(base == HEX ? Format("%X", v) : std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+  String(double v, int d = 2) : s(Format("%.*f", d, v)) {}
+  const char *c_str() const { return s.c_str(); }
+  size_t length() const { return s.size(); }
+  String substring(size_t a) const { return s.substr(a); }
+  String substring(size_t a, size_t b) const { return s.substr(a, b - a); }
+  int indexOf(char c) const { return (int)s.find(c); }
+  int toInt() const { return atoi(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  bool equals(const char *o) const { return s == o; }
+  bool equalsIgnoreCase(const char *o) const { return strcasecmp(s.c_str(), o) == 0; }
+  bool startsWith(const char *o) const { return s.compare(0, strlen(o), o) == 0; }
+  void concat(const String &o) { s += o.s; }
+  void trim() {}
+  void toUpperCase() { std::transform(s.begin(), s.end(), s.begin(), ::toupper); }
+  void replace(const char *a, const char *b)
+  {
+    for (size_t i = 0; *a && (i = s.find(a, i)) != std::string::npos; i += strlen(b))
+      s.replace(i, strlen(a), b);
+  }
+  char operator[](size_t i) const { return s[i]; }
+  String operator+(const String &o) const { return s + o.s; }
+  String operator+(const char *o) const { return s + o; }
+  String &operator+=(const String &o) { s += o.s; return *this; }
+  String &operator+=(const char *o) { s += o; return *this; }
+  String &operator+=(char o) { s += o; return *this; }
+  bool operator==(const char *o) const { return s == o; }
+  bool operator==(const String &o) const { return s == o.s; }
+
+private:
+  std::string s;
+  template <typename T> static std::string Format(const char *f, T v) { char b[32]; snprintf(b, sizeof(b), f, v); return b; }
+  static std::string Format(const char *f, int d, double v) { char b[64]; snprintf(b, sizeof(b), f, d, v); return b; }
+};
+inline String operator+(const char *a, const String &b) { return String(a) + b; }
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  virtual size_t write(const uint8_t *b, size_t n) = 0;
+  size_t write(const char *t) { return write((const uint8_t *)t, strlen(t)); }
+  size_t write(const char *t, size_t n) { return write((const uint8_t *)t, n); }
+  size_t printf(const char *f, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char b[1024];
+    va_list a;
+    va_start(a, f);
+    int n = vsnprintf(b, sizeof(b), f, a);
+    va_end(a);
+    return write((const uint8_t *)b, min(n, (int)sizeof(b) - 1));
+  }
+  size_t print(const char *t) { return write(t); }
+  size_t print(const String &t) { return write(t.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC) { return printf(base == HEX ? "%X" : "%d", v); }
+  size_t print(unsigned v, int base = DEC) { return printf(base == HEX ? "%X" : "%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int d = 2) { return printf("%.*f", d, v); }
+  size_t println() { return write("\n"); }
+  template <typename T> size_t println(const T &v) { return print(v) + println(); }
+  template <typename T> size_t println(const T &v, int f) { return print(v, f) + println(); }
+  virtual int availableForWrite() { return 4096; }
+  virtual void flush() {}
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  size_t readBytes(uint8_t *b, size_t n) { return 0; }
+  size_t readBytes(char *b, size_t n) { return 0; }
+  size_t write(const uint8_t *b, size_t n) { return n; }
+  using Print::write;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long, int = 0) {}
+  size_t setTxBufferSize(size_t n) { return n; }
+  size_t setRxBufferSize(size_t n) { return n; }
+  size_t write(const uint8_t *b, size_t n) { return fwrite(b, 1, n, stdout); }
+  using Print::write;
+  void flush() { fflush(stdout); }
+  operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+unsigned long millis();
+unsigned long micros();
+void yield();
+void pinMode(uint8_t, uint8_t);
+void digitalWrite(uint8_t, uint8_t);
+int digitalRead(uint8_t);
+uint16_t analogRead(uint8_t);
+void attachInterrupt(uint8_t, void (*)(void), int);
+void detachInterrupt(uint8_t);
+void configTime(long, int, const char *, const char * = NULL, const char * = NULL);
+
+// Cycle Counter at a nominal 240 MHz, from the host clock, so cycle based timings read in ns as on the ESP32
+class EspClass
+{
+public:
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint64_t getEfuseMac() { return 0; }
+  uint32_t getFreeHeap() { return 0; }
+  void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+#include <pgmspace.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
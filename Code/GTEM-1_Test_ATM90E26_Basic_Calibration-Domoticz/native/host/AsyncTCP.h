@@ -0,0 +1,3 @@
+// Host AsyncTCP for the native build
+#pragma once
+#include <Arduino.h>
@@ -0,0 +1,89 @@
+// Host ESPAsyncWebServer for the native build.  Serves nothing; no client ever connects.
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <AsyncTCP.h>
+
+enum WebRequestMethod
+{
+  HTTP_GET = 1,
+  HTTP_POST = 2,
+  HTTP_ANY = 3
+};
+enum AwsEventType
+{
+  WS_EVT_CONNECT,
+  WS_EVT_DISCONNECT,
+  WS_EVT_PONG,
+  WS_EVT_ERROR,
+  WS_EVT_DATA
+};
+enum AwsClientStatus
+{
+  WS_DISCONNECTED,
+  WS_CONNECTED,
+  WS_DISCONNECTING
+};
+
+class AsyncWebServerResponse
+{
+public:
+  void addHeader(const String &, const String &) {}
+};
+typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebServerRequest
+{
+public:
+  AsyncWebServerResponse *beginResponse(const String &, size_t, AwsResponseFiller) { return &Response; }
+  AsyncWebServerResponse *beginResponse(int, const String &, const String &) { return &Response; }
+  AsyncWebServerResponse *beginResponse_P(int, const String &, const uint8_t *, size_t) { return &Response; }
+  void send(AsyncWebServerResponse *) {}
+  void send(int, const String &, const String &) {}
+
+private:
+  AsyncWebServerResponse Response;
+};
+
+class AsyncWebSocket;
+class AsyncWebSocketClient
+{
+public:
+  uint32_t id() { return 0; }
+  AwsClientStatus status() { return WS_DISCONNECTED; }
+  bool queueIsFull() { return false; }
+  bool canSend() { return false; }
+  void text(const char *, size_t) {}
+  void text(const char *) {}
+  void binary(const uint8_t *, size_t) {}
+  void close(uint16_t = 0, const char * = NULL) {}
+  IPAddress remoteIP() { return IPAddress(); }
+};
+
+typedef std::function<void(AsyncWebSocket *, AsyncWebSocketClient *, AwsEventType, void *, uint8_t *, size_t)> AwsEventHandler;
+typedef std::function<void(AsyncWebServerRequest *)> ArRequestHandlerFunction;
+
+class AsyncWebHandler
+{
+};
+
+class AsyncWebSocket : public AsyncWebHandler
+{
+public:
+  AsyncWebSocket(const String &) {}
+  void onEvent(AwsEventHandler) {}
+  AsyncWebSocketClient *client(uint32_t) { return NULL; }
+  void cleanupClients(uint16_t = 8) {}
+  size_t count() const { return 0; }
+  void textAll(const char *, size_t) {}
+  void binaryAll(const uint8_t *, size_t) {}
+};
+
+class AsyncWebServer
+{
+public:
+  AsyncWebServer(uint16_t) {}
+  void begin() {}
+  void addHandler(AsyncWebHandler *) {}
+  void on(const char *, WebRequestMethod, ArRequestHandlerFunction) {}
+};
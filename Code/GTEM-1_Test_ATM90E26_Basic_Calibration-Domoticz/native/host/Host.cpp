@@ -0,0 +1,84 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Host Arduino Core and FreeRTOS for the native build (native/main.cpp).  One thread; tasks are never started.
+
+// Libraries
+#include <Arduino.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <WiFi.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+HardwareSerial Serial;
+EspClass ESP;
+SPIClass SPI;
+TwoWire Wire;
+WiFiClass WiFi;
+
+static int HostMutex; // Any non NULL handle
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+static uint64_t HostNanos()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+int64_t esp_timer_get_time() { return HostNanos() / 1000; }
+unsigned long millis() { return HostNanos() / 1000000; }
+unsigned long micros() { return HostNanos() / 1000; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(HostNanos() * 240 / 1000); }
+
+void delay(uint32_t ms)
+{
+  struct timespec t = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+  nanosleep(&t, NULL);
+}
+void delayMicroseconds(uint32_t us) { delay(us / 1000); }
+void yield() {}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return HIGH; }
+uint16_t analogRead(uint8_t) { return 0; }
+void attachInterrupt(uint8_t, void (*)(void), int) {}
+void detachInterrupt(uint8_t) {}
+void configTime(long, int, const char *, const char *, const char *) {}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *Handle, BaseType_t)
+{
+  if (Handle != NULL)
+    *Handle = NULL;
+  return pdPASS;
+}
+void vTaskDelete(TaskHandle_t) {}
+void vTaskDelay(TickType_t Ticks) { delay(Ticks); }
+void vTaskDelayUntil(TickType_t *Last, TickType_t Ticks) { *Last += Ticks; }
+TickType_t xTaskGetTickCount() { return millis(); }
+BaseType_t xPortGetCoreID() { return 1; }
+void xTaskNotifyGive(TaskHandle_t) {}
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return &HostMutex; }
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return &HostMutex; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t) { return pdTRUE; }
@@ -0,0 +1,12 @@
+// Host IPAddress for the native build
+#pragma once
+#include <Arduino.h>
+
+class IPAddress
+{
+public:
+  IPAddress() {}
+  IPAddress(uint8_t, uint8_t, uint8_t, uint8_t) {}
+  String toString() const { return "0.0.0.0"; }
+  bool fromString(const char *) { return true; }
+};
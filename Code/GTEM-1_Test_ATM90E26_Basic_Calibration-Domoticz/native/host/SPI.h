@@ -0,0 +1,26 @@
+// Host SPI for the native build.  Nothing is attached; the Energy IC is simulated by a Transport instead.
+#pragma once
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE3 3
+#define SPI_CLOCK_DIV16 16
+
+class SPISettings
+{
+public:
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass
+{
+public:
+  void begin() {}
+  void setBitOrder(int) {}
+  void setDataMode(int) {}
+  void setClockDivider(int) {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t) { return 0; }
+};
+extern SPIClass SPI;
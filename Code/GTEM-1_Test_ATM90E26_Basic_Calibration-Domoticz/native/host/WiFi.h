@@ -0,0 +1,58 @@
+// Host WiFi for the native build.  Never connects, so the network outputs stay idle.
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#define WL_CONNECTED 3
+#define WIFI_STA 1
+
+class Client : public Stream
+{
+public:
+  virtual int connect(const char *, uint16_t) { return 0; }
+  virtual int connect(const char *, uint16_t, int32_t) { return 0; }
+  virtual int connect(IPAddress, uint16_t) { return 0; }
+  virtual uint8_t connected() { return 0; }
+  virtual void stop() {}
+  int read(uint8_t *, size_t) { return 0; }
+  using Stream::read;
+  using Stream::write;
+  void setNoDelay(bool) {}
+  void setTimeout(uint32_t) {}
+  IPAddress remoteIP() { return IPAddress(); }
+  operator bool() { return false; }
+};
+
+class WiFiClient : public Client
+{
+};
+
+class WiFiServer
+{
+public:
+  WiFiServer(uint16_t = 80, uint8_t = 4) {}
+  void begin() {}
+  bool hasClient() { return false; }
+  WiFiClient available() { return WiFiClient(); }
+  WiFiClient accept() { return WiFiClient(); }
+  void setNoDelay(bool) {}
+};
+
+class WiFiClass
+{
+public:
+  int status() { return 0; }
+  String macAddress() { return "00:00:00:00:00:00"; }
+  void setHostname(const char *) {}
+  const char *getHostname() { return "gtem-native"; }
+  void begin(const char *, const char *) {}
+  void mode(int) {}
+  void setAutoReconnect(bool) {}
+  void persistent(bool) {}
+  void disconnect() {}
+  IPAddress localIP() { return IPAddress(); }
+  IPAddress gatewayIP() { return IPAddress(); }
+  IPAddress subnetMask() { return IPAddress(); }
+  int RSSI() { return 0; }
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,14 @@
+// Host I2C for the native build.  Nothing is attached.
+#pragma once
+#include <Arduino.h>
+
+class TwoWire : public Stream
+{
+public:
+  bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+  void beginTransmission(uint8_t) {}
+  uint8_t endTransmission(bool = true) { return 0; }
+  uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+  void setClock(uint32_t) {}
+};
+extern TwoWire Wire;
@@ -0,0 +1,5 @@
+// Host esp_timer for the native build.  Monotonic us.
+#pragma once
+#include <stdint.h>
+
+int64_t esp_timer_get_time();
@@ -0,0 +1,28 @@
+// Host FreeRTOS for the native build.  One thread, so critical sections and locks hold nothing.
+#pragma once
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct
+{
+  int Count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(m) (void)(m)
+#define portEXIT_CRITICAL(m) (void)(m)
+#define portENTER_CRITICAL_ISR(m) (void)(m)
+#define portEXIT_CRITICAL_ISR(m) (void)(m)
+#define portYIELD_FROM_ISR(x) (void)(x)
+
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdMS_TO_TICKS(x) (x)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define tskIDLE_PRIORITY 0
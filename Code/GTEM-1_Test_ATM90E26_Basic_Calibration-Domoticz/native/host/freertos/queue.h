@@ -0,0 +1,3 @@
+// Host FreeRTOS Queues for the native build
+#pragma once
+#include <freertos/FreeRTOS.h>
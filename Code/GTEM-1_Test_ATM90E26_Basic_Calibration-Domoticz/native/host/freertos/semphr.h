@@ -0,0 +1,11 @@
+// Host FreeRTOS Semaphores for the native build.  Always free.
+#pragma once
+#include <freertos/FreeRTOS.h>
+
+typedef void *SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t);
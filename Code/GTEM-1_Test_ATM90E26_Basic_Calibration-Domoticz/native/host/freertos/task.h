@@ -0,0 +1,14 @@
+// Host FreeRTOS Tasks for the native build.  Tasks are not started; the native program calls what it times directly.
+#pragma once
+#include <freertos/FreeRTOS.h>
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *, BaseType_t);
+void vTaskDelete(TaskHandle_t);
+void vTaskDelay(TickType_t);
+void vTaskDelayUntil(TickType_t *, TickType_t);
+TickType_t xTaskGetTickCount();
+BaseType_t xPortGetCoreID();
+void xTaskNotifyGive(TaskHandle_t);
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *);
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t);
+#define taskYIELD() ((void)0)
@@ -0,0 +1,9 @@
+// Host pgmspace for the native build.  Flash is RAM.
+#pragma once
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_float(p) (*(const float *)(p))
+#define pgm_read_ptr(p) (*(void *const *)(p))
+#define PSTR(s) (s)
+#define F(s) (s)
@@ -0,0 +1,15 @@
+// Host ESP32 ROM CRC32 for the native build.  Same polynomial and conventions as crc32_le() in ROM.
+#pragma once
+#include <stdint.h>
+
+static inline uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++)
+  {
+    crc ^= buf[i];
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
@@ -0,0 +1,16 @@
+// Host EEPROM for the native build.  24LC64 sized, held in RAM and erased (0xFF) at start.
+#pragma once
+#include <Wire.h>
+
+class serialEEPROM
+{
+public:
+  serialEEPROM(uint8_t, uint16_t, uint8_t) { memset(mem, 0xFF, sizeof(mem)); }
+  uint8_t read(uint16_t a) { return mem[a % sizeof(mem)]; }
+  void read(uint16_t a, uint8_t *b, uint16_t n) { for (int i = 0; i < n; i++) b[i] = mem[(a + i) % sizeof(mem)]; }
+  void write(uint16_t a, uint8_t v) { mem[a % sizeof(mem)] = v; }
+  void write(uint16_t a, uint8_t *b, uint16_t n) { for (int i = 0; i < n; i++) mem[(a + i) % sizeof(mem)] = b[i]; }
+
+private:
+  uint8_t mem[8192];
+};
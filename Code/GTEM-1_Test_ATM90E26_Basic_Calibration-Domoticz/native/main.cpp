@@ -0,0 +1,101 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+// Native Build.  The firmware paths on the PC, with no board, for quick comparison between changes.
+//   pio run -e native && .pio/build/native/program           Benchmark, Replay of each Scenario, Filter Traces and NTC
+//   .pio/build/native/program bench                          Benchmark only, one line of JSON as 'bench' on the board
+//   .pio/build/native/program replay                         Replay only, one line of JSON per Scenario as 'replay'
+//   .pio/build/native/program filters [native/traces]        Filter chain checks on each Register Trace (FilterTraces.h)
+//   .pio/build/native/program ntc                            NTC Table against Steinhart-Hart at every ADC code (NTCCheck.h)
+// The ATM90E26 is the Replay Transport's simulated register file (Replay.h).  Replay digests are checked against
+// tools/replay_native.json by tools/gtem_replay.py.  Host timings are not board timings; compare like with like.
+
+// Libraries
+#include <Arduino.h>
+#include <SPI.h>
+#include <Instrument.h>
+#include <Logger.h>
+#include <GTEM-EEPROM.h>
+#include <ConfigStore.h>
+#include <EnergyATM90E26.h>
+#include <GTEM-1_Defaults.h>
+#include <EnergyHealth.h>
+#include <Domoticz.h>
+#include <Snapshot.h>
+#include <RegisterTrace.h>
+#include <Statistics.h>
+#include <Filters.h>
+#include <AdaptiveRate.h>
+#include <NTCTable.h>
+#include <LiveStream.h>
+#include <InfluxDB.h>
+#include <ModbusTCP.h>
+#include <Benchmark.h>
+#include <Replay.h>
+#include "FilterTraces.h"
+#include "NTCCheck.h"
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES ****************
+
+// App
+String AppVersion = "GTEM Test 230510 native";
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Benchmark, on the simulated ATM90E26
+void NativeBenchmark()
+{
+  static ATM90E26_Replay ic;
+  ReplayLoad Load;
+  boolean First = true;
+
+  ReplaySeed = 0x47544D31; // "GTM1"
+  ReplayMains(Load, 240, 1200, 0.95);
+  ReplaySetLoad(Load, 1000);
+
+  Serial.printf("{\"benchmark\":\"GTEM\",\"version\":\"%s\",\"cpu_mhz\":0,\"results\":[", AppVersion.c_str());
+  BenchmarkPaths(ic, First);
+  Serial.println("]}");
+}
+
+// Replay each generated Scenario.  The trace Scenario needs a Register Trace from a board.
+void NativeReplay()
+{
+  for (size_t i = 0; i < sizeof(ReplayScenarios) / sizeof(ReplayScenarios[0]); i++)
+  {
+    if (ReplayScenarios[i].Generator != NULL)
+      RunReplay(ReplayScenarios[i], AppVersion.c_str());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const char *Mode = argc > 1 ? argv[1] : "all";
+
+  ConfigDefaults(Config);
+
+  if (strcmp(Mode, "all") == 0 || strcmp(Mode, "bench") == 0)
+    NativeBenchmark();
+  if (strcmp(Mode, "all") == 0 || strcmp(Mode, "replay") == 0)
+    NativeReplay();
+  int Failures = 0;
+  if (strcmp(Mode, "all") == 0 || strcmp(Mode, "filters") == 0)
+    Failures += RunFilterTraces(argc > 2 ? argv[2] : "native/traces");
+  if (strcmp(Mode, "all") == 0 || strcmp(Mode, "ntc") == 0)
+    Failures += RunNTCCheck();
+
+  Serial.flush();
+  return Failures ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Full header information in main.cpp.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+// Libraries
+#include <Instrument.h>
+
+LatencyHistogram Latency[LAT_Count] = {
+    LatencyHistogram("CommEnergyIC", "spi"),
+    LatencyHistogram("InitEnergyIC", "init"),
+    LatencyHistogram("RecoverEnergyIC", "recover"),
+    LatencyHistogram("EEPROM Read", "eeprom_read"),
+    LatencyHistogram("EEPROM Write", "eeprom_write"),
+    LatencyHistogram("WiFi Connect", "wifi"),
+    LatencyHistogram("Domoticz Publish", "domoticz"),
+    LatencyHistogram("InfluxDB Flush", "influxdb"),
+    LatencyHistogram("Direction Event", "direction")};
+
+// **************** FUNCTIONS / ROUTINES / CLASSES ****************
+
+LatencyHistogram::LatencyHistogram(const char *name, const char *key)
+{
+  Name = name;
+  Key = key;
+  _mux = portMUX_INITIALIZER_UNLOCKED;
+  Reset();
+}
+
+// Bucket Index.  Values below 4 have their own bucket, then 4 per power of 2.
+static int LatencyBucket(uint32_t cycles)
+{
+  if (cycles < LATENCY_SUBBUCKETS)
+    return cycles;
+  int octave = 31 - __builtin_clz(cycles);
+  return (octave - 1) * LATENCY_SUBBUCKETS + ((cycles >> (octave - 2)) & (LATENCY_SUBBUCKETS - 1));
+}
+
+// Largest value in a Bucket (cycles)
+static uint32_t LatencyBucketTop(int bucket)
+{
+  if (bucket < LATENCY_SUBBUCKETS)
+    return bucket;
+  int octave = bucket / LATENCY_SUBBUCKETS + 1;
+  uint64_t bottom = (uint64_t)(LATENCY_SUBBUCKETS + bucket % LATENCY_SUBBUCKETS) << (octave - 2);
+  return (uint32_t)min(bottom + (1ULL << (octave - 2)) - 1, 0xFFFFFFFFULL);
+}
+
+static uint32_t CyclesToMicros(uint64_t cycles)
+{
+  return (uint32_t)(cycles / ESP.getCpuFreqMHz());
+}
+
+void LatencyHistogram::Record(uint32_t cycles)
+{
+  int bucket = LatencyBucket(cycles);
+
+  portENTER_CRITICAL(&_mux);
+  _buckets[bucket]++;
+  _count++;
+  _total += cycles;
+  if (cycles > _max)
+    _max = cycles;
+  portEXIT_CRITICAL(&_mux);
+}
+
+void LatencyHistogram::Reset()
+{
+  portENTER_CRITICAL(&_mux);
+  memset(_buckets, 0, sizeof(_buckets));
+  _count = 0;
+  _max = 0;
+  _total = 0;
+  portEXIT_CRITICAL(&_mux);
+}
+
+uint32_t LatencyHistogram::GetCount()
+{
+  return _count;
+}
+
+// Percentile (0 to 100), as the top of the Bucket it falls in, so never under reads
+uint32_t LatencyHistogram::GetPercentile(float percentile)
+{
+  portENTER_CRITICAL(&_mux);
+  uint32_t rank = (uint32_t)ceilf(_count * percentile / 100);
+  uint32_t seen = 0;
+  uint32_t cycles = _max;
+  for (int i = 0; i < LATENCY_BUCKETS && rank > 0; i++)
+  {
+    seen += _buckets[i];
+    if (seen >= rank)
+    {
+      cycles = min(LatencyBucketTop(i), _max);
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  return CyclesToMicros(cycles);
+}
+
+uint32_t LatencyHistogram::GetMax()
+{
+  return CyclesToMicros(_max);
+}
+
+uint32_t LatencyHistogram::GetMean()
+{
+  portENTER_CRITICAL(&_mux);
+  uint64_t mean = _count ? _total / _count : 0;
+  portEXIT_CRITICAL(&_mux);
+  return CyclesToMicros(mean);
+}
+
+// Display Latency Histograms
+void DisplayLatencyStatistics(Print &Out)
+{
+  Out.println("Latency \t\t\tCount\tMean us\tp50 us\tp99 us\tMax us");
+  for (int i = 0; i < LAT_Count; i++)
+    Out.printf("%-16s \t\t%u\t%u\t%u\t%u\t%u\n", Latency[i].Name, (unsigned)Latency[i].GetCount(), (unsigned)Latency[i].GetMean(),
+                  (unsigned)Latency[i].GetPercentile(50), (unsigned)Latency[i].GetPercentile(99), (unsigned)Latency[i].GetMax());
+}
+
+// Latency as JSON.  {"spi":{"n":1200,"mean":152,"p50":151,"p99":163,"max":410},...}  Times in us.
+int FormatLatencyJSON(char *Out, size_t Size)
+{
+  int Length = snprintf(Out, Size, "{");
+
+  for (int i = 0; i < LAT_Count && Length < (int)Size; i++)
+    Length += snprintf(Out + Length, Size - Length, "%s\"%s\":{\"n\":%u,\"mean\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u}", i ? "," : "", Latency[i].Key,
+                       (unsigned)Latency[i].GetCount(), (unsigned)Latency[i].GetMean(), (unsigned)Latency[i].GetPercentile(50),
+                       (unsigned)Latency[i].GetPercentile(99), (unsigned)Latency[i].GetMax());
+  if (Length < (int)Size)
+    Length += snprintf(Out + Length, Size - Length, "}");
+
+  return Length < (int)Size ? Length : 0;
+}
@@ -18,15 +18,18 @@
     - First Flash this code to a GTEM board and Run code.
     - Check the Mains Current and Voltage display on the Serial Monitor - Press board Reset to refresh data.
     - You should find that the values are pretty near what is expected i.e. voltage, current, power etc.
-      - If not, update values, where needed, in the Excel 'Energy Setpoint Calculator GTEM Bring-Up Only.xlsx'.  Typically ONLY UGain or iGain.
+      - If not, with a known load on, type 'calibrate <volts> <amps>' in the serial console.  Gains are calibrated and saved in seconds.
+        For low loads and PF, 'calibrate offset' with no load first, and 'calibrate phase' with a resistive load after.
+      - Or, update values, where needed, in the Excel 'Energy Setpoint Calculator GTEM Bring-Up Only.xlsx'.  Typically ONLY UGain or iGain.
       - Enter new/tweaked UGain (Voltage) and/or iGain (Current).
       - Update auto calculated Hex value(s) into 'GTEM-1_Defaults.h' > 'Calibration Defaults'.
       - Reflash code to board.
-      - The Red LED will Flash upon a CRC1 or CRC2 error and then AUTOMATICALLY update the EEPROM and Reboot.
+      - The Red LED will Flash upon a CRC1 or CRC2 error and then AUTOMATICALLY update the EEPROM and Reinitialise the ATM90E26.
       - You should see a change in the values for Current, Voltage and resultant Power (Wattage).
       - Go back to XLS and update until you are happy that the values are near to your expected actual readings.
-    - Update the Wifi, Domoticz Server and Device Index Values in 'Domoticz.h'.  Creating new Devices first in Domoticz.
-    - Once you are happy with the values, update the 'EnableDomoticz' to 'true'.
+    - Update the Wifi, Domoticz Server and Device Index Values in 'ConfigStore.h' > 'ConfigDefaults'.  Creating new Devices first in Domoticz.
+      Or, without reflashing, set them from the serial console (i.e. 'set wifi_ssid MyNetwork').  Saved in the EEPROM.
+    - Once you are happy with the values, update the 'EnableDomoticz' to 'true' ('set domoticz true').
     - Reflash code to board.  All done!
 
   WiFi Updates
@@ -59,10 +62,33 @@
 #include <SPI.h>
 #include <Wire.h>
 #include <driver/adc.h>
+#include <Instrument.h>
+#include <Logger.h>
 #include <GTEM-EEPROM.h>
+#include <ConfigStore.h>
 #include <EnergyATM90E26.h>
 #include <GTEM-1_Defaults.h>
+#include <EnergyHealth.h>
 #include <Domoticz.h>
+#include <Snapshot.h>
+#include <RegisterTrace.h>
+#include <Statistics.h>
+#include <Filters.h>
+#include <AdaptiveRate.h>
+#include <CurrentRange.h>
+#include <EnergyDirection.h>
+#include <AnalogSampler.h>
+#include <NTCTable.h>
+#include <LiveStream.h>
+#include <InfluxDB.h>
+#include <ModbusTCP.h>
+#include <Scheduler.h>
+#include <SerialWriter.h>
+#include <Benchmark.h>
+#include <Replay.h>
+#include <Calibration.h>
+#include <DiagnosticReport.h>
+#include <Console.h>
 
 // ****************  VARIABLES / DEFINES / STATIC / STRUCTURES ****************
 
@@ -72,23 +98,25 @@ String AppBuild = "DitroniX GTEM-1 ATM90E26 SDK Board";
 String AppName = "GTEM Energy Monitor - Calibration and Domoticz";
 
 // Variables
-unsigned short ReadValue;
 float ReadFloat;
 float ADC_Voltage;
 float TemperatureC;
 float TemperatureF;
 
+// Scheduler Jobs
+int HeartbeatJobId = -1;
+int DomoticzJobId = -1;
+int BasicInfoJobId = -1;
+int HeartbeatOffJob = -1;
+int GreenBlinkJob = -1;
+int GreenBlinkCount = 0;
+
 // Constants
-const int LoopDelay = 1;       // Loop Delay in Seconds
-const int AverageSamples = 25; // Average Multi-Samples.
-const int AverageDelay = 20;    // Average Multi-Sample Delay.
-float ADC_Constant = 31.340;   // Adjust as needed for calibration of VDC_IN.
 uint64_t chipid = ESP.getEfuseMac();
 
 // **************** CONFIGURATION ****************
 boolean DisableHardwareTest = false; // Set to false to speed up booting
-boolean EnableBasicInfo = false;      // Set to true to display basic loop readings
-boolean EnableAveraging = true;      // Set to true to enable averaging
+// LoopDelay, EnableBasicInfo, EnableAveraging, ADC Constant and Calibration Gains are in Config (ConfigStore.h)
 
 // **************** INPUTS ****************
 #define DCV_IN 36      // GPIO 36 (Analog VP / ADC 1 CH0)
@@ -97,6 +125,7 @@ boolean EnableAveraging = true;      // Set to true to enable averaging
 #define User_Jumper 25 // GPIO 25 (DAC1)
 #define OPTO_IN 33     // GPIO 33 (Digital ADC 1 CH5)
 #define ATM_WO 27      // GPIO 28 (Digital ADC 2 CH7)
+#define ATM_IRQ 13     // GPIO 13 (Digital ADC 2 CH4)
 #define ATM_CF1 34     // GPIO 34 (Digital ADC 1 CH6)
 #define ATM_CF2 35     // GPIO 35 (Digital ADC 1 CH7)
 
@@ -118,444 +147,30 @@ ATM90E26_SPI eic;
 
 // **************** FUNCTIONS AND ROUTINES ****************
 
-// Calculate Average LineVoltage Value and Reduce Jitter
-float CalculateAverageLineVoltage()
+// Capture the Diagnostic Report, with the GTEM Sensors
+void CaptureDiagnosticReport()
 {
-  float AverageRAW = 0;
-  float Threshold = 10; // Volts
-  for (int i = 0; i < AverageSamples; i++)
-  {
-    AverageRAW = AverageRAW + eic.GetLineVoltage();
-    delay(AverageDelay);
-  }
-  AverageRAW = AverageRAW / AverageSamples;
-  if (AverageRAW < Threshold)
-    AverageRAW = 0;
-  return AverageRAW;
-}
-
-// Calculate Average LineCurrent Value and Reduce Jitter
-float CalculateAverageLineCurrent()
-{
-  float AverageRAW = 0;
-  float Threshold = 0.0; // Amps
-  for (int i = 0; i < AverageSamples; i++)
-  {
-    AverageRAW = AverageRAW + eic.GetLineCurrent(); // Current always a positive value
-    delay(AverageDelay);
-  }
-  AverageRAW = AverageRAW / AverageSamples;
-  if (AverageRAW < Threshold)
-    AverageRAW = 0;
-  return AverageRAW;
-}
-
-// Calculate Average ActivePower Value and Reduce Jitter
-float CalculateAverageActivePower()
-{
-  float AverageRAW = 0;
-  float Threshold = 50; // Watts
-  for (int i = 0; i < AverageSamples; i++)
-  {
-    AverageRAW = AverageRAW + eic.GetActivePower();
-    delay(AverageDelay);
-  }
-  AverageRAW = AverageRAW / AverageSamples;
-  if (AverageRAW < Threshold && AverageRAW > -Threshold)
-    AverageRAW = 0;
-  return AverageRAW;
-}
-
-// Calculate Average ImportPower Value and Reduce Jitter
-float CalculateAverageImportPower()
-{
-  float AverageRAW = 0;
-  float Threshold = 50; // Watts
-  for (int i = 0; i < AverageSamples; i++)
-  {
-    AverageRAW = AverageRAW + eic.GetImportPower(); // Always a positive value
-    delay(AverageDelay);
-  }
-  AverageRAW = AverageRAW / AverageSamples;
-  if (AverageRAW < Threshold)
-    AverageRAW = 0;
-  return AverageRAW;
-}
-
-// Calculate Average ExportPower Value and Reduce Jitter
-float CalculateAverageExportPower()
-{
-  float AverageRAW = 0;
-  float Threshold = 50; // Watts
-  for (int i = 0; i < AverageSamples; i++)
-  {
-    AverageRAW = AverageRAW + eic.GetExportPower(); // Always a positive value
-    delay(AverageDelay);
-  }
-  AverageRAW = AverageRAW / AverageSamples;
-  if (AverageRAW < Threshold)
-    AverageRAW = 0;
-  return AverageRAW;
-}
-
-void DisplayBIN16(int var) // Display BIN from Var
-{
-  for (unsigned int i = 0x8000; i; i >>= 1)
-  {
-    Serial.write(var & i ? '1' : '0');
-  }
-  Serial.print(" ");
-}
-
-void DisplayHEX(unsigned long var, unsigned char numChars) // Display Hex from Var
-{
-  unsigned long mask = 0x0000000F;
-  mask = mask << 4 * (numChars - 1);
-
-  for (unsigned int i = numChars; i > 0; --i)
-  {
-    Serial.print(((var & mask) >> (i - 1) * 4), HEX);
-    mask = mask >> 4;
-  }
-  Serial.print(" ");
+  CaptureReport(eic, Report, AppVersion.c_str());
+  Report.Sensors = DisableHardwareTest;
+  Report.DCVoltage = ADC_Voltage;
+  Report.TemperatureC = TemperatureC;
 }
 
 void DisplayRegisters() // Display Diagnostic Report
 {
-  // Heatbeat Green LED and Provide ATM Stablising Time
-  digitalWrite(LED_Green, LOW);
-  delay(250);
-  digitalWrite(LED_Green, HIGH);
-  delay(250);
-  digitalWrite(LED_Green, LOW);
-  delay(250);
-  digitalWrite(LED_Green, HIGH);
-
-  // Header
-  Serial.println("GTEM-1 ATM90E26 Energy Monitoring Energy Monitor");
-  Serial.println("Register Status and Diagnostic Report");
-  Serial.printf("ESP32 Serial ID = %04X", (uint16_t)(chipid >> 32));
-  Serial.printf("%08X", (uint32_t)chipid);
-  Serial.print("   Firmware Version = ");
-  Serial.println(AppVersion);
-  Serial.println();
+  // Heatbeat Green LED.  Blinked by the Scheduler, so the report is not delayed.
+  GreenBlinkCount = 4;
+  ScheduleJob(GreenBlinkJob, 0);
 
-  if (EnableBasicInfo == false) // Restrict displayed information if EnableBasicInfo is true
-  {
-    Serial.println("Register Name\t\t\tVar/Address\t\tValue / Binary / Information");
-    Serial.println("------------ \t\t\t-----------\t\t--------------------------------------------------------");
-
-    // System Status
-    Serial.print("System Status \t\t\t(SysStatus 0x01):\t0x");
-    ReadValue = eic.GetSysStatus();
-    DisplayHEX(ReadValue, 4);
-    DisplayBIN16(ReadValue);
-    if (bitRead(ReadValue, 1))
-      Serial.print("SagWarn.Enabled ");
-    if (bitRead(ReadValue, 13) && bitRead(ReadValue, 12))
-      Serial.print("CheckSumError.CS2 ");
-    if (bitRead(ReadValue, 15) && bitRead(ReadValue, 14))
-      Serial.print("CheckSumError.CS1 ");
-    Serial.println();
-    if (ReadValue == 0x0000)
-      Serial.println(">ATM 0x01 - #0000 System Status Default Value");
-    if (ReadValue == 0xFFFF)
-      Serial.println(">ATM 0x01 - #FFFF Failed | Fault on ATM | Reboot Needed");
-
-    // Meter Status
-    yield();
-    Serial.print("Meter Status \t\t\t(EnStatus 0x46):\t0x");
-    ReadValue = eic.GetMeterStatus();
-    DisplayHEX(ReadValue, 4);
-    DisplayBIN16(ReadValue);
-    if (!bitRead(ReadValue, 1) && !bitRead(ReadValue, 0))
-      Serial.print("LNMode.AntiTamper ");
-    if (!bitRead(ReadValue, 1) && bitRead(ReadValue, 0))
-      Serial.print("LNMode.FixedL ");
-    if (bitRead(ReadValue, 1) && !bitRead(ReadValue, 0))
-      Serial.print("LNMode.LN ");
-    if (bitRead(ReadValue, 1) && bitRead(ReadValue, 0))
-      Serial.print("LNMode.Flexible ");
-    if (bitRead(ReadValue, 11))
-      Serial.print("Lline.AntiTamperL ");
-    if (!bitRead(ReadValue, 11))
-      Serial.print("Lline.AntiTamperN ");
-    if (bitRead(ReadValue, 12))
-      Serial.print("RevP.CF1ActiveReverse ");
-    if (!bitRead(ReadValue, 12))
-      Serial.print("RevP.CF1ActiveForward ");
-    if (bitRead(ReadValue, 13))
-      Serial.print("RevQ.CF2ReActiveReverse ");
-    if (!bitRead(ReadValue, 13))
-      Serial.print("RevQ.CF2ReActiveForward ");
-    if (bitRead(ReadValue, 14))
-      Serial.print("Pnoload.NoLoadActive ");
-    if (!bitRead(ReadValue, 14))
-      Serial.print("Pnoload.NoLoadNotActive ");
-    if (bitRead(ReadValue, 15))
-      Serial.print("Qnoload.ReactiveNoLoad ");
-    if (!bitRead(ReadValue, 15))
-      Serial.print("Qnoload.NotReactiveNoLoad ");
-    Serial.println();
-    if (ReadValue == 0x2801)
-      Serial.println(">ATM 0x46- #2801 Accumulator Populated");
-    if (ReadValue == 0xC801)
-      Serial.println(">ATM 0x46- #C801 Accumulator Not Running");
-    if (ReadValue == 0xC800)
-      Serial.println(">ATM 0x46 - #C800 Meter Status Default Value");
-    if (ReadValue == 0xFFFF)
-      Serial.println(">ATM 0x46 - #FFFF Failed | Fault on ATM | Reboot Needed");
-    if (ReadValue == 0x0000)
-      Serial.println(">ATM 0x46 - #0000 ERROR!: Possible ATM Hardware Issue\n\n");
-
-    // MMode Metering Status
-    yield();
-    Serial.print("MMode Status \t\t\t(MMode 0x2B):\t\t0x");
-    ReadValue = eic.GetMModeStatus();
-    DisplayHEX(ReadValue, 4);
-    DisplayBIN16(ReadValue);
-    if (!bitRead(ReadValue, 5) && !bitRead(ReadValue, 4))
-      Serial.print("MMode.PositiveZeroCrossing ");
-    if (!bitRead(ReadValue, 5) && bitRead(ReadValue, 4))
-      Serial.print("MMode.NegativeZeroCrossing ");
-    if (bitRead(ReadValue, 5) && !bitRead(ReadValue, 4))
-      Serial.print("MMode.AllZeroCrossing ");
-    if (bitRead(ReadValue, 5) && bitRead(ReadValue, 4))
-      Serial.print("MMode.NoZeroCrossing ");
-    if (bitRead(ReadValue, 10))
-      Serial.print("MMode.LNSel.LLine(Default) ");
-    if (!bitRead(ReadValue, 10))
-      Serial.print("MMode.LNSel.NLine ");
-    if (!bitRead(ReadValue, 12) && !bitRead(ReadValue, 11))
-      Serial.print("MMode.NLine.CurrentGain2 ");
-    if (!bitRead(ReadValue, 12) && bitRead(ReadValue, 11))
-      Serial.print("MMode.NLine.CurrentGain4 ");
-    if (bitRead(ReadValue, 12) && !bitRead(ReadValue, 11))
-      Serial.print("MMode.NLine.CurrentGain1 ");
-    if (bitRead(ReadValue, 12) && bitRead(ReadValue, 11))
-      Serial.print("MMode.NLine.CurrentGain1 ");
-    if (bitRead(ReadValue, 15))
-      Serial.print("MMode.CurrentChannelGain1 ");
-    if (!bitRead(ReadValue, 15) && !bitRead(ReadValue, 14) && !bitRead(ReadValue, 13))
-      Serial.print("MMode.LGain.CurrentChannelGain4 ");
-    if (!bitRead(ReadValue, 15) && !bitRead(ReadValue, 14) && bitRead(ReadValue, 13))
-      Serial.print("MMode.LGain.CurrentChannelGain8 ");
-    if (!bitRead(ReadValue, 15) && bitRead(ReadValue, 14) && !bitRead(ReadValue, 13))
-      Serial.print("MMode.LGain.CurrentChannelGain16 ");
-    if (!bitRead(ReadValue, 15) && bitRead(ReadValue, 14) && bitRead(ReadValue, 13))
-      Serial.print("MMode.LGain.CurrentChannelGain24 ");
-    Serial.println();
-    if (ReadValue == 0x9422)
-      Serial.println(">ATM 0x2B - #9422 MMode Default Value");
-
-    // ATM Read Values
-
-    Serial.println("-----------");
-
-    // CalStart Status
-    yield();
-    Serial.print("Calibraration Status \t\t(CalStart 0x20):\t0x");
-    ReadValue = eic.GetCalStartStatus();
-    DisplayHEX(ReadValue, 4);
-    DisplayBIN16(ReadValue);
-    if (ReadValue == 0x6886)
-      Serial.print("Power-On Value. Metering Function is Disabled");
-    if (ReadValue == 0x5678)
-      Serial.print("CALIBRATION | Meter Calibration Startup Command");
-    if (ReadValue == 0x8765)
-      Serial.print("RUNNING | Normal Metering Mode");
-    if (ReadValue != 0x6886 && ReadValue != 0x5678 && ReadValue != 0x8765)
-      Serial.print(">ATM 0x20 - Metering Function is Disabled");
-    Serial.println();
-
-    yield();
-    Serial.print("UGain Calibration Value\t\t(UGain 0x31):\t\t0x");
-    ReadValue = eic.GetUGain();
-    DisplayHEX(ReadValue, 4);
-    if (bitRead(ReadValue, 15))
-      Serial.print("UGain Possible Value Error");
-    Serial.println();
-
-    yield();
-    Serial.print("LGain Calibration Value\t\t(LGain 0x23):\t\t0x");
-    ReadValue = eic.GetLGain();
-    DisplayHEX(ReadValue, 4);
-    Serial.println();
-
-    yield();
-    Serial.print("IGain Calibration Value\t\t(IgainL 0x32):\t\t0x");
-    ReadValue = eic.GetIGain();
-    DisplayHEX(ReadValue, 4);
-    Serial.println();
-
-    // Checksum 1 Status
-    yield();
-    Serial.print("Checksum Status \t\t(CS1 0x2C):\t\t0x");
-    ReadValue = eic.GetCS1Status();
-    DisplayHEX(ReadValue, 4);
-    if (ReadValue != eic.GetCS1Calculated())
-    { // 0xC000
-      Serial.print("*ERROR: Please update _crc1 to ATM Calculated CRC: 0x");
-      Serial.print(eic.GetCS1Calculated(), HEX);
-    }
-    Serial.println();
-
-    // Checksum 2 Status
-    yield();
-    Serial.print("Checksum Status \t\t(CS2 0x3B):\t\t0x");
-    ReadValue = eic.GetCS2Status();
-    DisplayHEX(ReadValue, 4);
-    if (ReadValue != eic.GetCS2Calculated())
-    { // 0x3000
-      Serial.print("*ERROR: Please update _crc2 to ATM Calculated CRC: 0x");
-      Serial.print(eic.GetCS2Calculated(), HEX);
-    }
-    Serial.println();
-
-    Serial.println("-----------");
-  }
-
-  yield();
-  Serial.print("Line Voltage \t\t\t(Urms 0x49):\t\t");
-  if (EnableAveraging == true)
-  {
-    Serial.print(CalculateAverageLineVoltage());
-  }
-  else
-  {
-    Serial.print(eic.GetLineVoltage());
-  }
-  Serial.println(" V");
-
-  yield();
-  Serial.print("Line Current \t\t\t(Irms 0x48):\t\t");
-  if (EnableAveraging == true)
-  {
-    Serial.print(CalculateAverageLineCurrent());
-  }
-  else
-  {
-    Serial.print(eic.GetLineCurrent());
-  }
-  Serial.println(" A");
-
-  yield();
-  Serial.print("Line Frequency \t\t\t(Freq 0x4C):\t\t");
-  Serial.print(eic.GetFrequency());
-  Serial.println(" Hz");
-
-  yield();
-  Serial.print("Active Power \t\t\t(Pmean 0x4A):\t\t");
-  if (EnableAveraging == true)
-  {
-    Serial.print(CalculateAverageActivePower());
-  }
-  else
-  {
-    Serial.print(eic.GetActivePower());
-  }
-  Serial.println(" W");
-
-  yield();
-  Serial.print("Import Power \t\t\t(Pmean 0x4A +):\t\t");
-  if (EnableAveraging == true)
-  {
-    Serial.print(CalculateAverageImportPower());
-  }
-  else
-  {
-    Serial.print(eic.GetImportPower());
-  }
-  Serial.println(" W");
-
-  yield();
-  Serial.print("Export Power \t\t\t(Pmean 0x4A -):\t\t");
-  if (EnableAveraging == true)
-  {
-    Serial.print(CalculateAverageExportPower());
-  }
-  else
-  {
-    Serial.print(eic.GetExportPower());
-  }
-  Serial.println(" W");
-
-  Serial.println("-----------");
-
-  yield();
-  Serial.print("Import Energy \t\t\t(APenergy 0x40):\t");
-  Serial.println(eic.GetImportEnergy());
-
-  yield();
-  Serial.print("Export Energy \t\t\t(ANenergy 0x41):\t");
-  Serial.println(eic.GetExportEnergy());
-
-  yield();
-  Serial.print("Power Factor \t\t\t(PowerF 0x4D):\t\t");
-  Serial.println(eic.GetPowerFactor());
-
-  Serial.println("-----------");
-
-  yield();
-  Serial.print("Abs Active Energy \t\t(ATenergy 0x42):\t");
-  Serial.println(eic.GetAbsActiveEnergy());
-
-  yield();
-  Serial.print("Abs Reactive Energy \t\t(Rtenergy 0x45):\t");
-  Serial.println(eic.GetAbsReactiveEnergy());
-
-  yield();
-  Serial.print("Abs Reactive Forward Energy \t(RPenergy 0x43):\t");
-  Serial.println(eic.GetReactivefwdEnergy());
-
-  // LSB RMS/Power Status
-  yield();
-  Serial.print("LSB RMS/Power \t\t\t(LSB 0x08):\t\t0x");
-  ReadValue = eic.GetLSBStatus();
-  DisplayHEX(ReadValue, 4);
-  Serial.println(ReadValue);
-
-  // Other GTEM Sensors
-
-  // ESP32 ADC 12-Bit SAR (Successive Approximation Register)
-  // Conversion resolution 0 - 4095 (4096)
-  // You may need to calibrate as needed.
-
-  Serial.println("-----------");
-
-  if (DisableHardwareTest == true)
-  {
-    // DCV_IN
-    yield();
-    // ReadADCVoltage();
-    Serial.print("DC Voltage Sensor \t\t(DCV_IN VP):\t\t");
-    Serial.print(ADC_Voltage);
-    if (ADC_Voltage < 5)
-      Serial.print(" V USB Powered.  Note - Not all ATM functions will work in this mode");
-    if (ADC_Voltage > 5)
-      Serial.print(" V AC/DC Input");
-    if (ADC_Voltage > 20)
-      Serial.print(" V *WARNING: Please Check Input Voltage.  Too High!");
-    Serial.println();
-
-    // NTC
-    yield();
-    // ReadTemperature();
-    Serial.print("PCB Temperature Sensor\t\t(NTC_IN VN):\t\t");
-    Serial.print(TemperatureC);
-    Serial.println(" ºC");
-
-    Serial.println("\n");
-
-    if (EnableDomoticz == false)
-      Serial.println("Set EnableDomoticz to true (in Domoticz.h), to enable Domoticz Publishing");
-  }
+  // Captured in one pass, then passed on to the UART by the Serial Writer Job
+  CaptureDiagnosticReport();
+  RenderReportText(Report, SerialOut);
 }
 
 void TestRGB()
 { // Test RGB LEDs
 
-  Serial.println("Testing RGB LED");
+  LogInfo("Testing RGB LED");
   delay(100);
 
   // Red
@@ -588,93 +203,115 @@ void TestRGB()
 
 void PublishRegisters()
 {
+  // While the Snapshot Pipeline runs, publish its values, as the mean over the Domoticz Window (Rolling Statistics).
+  // Energy is the change in the driver totals since the last publish, as the Energy registers clear on read, and another
+  // reader (i.e. the Diagnostic Report) would otherwise take it.
+  static double LastImportEnergy = 0;
+  static double LastExportEnergy = 0;
+  GTEM_Snapshot Latest = {};
+  boolean UseSnapshot = (SnapshotTaskHandle != NULL);
+  if (UseSnapshot)
+  {
+    GetLatestSnapshot(Latest);
+    // The Statistics leave out Range Switch transients.  If the Latest is one, use the 1 s mean instead.
+    int Window = Config.DomoticzWindow < 0 && (Latest.Flags & SNAP_RangeSwitch) ? STATS_1s : Config.DomoticzWindow;
+    Latest.LineVoltage = GetStatisticsMean(STATS_LineVoltage, Window, Latest.LineVoltage);
+    Latest.LineCurrent = GetStatisticsMean(STATS_LineCurrent, Window, Latest.LineCurrent);
+    Latest.ActivePower = GetStatisticsMean(STATS_ActivePower, Window, Latest.ActivePower);
+    Latest.LineFrequency = GetStatisticsMean(STATS_LineFrequency, Window, Latest.LineFrequency);
+    Latest.PowerFactor = GetStatisticsMean(STATS_PowerFactor, Window, Latest.PowerFactor);
+  }
 
-  if (WiFi.status() == WL_CONNECTED)
+  if (ReconnectWiFi())
   {
     // ATM90E26 Registers
     yield();
-    if (LineVoltage > 0)
+    if (Config.Idx.LineVoltage > 0)
     {
-      ReadFloat = eic.GetLineVoltage();
-      PublishDomoticz(LineVoltage, ReadFloat, "LineVoltage");
+      ReadFloat = UseSnapshot ? Latest.LineVoltage : eic.GetLineVoltage();
+      PublishDomoticz(Config.Idx.LineVoltage, ReadFloat, "LineVoltage");
       yield();
     }
 
-    if (LineCurrent > 0)
+    if (Config.Idx.LineCurrent > 0)
     {
-      ReadFloat = eic.GetLineCurrent();
-      PublishDomoticz(LineCurrent, ReadFloat, "LineCurrent");
+      ReadFloat = UseSnapshot ? Latest.LineCurrent : eic.GetLineCurrent();
+      PublishDomoticz(Config.Idx.LineCurrent, ReadFloat, "LineCurrent");
       yield();
     }
 
-    if (ActivePower > 0)
+    if (Config.Idx.ActivePower > 0)
     {
-      ReadFloat = eic.GetActivePower();
-      PublishDomoticz(ActivePower, ReadFloat, "ActivePower");
+      ReadFloat = UseSnapshot ? Latest.ActivePower : eic.GetActivePower();
+      PublishDomoticz(Config.Idx.ActivePower, ReadFloat, "ActivePower");
       yield();
     }
 
-    if (ImportPower > 0)
+    if (Config.Idx.ImportPower > 0)
     {
-      ReadFloat = eic.GetImportPower();
-      PublishDomoticz(ImportPower, ReadFloat, "ImportPower");
+      ReadFloat = UseSnapshot ? max(Latest.ActivePower, 0.0f) : eic.GetImportPower();
+      PublishDomoticz(Config.Idx.ImportPower, ReadFloat, "ImportPower");
       yield();
     }
 
-    if (ExportPower > 0)
+    if (Config.Idx.ExportPower > 0)
     {
-      ReadFloat = eic.GetExportPower();
-      PublishDomoticz(ExportPower, ReadFloat, "ExportPower");
+      ReadFloat = UseSnapshot ? max(-Latest.ActivePower, 0.0f) : eic.GetExportPower();
+      PublishDomoticz(Config.Idx.ExportPower, ReadFloat, "ExportPower");
       yield();
     }
 
-    if (LineFrequency > 0)
+    if (Config.Idx.LineFrequency > 0)
     {
-      ReadFloat = eic.GetFrequency();
-      PublishDomoticz(LineFrequency, ReadFloat, "LineFrequency");
+      ReadFloat = UseSnapshot ? Latest.LineFrequency : eic.GetFrequency();
+      PublishDomoticz(Config.Idx.LineFrequency, ReadFloat, "LineFrequency");
       yield();
     }
 
-    if (ImportEnergy > 0)
+    if (Config.Idx.ImportEnergy > 0)
     {
-      ReadFloat = eic.GetImportEnergy();
-      PublishDomoticz(ImportEnergy, ReadFloat, "ImportEnergy");
+      if (!UseSnapshot)
+        eic.GetImportEnergy(); // Into the total
+      double Total = UseSnapshot ? Latest.ImportEnergy : eic.GetImportEnergyTotal();
+      ReadFloat = Total - LastImportEnergy;
+      PublishDomoticz(Config.Idx.ImportEnergy, ReadFloat, "ImportEnergy");
+      LastImportEnergy = Total;
       yield();
     }
 
-    if (ExportEnergy > 0)
+    if (Config.Idx.ExportEnergy > 0)
     {
-      ReadFloat = eic.GetExportEnergy();
-      PublishDomoticz(ExportEnergy, ReadFloat, "ExportEnergy");
+      if (!UseSnapshot)
+        eic.GetExportEnergy(); // Into the total
+      double Total = UseSnapshot ? Latest.ExportEnergy : eic.GetExportEnergyTotal();
+      ReadFloat = Total - LastExportEnergy;
+      PublishDomoticz(Config.Idx.ExportEnergy, ReadFloat, "ExportEnergy");
+      LastExportEnergy = Total;
       yield();
     }
 
-    if (PowerFactor > 0)
+    if (Config.Idx.PowerFactor > 0)
     {
-      ReadFloat = eic.GetPowerFactor();
-      PublishDomoticz(PowerFactor, ReadFloat, "PowerFactor");
+      ReadFloat = UseSnapshot ? Latest.PowerFactor : eic.GetPowerFactor();
+      PublishDomoticz(Config.Idx.PowerFactor, ReadFloat, "PowerFactor");
       yield();
     }
 
     // ReadADCVoltage();
-    if (DCVoltage > 0)
-      PublishDomoticz(DCVoltage, ADC_Voltage, "DCVoltage");
+    if (Config.Idx.DCVoltage > 0)
+      PublishDomoticz(Config.Idx.DCVoltage, ADC_Voltage, "DCVoltage");
     yield();
 
     // ReadTemperature();
-    if (PCBTemperature > 0)
-      PublishDomoticz(PCBTemperature, TemperatureC, "PCBTemperature");
+    if (Config.Idx.PCBTemperature > 0)
+      PublishDomoticz(Config.Idx.PCBTemperature, TemperatureC, "PCBTemperature");
 
     // Batch or Group Device
     if (DomoticzBaseIndex > 0)
       PublishDomoticzATM(DomoticzBaseIndex);
   }
-  else
-  {
-    InitialiseWiFi();
-  }
 
-  Serial.println("");
+  LogInfo("");
 }
 
 void ScanI2CBus()
@@ -683,7 +320,7 @@ void ScanI2CBus()
   byte error, address;
   int nDevices;
 
-  Serial.println("Scanning I2C Bus for Devices ...");
+  LogInfo("Scanning I2C Bus for Devices ...");
 
   nDevices = 0;
   for (address = 1; address < 127; address++)
@@ -692,68 +329,327 @@ void ScanI2CBus()
     error = Wire.endTransmission();
     if (error == 0)
     {
-      Serial.print("I2C device found at address Decimal ");
-      if (address < 16)
-      {
-        Serial.print("0");
-      }
-      Serial.print(address);
-      Serial.print(" = Hex 0x");
-      Serial.print(address, HEX);
-      if (address == 80)
-        Serial.print(" EEPROM");
-      Serial.println();
+      LogInfo("I2C device found at address Decimal %02d = Hex 0x%X%s", address, address, address == 80 ? " EEPROM" : "");
 
       nDevices++;
     }
     else if (error == 4)
     {
-      Serial.print("Unknown error at address Decimal ");
-      if (address < 16)
-      {
-        Serial.print("0");
-      }
-      Serial.print(address);
-      Serial.print(" = Hex 0x");
-      Serial.println(address, HEX);
+      LogWarn("Unknown error at address Decimal %02d = Hex 0x%X", address, address);
     }
   }
   if (nDevices == 0)
   {
-    Serial.println("No I2C devices found. Possible Hardware Issue?");
+    LogError("No I2C devices found. Possible Hardware Issue?");
   }
   else
   {
-    Serial.println("I2C Bus Scan Complete");
+    LogInfo("I2C Bus Scan Complete");
   }
 }
 
+// PCB NTC Temperature.  From the Analog Sampler if running, else one analogRead().  Converted by the NTC Table (NTCTable.h).
 void ReadTemperature()
 {
-  int Vo;
-  float R1 = 10000; // Based on 10K
-  float logR2, R2, T;
-  // float Tf;
-  float tCal = 1.16; // Tweak for Calibration
-  float C1 = 1.009249522e-03, C2 = 2.378405444e-04, C3 = 2.019202697e-07;
-
-  Vo = analogRead(NTC_IN);
-  R2 = R1 * (4095.0 / (float)Vo - tCal);
-  logR2 = log(R2);
-  T = (1.0 / (C1 + C2 * logR2 + C3 * logR2 * logR2 * logR2));
-  TemperatureC = T - 273.15;                        // Centigrade
-  TemperatureF = (TemperatureC * 9.0) / 3.3 + 32.0; // Fahrenheit
+  float Code;
+
+  // analogRead() would stop the Analog Sampler, so wait for its first value instead
+  if (AnalogTaskHandle != NULL)
+    Code = GetAnalogMillivolts(ANALOG_NTC) * NTC_ADCMax / 3300.0; // As a 12 bit code of the 3V3 supply across the NTC divider
+  else
+    Code = analogRead(NTC_IN);
+  if (Code <= 0)
+    return;
+
+  TemperatureC = NTCTemperature(Code);              // Centigrade
+  TemperatureF = (TemperatureC * 9.0) / 5.0 + 32.0; // Fahrenheit
 }
 
+// AC>DC Input Voltage.  ADCConstant is the input Voltage for 3.3 V at DCV_IN.
 void ReadADCVoltage()
 {
-  ADC_Voltage = (analogRead(DCV_IN) * ADC_Constant) / 4095;
+  if (AnalogTaskHandle != NULL)
+    ADC_Voltage = GetAnalogMillivolts(ANALOG_DCV) * Config.ADCConstant / 3300.0;
+  else
+    ADC_Voltage = (analogRead(DCV_IN) * Config.ADCConstant) / 4095;
+}
+
+// **************** SCHEDULER JOBS ****************
+
+// Heatbeat LED.  Blue on, then off 50 ms later.
+void HeartbeatJob()
+{
+  if (CRCErrorFlag)
+    return;
+  digitalWrite(LED_Blue, LOW);
+  ScheduleJob(HeartbeatOffJob, 50);
+}
+
+void HeartbeatOff()
+{
+  digitalWrite(LED_Blue, HIGH);
+}
+
+// Green LED Blink.  Toggles GreenBlinkCount times, 250 ms apart.
+void GreenBlink()
+{
+  if (GreenBlinkCount <= 0)
+    return;
+  digitalWrite(LED_Green, GreenBlinkCount % 2 ? HIGH : LOW);
+  if (--GreenBlinkCount > 0)
+    ScheduleJob(GreenBlinkJob, 250);
+}
+
+// LED Red Flashing if CRC Error, or ATM90E26 Fault
+void CRCErrorJob()
+{
+  if (CRCErrorFlag || EnergyICFault)
+    digitalWrite(LED_Red, !digitalRead(LED_Red));
+  else
+    digitalWrite(LED_Red, HIGH);
+}
+
+// ATM90E26 Health Check, when the Snapshot Pipeline is not running to do it.  Not while calibrating, as the Run writes live.
+void HealthCheckJob()
+{
+  if (EnableHealthCheck == false || SnapshotTaskHandle != NULL || CalibrationActive())
+    return;
+  CheckEnergyIC(eic);
+}
+
+// Publish to Domoticz.  Not while calibrating, as readings are part corrected.
+void PublishJob()
+{
+  if (CRCErrorFlag || EnergyICFault || Config.EnableDomoticz == false || CalibrationActive())
+    return;
+  ReadTemperature();  // Read PCB NTC Temperature
+  ReadADCVoltage();   // Read AC>DC Input Voltage
+  PublishRegisters(); // Publish to Domoticz
+}
+
+// Display Basic Readings
+void BasicInfoJob()
+{
+  if (CRCErrorFlag || Config.EnableBasicInfo == false)
+    return;
+  DisplayRegisters();
+  SerialOut.println("");
+}
+
+// **************** CONSOLE ****************
+
+// LoopDelay changed.  The Loop Jobs take the new Period.
+void LoopDelayChanged()
+{
+  SetJobPeriod(HeartbeatJobId, Config.LoopDelay * 1000);
+  SetJobPeriod(DomoticzJobId, Config.LoopDelay * 1000);
+  SetJobPeriod(BasicInfoJobId, Config.LoopDelay * 1000);
+}
+
+// Setting used at boot only
+void RebootToApply()
+{
+  Serial.println("Saved.  Reboot to apply ('reboot')");
+}
+
+// report [text|json|binary]
+void ReportCommand(char *Args)
+{
+  const ReportFormat *Format = FindReportFormat(*Args ? Args : "text");
+  if (Format == NULL)
+  {
+    Serial.println("Usage: report [text|json|binary]");
+    return;
+  }
+
+  CaptureDiagnosticReport();
+  if (Format->Render == RenderReportBinary)
+  {
+    // Written out now, with log lines held, so none lands inside the record
+    HoldLog();
+    Format->Render(Report, SerialOut);
+    SerialOut.flush();
+    ReleaseLog();
+  }
+  else
+    Format->Render(Report, SerialOut);
+}
+
+void BenchmarkCommand(char *Args)
+{
+  RunBenchmarks(eic, AppVersion.c_str());
+}
+
+// replay [steps|flip|sag|noise|trace|all].  Replay Scenarios, JSON.  Default all.
+void ReplayCommand(char *Args)
+{
+  if (!RunReplays(*Args ? Args : "all", AppVersion.c_str()))
+    Serial.println("Usage: replay [steps|flip|sag|noise|trace|all]");
+}
+
+// calibrate <volts> [amps] | offset | phase | stop.  Calibrate the gains to a Reference, the offsets at no load, or the phase
+// with a resistive load, and save them.  Each runs in the background (Calibration Job), with progress logged.
+void CalibrateCommand(char *Args)
+{
+  float Voltage = 0, Current = 0;
+  if (strcasecmp(Args, "stop") == 0)
+  {
+    if (!StopCalibration())
+      Serial.println("No Calibration running");
+  }
+  else if (CalibrationActive())
+    Serial.println("Calibration running.  'calibrate stop' to end it");
+  else if (strcasecmp(Args, "offset") == 0)
+    StartOffsetCalibration(eic);
+  else if (strcasecmp(Args, "phase") == 0)
+    StartPhaseCalibration(eic);
+  else if (sscanf(Args, "%f %f", &Voltage, &Current) < 1 || Voltage <= 0 || Current < 0)
+    Serial.println("Usage: calibrate <volts> [amps] | offset | phase | stop");
+  else
+    StartCalibration(eic, Voltage, Current);
+}
+
+// config [save|reset].  Configuration Store
+void ConfigCommand(char *Args)
+{
+  if (strcasecmp(Args, "save") == 0)
+    SaveConfig();
+  else if (strcasecmp(Args, "reset") == 0)
+  {
+    ResetConfig();
+    RebootToApply();
+  }
+  else if (*Args != 0)
+  {
+    Serial.println("Usage: config [save|reset]");
+    return;
+  }
+  DisplayConfig();
+}
+
+// trace [on|burst|off].  Register Trace.  Dump with 'dump trace'.
+void TraceCommand(char *Args)
+{
+  if (strcasecmp(Args, "on") == 0)
+    StartTrace();
+  else if (strcasecmp(Args, "burst") == 0)
+    StartTraceBurst(eic);
+  else if (strcasecmp(Args, "off") == 0)
+    StopTrace();
+  else if (*Args != 0)
+  {
+    Serial.println("Usage: trace [on|burst|off]");
+    return;
+  }
+  DisplayTraceStatistics();
+}
+
+// range [auto|normal|low].  Current Range, switched automatically or fixed, i.e. to calibrate each range
+void RangeCommand(char *Args)
+{
+  if (strcasecmp(Args, "auto") == 0)
+    SetCurrentRange(-1);
+  else if (strcasecmp(Args, "normal") == 0)
+    SetCurrentRange(RANGE_Normal);
+  else if (strcasecmp(Args, "low") == 0)
+    SetCurrentRange(RANGE_Low);
+  else if (*Args != 0)
+  {
+    Serial.println("Usage: range [auto|normal|low]");
+    return;
+  }
+  DisplayCurrentRangeStatistics();
+}
+
+// direction.  Energy Direction Change Events, with the latency of each from the IRQ edge.
+void DirectionCommand(char *Args)
+{
+  DisplayDirectionEvents();
+}
+
+// filter <metric> <median> <alpha> <deadzone> <hysteresis>.  Metric is v, i, p, f or pf.
+void FilterCommand(char *Args)
+{
+  char Key[4];
+  int Median;
+  float Alpha, Deadzone, Hysteresis;
+  if (sscanf(Args, "%3s %d %f %f %f", Key, &Median, &Alpha, &Deadzone, &Hysteresis) == 5)
+  {
+    for (int m = 0; m < STATS_Metrics; m++)
+    {
+      if (strcasecmp(Key, StatsMetricKey[m]) == 0)
+      {
+        SetFilter(m, constrain(Median, 1, FILTER_MEDIAN_MAX), Alpha, Deadzone, Hysteresis);
+        DisplayFilters();
+        return;
+      }
+    }
+  }
+  Serial.println("Usage: filter <v|i|p|f|pf> <median> <alpha> <deadzone> <hysteresis>");
+}
+
+void RebootCommand(char *Args)
+{
+  LogInfo("Rebooting");
+  SerialOut.flush();
+  FlushLog();
+  ESP.restart();
+}
+
+// Console Settings and Commands.  Settings in Config are saved to the EEPROM when set.
+void InitialiseConsoleSettings()
+{
+  AddConsoleSetting("wifi_ssid", SETTING_Text, Config.WiFiSSID, 1, sizeof(Config.WiFiSSID), RebootToApply);
+  AddConsoleSetting("wifi_password", SETTING_Secret, Config.WiFiPassword, 0, sizeof(Config.WiFiPassword), RebootToApply);
+  AddConsoleSetting("domoticz_server", SETTING_Text, Config.DomoticzServer, 1, sizeof(Config.DomoticzServer));
+  AddConsoleSetting("domoticz_port", SETTING_Int, &Config.DomoticzPort, 1, 65535);
+  AddConsoleSetting("loop_delay", SETTING_Int, &Config.LoopDelay, 1, 3600, LoopDelayChanged);
+  AddConsoleSetting("basic_info", SETTING_Bool, &Config.EnableBasicInfo, 0, 1);
+  AddConsoleSetting("averaging", SETTING_Bool, &Config.EnableAveraging, 0, 1);
+  AddConsoleSetting("domoticz", SETTING_Bool, &Config.EnableDomoticz, 0, 1);
+  AddConsoleSetting("domoticz_window", SETTING_Int, &Config.DomoticzWindow, -1, STATS_Windows - 1);
+  AddConsoleSetting("idx_voltage", SETTING_Int, &Config.Idx.LineVoltage, 0, 65535);
+  AddConsoleSetting("idx_current", SETTING_Int, &Config.Idx.LineCurrent, 0, 65535);
+  AddConsoleSetting("idx_power", SETTING_Int, &Config.Idx.ActivePower, 0, 65535);
+  AddConsoleSetting("idx_import_power", SETTING_Int, &Config.Idx.ImportPower, 0, 65535);
+  AddConsoleSetting("idx_export_power", SETTING_Int, &Config.Idx.ExportPower, 0, 65535);
+  AddConsoleSetting("idx_frequency", SETTING_Int, &Config.Idx.LineFrequency, 0, 65535);
+  AddConsoleSetting("idx_import", SETTING_Int, &Config.Idx.ImportEnergy, 0, 65535);
+  AddConsoleSetting("idx_export", SETTING_Int, &Config.Idx.ExportEnergy, 0, 65535);
+  AddConsoleSetting("idx_pf", SETTING_Int, &Config.Idx.PowerFactor, 0, 65535);
+  AddConsoleSetting("idx_dcv", SETTING_Int, &Config.Idx.DCVoltage, 0, 65535);
+  AddConsoleSetting("idx_temperature", SETTING_Int, &Config.Idx.PCBTemperature, 0, 65535);
+  AddConsoleSetting("ugain", SETTING_Hex, &Config.UGain, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("igain", SETTING_Hex, &Config.IGain, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("lgain", SETTING_Hex, &Config.LGain, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("lphi", SETTING_Hex, &Config.LPhi, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("uoffset", SETTING_Hex, &Config.UOffset, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("ioffset", SETTING_Hex, &Config.IOffset, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("poffset", SETTING_Hex, &Config.POffset, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("qoffset", SETTING_Hex, &Config.QOffset, 0, 0xFFFF, RebootToApply);
+  AddConsoleSetting("adc_constant", SETTING_Float, &Config.ADCConstant, 0, 100);
+
+  AddConsoleCommand("report", "Diagnostic Report [text|json|binary]", ReportCommand);
+  AddConsoleCommand("bench", "Benchmark (JSON)", BenchmarkCommand);
+  AddConsoleCommand("replay", "Replay Scenarios (JSON) [steps|flip|sag|noise|trace|all]", ReplayCommand);
+  AddConsoleCommand("calibrate", "Calibrate to a Reference <volts> [amps], or offset | phase | stop", CalibrateCommand);
+  AddConsoleCommand("config", "Config Store [save|reset]", ConfigCommand);
+  AddConsoleCommand("filter", "Set a Filter (see Filters.h)", FilterCommand);
+  AddConsoleCommand("trace", "Register Trace [on|burst|off]", TraceCommand);
+  AddConsoleCommand("range", "Current Range [auto|normal|low]", RangeCommand);
+  AddConsoleCommand("direction", "Energy Direction Change Events", DirectionCommand);
+  AddConsoleCommand("reboot", "Restart the ESP32", RebootCommand);
+  AddConsoleDump("trace", TraceDumpLength, TraceDumpRead);
 }
 
 // **************** SETUP ****************
 void setup()
 {
 
+  // Analog Sampler.  The first values are ready after AnalogPeriod
+  if (EnableAnalogSampler == true)
+    InitialiseAnalogSampler();
+
   // Stabalise
   delay(250);
 
@@ -763,13 +659,16 @@ void setup()
     ;
   Serial.println("");
 
+  // Buffered Logger.  Lines logged before this are held until now.
+  InitialiseLogger();
+
   // Application Info
-  Serial.println("");
-  Serial.println(AppVersion + " Initialized");
-  Serial.println(AppBuild);
-  Serial.println(AppName);
-  Serial.println("GTEM Hardware Setup and Power-Up Test");
-  Serial.println("");
+  LogInfo("");
+  LogInfo("%s Initialized", AppVersion);
+  LogInfo("%s", AppBuild);
+  LogInfo("%s", AppName);
+  LogInfo("GTEM Hardware Setup and Power-Up Test");
+  LogInfo("");
 
   // LEDs
   pinMode(LED_Red, OUTPUT);
@@ -792,9 +691,42 @@ void setup()
   }
 
   InitializeEEPROM(); // Initialize EEPROM
+  LoadConfig();       // Saved Configuration, before anything that uses it
+
+  // Serial Console
+  if (EnableConsole == true)
+  {
+    InitialiseConsoleSettings();
+    InitialiseConsole(eic);
+  }
+
+  // Saved Calibration Gains, Phase and Offsets
+  if (Config.UGain > 0)
+    eic.SetUGain(Config.UGain);
+  if (Config.IGain > 0)
+    eic.SetIGain(Config.IGain);
+  if (Config.LGain > 0)
+    eic.SetLGain(Config.LGain);
+  if (Config.LPhi > 0)
+    eic.SetLPhi(Config.LPhi);
+  if (Config.UOffset > 0)
+    eic.SetUOffset(Config.UOffset);
+  if (Config.IOffset > 0)
+    eic.SetIOffset(Config.IOffset);
+  if (Config.POffset > 0)
+    eic.SetPOffset(Config.POffset);
+  if (Config.QOffset > 0)
+    eic.SetQOffset(Config.QOffset);
 
   /*Initialise ATM90E26 + SPI port */
-  eic.InitEnergyIC();
+  {
+    LATENCY_SCOPE(LAT_InitEnergyIC);
+    eic.InitEnergyIC();
+  }
+
+  // Energy Direction Change IRQ.  After InitEnergyIC(), as it enables RevPEn on the ATM90E26
+  if (EnableDirectionEvents == true)
+    InitialiseDirectionEvents(eic, ATM_IRQ);
 
   // Stabalise
   delay(250);
@@ -805,43 +737,68 @@ void setup()
     ReadADCVoltage();  // Read AC>DC Input Voltage
   }
 
-  DisplayRegisters(); // Display Registers Once.  Update CRC if required and store in EEPROM.  Do not disable.
-}
-
-// **************** LOOP ****************
-void loop()
-{
+  // Live Stream Dashboard
+  if (EnableLiveStream == true)
+  {
+    InitialiseWiFi();
+    SnapshotRate = LiveStreamRate;
+    InitialiseLiveStream();
+  }
 
-  // LED Red Flashing if CRC Error
-  if (CRCErrorFlag)
+  // InfluxDB Batch Writer
+  if (EnableInfluxDB == true)
   {
-    digitalWrite(LED_Red, HIGH);
-    delay(200);
-    digitalWrite(LED_Red, LOW);
-    delay(200);
+    InitialiseWiFi();
+    InitialiseInfluxDB();
   }
-  else
+
+  // Modbus TCP Server
+  if (EnableModbus == true)
   {
-    if (EnableDomoticz == true)
-    {
-      // PublishRegisters
-      ReadTemperature();  // Read PCB NTC Temperature
-      ReadADCVoltage();   // Read AC>DC Input Voltage
-      PublishRegisters(); // Publish to Domoticz
-    }
+    InitialiseWiFi();
+    InitialiseModbus();
+  }
 
-    if (EnableBasicInfo == true)
-    {
-      DisplayRegisters(); // Display Basic Readings
-      Serial.println("");
-    }
+  // Rolling Statistics
+  if (EnableStatistics == true)
+    InitialiseStatistics();
 
-    // Heatbeat LED
-    digitalWrite(LED_Blue, LOW);
-    delay(50);
-    digitalWrite(LED_Blue, HIGH);
+  // Filter Pipeline
+  if (EnableFilters == true)
+    InitialiseFilters();
 
-    // Loop Delay
-    delay(LoopDelay * 1000);
-  }
+  // Adaptive Sampling
+  if (EnableAdaptiveRate == true)
+    InitialiseAdaptiveRate();
+
+  // Current Range, with the boot Calibration as the Normal range
+  InitialiseCurrentRange(eic);
+
+  // Snapshot Pipeline, for the Snapshot outputs and Current Range switching
+  if (EnableLiveStream == true || EnableInfluxDB == true || EnableModbus == true || EnableStatistics == true || EnableCurrentRange == true)
+    StartSnapshotTask(eic);
+
+  // Scheduler Jobs
+  HeartbeatJobId = AddJob("Heartbeat", HeartbeatJob, Config.LoopDelay * 1000);
+  HeartbeatOffJob = AddOneShotJob("Heartbeat Off", HeartbeatOff);
+  GreenBlinkJob = AddOneShotJob("Green Blink", GreenBlink);
+  AddJob("CRC Error LED", CRCErrorJob, 200);
+  AddJob("Health Check", HealthCheckJob, 1000);
+  AddJob("Serial Writer", SerialWriterJob, SerialWriterDrainTime);
+  DomoticzJobId = AddJob("Domoticz", PublishJob, Config.LoopDelay * 1000);
+  BasicInfoJobId = AddJob("Basic Info", BasicInfoJob, Config.LoopDelay * 1000, Config.LoopDelay * 1000);
+  InitialiseCalibration(eic);
+
+  // Benchmark, JSON to Serial
+  if (EnableBenchmark == true)
+    RunBenchmarks(eic, AppVersion.c_str());
+
+  DisplayRegisters(); // Display Registers Once.  Update CRC if required and store in EEPROM.  Do not disable.
+}
+
+// **************** LOOP ****************
+void loop()
+{
+  // Run Scheduler Jobs as they fall due.  Sleeps in between.
+  RunScheduler();
 }
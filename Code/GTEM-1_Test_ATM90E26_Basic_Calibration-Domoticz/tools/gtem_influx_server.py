@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+
+  InfluxDB Stand-in.  A small HTTP server that accepts the GTEM InfluxDB batches (InfluxDB.h) as InfluxDB would, so the
+  writer can be measured without a real server.  Shows points per second, batch sizes, the time to receive each batch,
+  and the age of each point when it arrives (needs NTP on both ends), which is the flush latency the writer adds.
+
+    gtem_influx_server.py                          Listen on port 8086.  Set influx_server to this PC's IP
+    gtem_influx_server.py --port 8087 --every 10   Another port, a summary every 10 s
+    gtem_influx_server.py --fail 0.2               Answer 20% of batches with 503, to exercise the retry backlog
+    gtem_influx_server.py --down 30                Refuse batches for the first 30 s, then accept the backlog
+    gtem_influx_server.py --save points.lp         Append the points received, as line protocol
+
+  Keep-alive connections are held open, as InfluxDB does, and gzip batches (Content-Encoding: gzip) are decompressed.
+
+  Full header information in main.cpp.
+"""
+
+import argparse
+import gzip
+import random
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+class Totals:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.start = time.time()
+        self.reset()
+        self.points_total = 0
+        self.batches_total = 0
+        self.connections = 0
+
+    def reset(self):
+        self.since = time.time()
+        self.points = 0
+        self.batches = 0
+        self.failed = 0
+        self.wire_bytes = 0
+        self.body_bytes = 0
+        self.gzip = 0
+        self.receive_ms = []
+        self.age_ms = []
+        self.latency_lines = 0
+
+
+def percentile(values, p):
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+
+def parse_lines(body, now_ms, totals):
+    """Count points, and the age (ms) of each from its timestamp.  Latency (_latency) and Statistics (_stats) lines are counted apart."""
+    points = 0
+    for line in body.decode(errors="replace").splitlines():
+        fields = line.split(" ")
+        if len(fields) < 2:
+            continue
+        if fields[0].split(",")[0].endswith(("_latency", "_stats")):
+            totals.latency_lines += 1
+            continue
+        points += 1
+        if len(fields) >= 3 and fields[2].isdigit():
+            totals.age_ms.append(now_ms - int(fields[2]))
+    return points
+
+
+class InfluxHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # Keep-alive
+    options = None
+    totals = None
+
+    def setup(self):
+        BaseHTTPRequestHandler.setup(self)
+        with self.totals.lock:
+            self.totals.connections += 1
+
+    def log_message(self, format, *args):
+        pass
+
+    def reply(self, status, text=b""):
+        self.send_response(status)
+        self.send_header("Content-Length", str(len(text)))
+        self.end_headers()
+        if text:
+            self.wfile.write(text)
+
+    def do_POST(self):
+        start = time.time()
+        length = int(self.headers.get("Content-Length", 0))
+        data = self.rfile.read(length)
+        received = time.time()
+        options = self.options
+        totals = self.totals
+
+        fail = received - totals.start < options.down or random.random() < options.fail
+        if fail:
+            with totals.lock:
+                totals.failed += 1
+            self.reply(503, b"stand-in failure")
+            return
+
+        body = data
+        compressed = self.headers.get("Content-Encoding", "") == "gzip"
+        if compressed:
+            try:
+                body = gzip.decompress(data)
+            except OSError:
+                self.reply(400, b"bad gzip")
+                return
+
+        with totals.lock:
+            points = parse_lines(body, received * 1000, totals)
+            totals.points += points
+            totals.points_total += points
+            totals.batches += 1
+            totals.batches_total += 1
+            totals.wire_bytes += length
+            totals.body_bytes += len(body)
+            totals.gzip += 1 if compressed else 0
+            totals.receive_ms.append((received - start) * 1000)
+        if options.save:
+            with totals.lock, open(options.save, "ab") as out:
+                out.write(body)
+
+        self.reply(204)
+
+
+def report(totals, every):
+    while True:
+        time.sleep(every)
+        with totals.lock:
+            span = time.time() - totals.since
+            ratio = totals.wire_bytes * 100.0 / totals.body_bytes if totals.body_bytes else 0
+            print("%7.1f pts/s  %4d batches (%d gzip, %d failed)  %5.1f pts/batch  %3.0f%% on wire  "
+                  "receive p50 %.1f ms max %.1f ms  age p50 %.0f ms p99 %.0f ms  summary lines %d  total %d pts  %d connections" % (
+                      totals.points / span, totals.batches, totals.gzip, totals.failed,
+                      totals.points / float(totals.batches) if totals.batches else 0, ratio,
+                      percentile(totals.receive_ms, 50), max(totals.receive_ms or [0]),
+                      percentile(totals.age_ms, 50), percentile(totals.age_ms, 99),
+                      totals.latency_lines, totals.points_total, totals.connections), flush=True)
+            totals.reset()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="InfluxDB stand-in, to measure the GTEM InfluxDB writer")
+    parser.add_argument("--port", type=int, default=8086)
+    parser.add_argument("--every", type=float, default=5, help="Summary interval (s)")
+    parser.add_argument("--fail", type=float, default=0, help="Fraction of batches answered 503")
+    parser.add_argument("--down", type=float, default=0, help="Answer 503 for this many seconds from start")
+    parser.add_argument("--save", help="Append received points to this file")
+    args = parser.parse_args()
+
+    InfluxHandler.options = args
+    InfluxHandler.totals = Totals()
+    threading.Thread(target=report, args=(InfluxHandler.totals, args.every), daemon=True).start()
+
+    server = ThreadingHTTPServer(("", args.port), InfluxHandler)
+    print("InfluxDB stand-in on port %d.  Ctrl-C to stop." % args.port, flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
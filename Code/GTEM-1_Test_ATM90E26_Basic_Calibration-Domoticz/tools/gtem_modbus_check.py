@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+
+  Modbus TCP Check.  A plain socket Modbus client (no libraries) that checks the GTEM Modbus TCP Server (ModbusTCP.h)
+  from a PC, as a SCADA master would, then polls it from several connections at once to measure the poll rate.
+
+    gtem_modbus_check.py 192.168.1.50                        Checks, then 4 masters polling for 10 s
+    gtem_modbus_check.py 192.168.1.50 --masters 2 --time 60  2 masters for a minute
+    gtem_modbus_check.py 192.168.1.50 --show                 Also show the register map, decoded
+
+  Checks:
+    - FC 3 and FC 4 return the same map, with the Transaction Identifier echoed
+    - Illegal Function (FC 6), Illegal Data Address (unmapped, or spanning both blocks) and Illegal Data Value (quantity 0)
+    - Import and Export Power agree with Active Power, and the Statistics block (100 to 159) reads
+    - One more master than ModbusClients is refused, and the others keep polling meanwhile
+    - While polling, each master sees the Snapshot Number only go forward, and the Energy totals never fall
+
+  Exit 1 on any failure.
+
+  Full header information in main.cpp.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+MB_REGISTERS = 18
+MB_STATISTICS = 100
+MB_STATISTICS_COUNT = 60
+MB_CLIENTS = 4  # ModbusClients
+
+
+class ModbusError(Exception):
+    pass
+
+
+class Master:
+    def __init__(self, host, port, timeout=2.0):
+        self.sock = socket.create_connection((host, port), timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.transaction = 0
+
+    def close(self):
+        self.sock.close()
+
+    def receive(self, length):
+        data = b""
+        while len(data) < length:
+            chunk = self.sock.recv(length - len(data))
+            if not chunk:
+                raise ModbusError("connection closed")
+            data += chunk
+        return data
+
+    def request(self, pdu, unit=1):
+        """Send a PDU, return the response PDU.  Checks the MBAP header."""
+        self.transaction = (self.transaction + 1) & 0xFFFF
+        self.sock.sendall(struct.pack(">HHHB", self.transaction, 0, len(pdu) + 1, unit) + pdu)
+        transaction, protocol, length, reply_unit = struct.unpack(">HHHB", self.receive(7))
+        if transaction != self.transaction or protocol != 0 or reply_unit != unit:
+            raise ModbusError("MBAP header %d/%d/%d, expected %d/0/%d" % (transaction, protocol, reply_unit, self.transaction, unit))
+        return self.receive(length - 1)
+
+    def read(self, function, address, quantity):
+        """Registers, or the exception code as a negative int"""
+        pdu = self.request(struct.pack(">BHH", function, address, quantity))
+        if pdu[0] == function | 0x80:
+            return -pdu[1]
+        if pdu[0] != function or pdu[1] != quantity * 2 or len(pdu) != 2 + quantity * 2:
+            raise ModbusError("FC %d response %r" % (function, pdu[:4]))
+        return list(struct.unpack(">%dH" % quantity, pdu[2:]))
+
+
+def signed(value):
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def decode(regs):
+    return {
+        "LineVoltage": regs[0] / 100.0,
+        "LineCurrent": regs[1] / 1000.0,
+        "ActivePower": signed(regs[2]),
+        "ImportPower": regs[3],
+        "ExportPower": regs[4],
+        "LineFrequency": regs[5] / 100.0,
+        "PowerFactor": signed(regs[6]) / 1000.0,
+        "SysStatus": "0x%04X" % regs[7],
+        "MeterStatus": "0x%04X" % regs[8],
+        "ImportEnergy": (regs[9] << 16 | regs[10]) / 1000.0,
+        "ExportEnergy": (regs[11] << 16 | regs[12]) / 1000.0,
+        "Sequence": regs[13] << 16 | regs[14],
+        "SnapshotTime": regs[15] << 16 | regs[16],
+        "Range": regs[17] >> 8,
+        "Flags": "0x%02X" % (regs[17] & 0xFF),
+    }
+
+
+def check(host, port, show):
+    """One master.  Returns the failures."""
+    failures = []
+    m = Master(host, port)
+
+    holding = m.read(3, 0, MB_REGISTERS)
+    inputs = m.read(4, 0, MB_REGISTERS)
+    if isinstance(holding, int) or isinstance(inputs, int):
+        return ["Register map read refused (exception %d/%d)" % (-holding if isinstance(holding, int) else 0, -inputs if isinstance(inputs, int) else 0)]
+    if holding[13:15] == inputs[13:15] and holding != inputs:
+        failures.append("FC 3 and FC 4 differ for the same Snapshot")
+
+    values = decode(holding)
+    if show:
+        for name, value in values.items():
+            print("    %-14s %s" % (name, value))
+    power = values["ActivePower"]
+    if values["ImportPower"] != max(power, 0) or values["ExportPower"] != max(-power, 0):
+        failures.append("Import/Export Power %d/%d do not match Active Power %d" % (values["ImportPower"], values["ExportPower"], power))
+
+    for name, function, address, quantity, code in [
+            ("Illegal Function", 6, 0, 1, 1),
+            ("Unmapped address", 3, MB_REGISTERS, 1, 2),
+            ("Read spanning both blocks", 3, MB_REGISTERS - 1, MB_STATISTICS, 2),
+            ("Past the Statistics block", 4, MB_STATISTICS + MB_STATISTICS_COUNT - 1, 2, 2),
+            ("Quantity 0", 3, 0, 0, 3),
+            ("Quantity 126", 3, 0, 126, 3)]:
+        result = m.read(function, address, quantity)
+        if result != -code:
+            failures.append("%s: expected exception %d, got %s" % (name, code, "exception %d" % -result if isinstance(result, int) else "data"))
+
+    stats = m.read(4, MB_STATISTICS, MB_STATISTICS_COUNT)
+    if isinstance(stats, int):
+        failures.append("Statistics block refused (exception %d)" % -stats)
+
+    m.close()
+    return failures
+
+
+def poll(host, port, until, result):
+    """Poll the map until the time given, checking the values only go forward"""
+    m = Master(host, port)
+    last_sequence = last_import = last_export = None
+    times = []
+    try:
+        while time.time() < until:
+            start = time.perf_counter()
+            regs = m.read(3 if len(times) % 2 else 4, 0, MB_REGISTERS)
+            times.append(time.perf_counter() - start)
+            v = decode(regs)
+            if last_sequence is not None:
+                if v["Sequence"] < last_sequence:
+                    result["failures"].append("Snapshot Number went back %d to %d" % (last_sequence, v["Sequence"]))
+                if v["ImportEnergy"] < last_import or v["ExportEnergy"] < last_export:
+                    result["failures"].append("Energy total fell")
+            last_sequence, last_import, last_export = v["Sequence"], v["ImportEnergy"], v["ExportEnergy"]
+    except (ModbusError, OSError) as e:
+        result["failures"].append("Master dropped: %s" % e)
+    finally:
+        m.close()
+    result["times"] = times
+
+
+def refused(host, port, masters):
+    """One more master than the server holds.  True if it was closed without an answer."""
+    extra = Master(host, port)
+    try:
+        extra.read(3, 0, 1)
+        return False
+    except (ModbusError, OSError):
+        return True
+    finally:
+        extra.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check and load the GTEM Modbus TCP Server")
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=502)
+    parser.add_argument("--masters", type=int, default=MB_CLIENTS, help="Masters polling at once (default %d)" % MB_CLIENTS)
+    parser.add_argument("--time", type=float, default=10, help="Polling time (s)")
+    parser.add_argument("--show", action="store_true", help="Show the register map")
+    args = parser.parse_args()
+
+    try:
+        failures = check(args.host, args.port, args.show)
+    except (ModbusError, OSError) as e:
+        sys.exit("FAIL  %s" % e)
+
+    until = time.time() + args.time
+    results = [{"failures": [], "times": []} for i in range(args.masters)]
+    threads = [threading.Thread(target=poll, args=(args.host, args.port, until, r)) for r in results]
+    for t in threads:
+        t.start()
+    if args.masters >= MB_CLIENTS:
+        time.sleep(min(1.0, args.time / 4))
+        if not refused(args.host, args.port, args.masters):
+            failures.append("Master %d of %d was not refused" % (args.masters + 1, MB_CLIENTS))
+    for t in threads:
+        t.join()
+
+    total = 0
+    for i, r in enumerate(results):
+        times = sorted(r["times"])
+        total += len(times)
+        if times:
+            print("Master %d  %6d polls  %7.1f polls/s  p50 %6.1f ms  p99 %6.1f ms  max %6.1f ms" % (
+                i + 1, len(times), len(times) / args.time, times[len(times) // 2] * 1000, times[int(len(times) * 0.99)] * 1000, times[-1] * 1000))
+        failures.extend(r["failures"])
+    print("All       %6d polls  %7.1f polls/s" % (total, total / args.time))
+
+    for failure in failures:
+        print("FAIL  %s" % failure)
+    if failures:
+        sys.exit(1)
+    print("OK")
+
+
+if __name__ == "__main__":
+    main()
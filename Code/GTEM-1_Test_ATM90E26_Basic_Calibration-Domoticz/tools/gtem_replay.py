@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+
+  Replay Results.  Reads the JSON lines of a GTEM 'replay' (Replay.h), shows throughput and time per stage, and checks
+  each stage's output digest against a golden file, so a change in what the firmware outputs for the same input is caught.
+
+    gtem_replay.py capture.txt                               Results from a saved serial log
+    gtem_replay.py --serial /dev/ttyUSB0                     Run 'replay all' on the board (needs pyserial)
+    gtem_replay.py capture.txt --golden golden.json          Compare digests.  Exit 1 on a difference
+    gtem_replay.py capture.txt --golden golden.json --update Save these results as the golden file
+    gtem_replay.py --native                                  Run the native build's Replay (pio run -e native first)
+                                                             and compare with tools/replay_native.json
+
+  A missing golden file is written from the results.  Timings are shown against the golden run, but only digests fail.
+  Host and board digests differ (libm and compiler), so the native build has its own golden file.
+
+  Full header information in main.cpp.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+NATIVE_PROGRAM = os.path.join(TOOLS, "..", ".pio", "build", "native", "program")
+NATIVE_GOLDEN = os.path.join(TOOLS, "replay_native.json")
+
+
+def serial_capture(port, baud, scenario):
+    import serial  # pyserial
+
+    with serial.Serial(port, baud, timeout=10) as s:
+        s.reset_input_buffer()
+        s.write(("replay %s\n" % scenario).encode())
+        data = b""
+        while True:
+            chunk = s.read(4096)
+            if not chunk:
+                return data.decode(errors="replace")
+            data += chunk
+
+
+def native_capture(program):
+    """Replay output of the native build.  Each generated scenario."""
+    return subprocess.run([program, "replay"], check=True, stdout=subprocess.PIPE).stdout.decode(errors="replace")
+
+
+def parse_results(text):
+    """Replay results by scenario.  The last run of each is kept."""
+    results = {}
+    for line in text.splitlines():
+        start = line.find('{"replay"')
+        if start < 0:
+            continue
+        try:
+            result = json.loads(line[start:])
+        except ValueError:
+            continue
+        results[result["scenario"]] = result
+    return results
+
+
+def show(results, golden):
+    for name, result in results.items():
+        rate = result["snapshots"] * 1e6 / result["us"] if result["us"] else 0
+        print("%-8s %6d snapshots  %7d ms simulated  %8d us  %9.0f snapshots/s  x%d real time" % (
+            name, result["snapshots"], result["sim_ms"], result["us"], rate, result["speedup"]))
+        base = {s["name"]: s for s in golden.get(name, {}).get("stages", [])}
+        for stage in result["stages"]:
+            was = base.get(stage["name"])
+            change = ""
+            if was and was["ns_mean"]:
+                change = "%+6.1f%%" % ((stage["ns_mean"] - was["ns_mean"]) * 100.0 / was["ns_mean"])
+            check = "" if not was else ("ok" if was["digest"] == stage["digest"] else "DIFFERS (golden %s)" % was["digest"])
+            print("    %-12s %7d runs  %9d ns mean  %9d ns max  %7s  %s %s" % (
+                stage["name"], stage["runs"], stage["ns_mean"], stage["ns_max"], change, stage["digest"], check))
+
+
+def compare(results, golden):
+    """Differences from golden, as text.  Scenarios missing from either side are not compared."""
+    differences = []
+    for name, result in results.items():
+        if name not in golden:
+            continue
+        if result["snapshots"] != golden[name]["snapshots"]:
+            differences.append("%s: %d snapshots, golden %d" % (name, result["snapshots"], golden[name]["snapshots"]))
+        base = {s["name"]: s["digest"] for s in golden[name]["stages"]}
+        for stage in result["stages"]:
+            if stage["name"] in base and base[stage["name"]] != stage["digest"]:
+                differences.append("%s: %s output differs" % (name, stage["name"]))
+    return differences
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check GTEM Replay results against a golden file")
+    parser.add_argument("capture", nargs="?", help="Serial capture holding the 'replay' output")
+    parser.add_argument("--serial", help="Serial port to run 'replay' on")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--native", nargs="?", const=NATIVE_PROGRAM, help="Run the native build's Replay (default %(const)s)")
+    parser.add_argument("--scenario", default="all", help="Scenario to run with --serial or --native (default all)")
+    parser.add_argument("--golden", help="Golden results (JSON).  Default for --native is tools/replay_native.json")
+    parser.add_argument("--update", action="store_true", help="Write the results as the golden file")
+    args = parser.parse_args()
+
+    if args.native:
+        text = native_capture(args.native)
+        args.golden = args.golden or NATIVE_GOLDEN
+    elif args.serial:
+        text = serial_capture(args.serial, args.baud, args.scenario)
+    elif args.capture:
+        text = open(args.capture, errors="replace").read()
+    else:
+        parser.error("capture file or --serial needed")
+
+    results = parse_results(text)
+    if args.native and args.scenario != "all":
+        results = {name: result for name, result in results.items() if name == args.scenario}
+    if not results:
+        sys.exit("No Replay results found")
+
+    golden = {}
+    if args.golden and os.path.exists(args.golden) and not args.update:
+        golden = json.load(open(args.golden))
+
+    show(results, golden)
+
+    if args.golden and (args.update or not golden):
+        with open(args.golden, "w") as out:
+            json.dump(results, out, indent=1, sort_keys=True)
+        print("Golden results written to %s" % args.golden)
+        return
+
+    differences = compare(results, golden)
+    for difference in differences:
+        print(difference)
+    if differences:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+
+  Register Trace Decoder.  Decodes a GTEM Register Trace ('trace on' or 'trace burst', then 'dump trace' or /trace),
+  scaling each register per the Register Table in ATM90E26Registers.h, to CSV or a per register summary.
+
+    gtem_trace.py capture.bin                 CSV to stdout.  A serial log holding a 'dump trace', or a /trace download
+    gtem_trace.py --serial /dev/ttyUSB0       Ask the board for 'dump trace' (needs pyserial)
+    gtem_trace.py capture.bin --summary       Count, rate, min, mean and max of each register read
+    gtem_trace.py capture.bin -o trace.csv    CSV to a file
+
+  Full header information in main.cpp.
+"""
+
+import argparse
+import csv
+import os
+import re
+import struct
+import sys
+import zlib
+
+REGISTERS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "lib", "ATM90E26", "src", "ATM90E26Registers.h")
+
+REG_SIGNED = 0x01
+REG_SIGNMAGNITUDE = 0x02
+
+
+def load_registers(path):
+    """Register Table from ATM90E26Registers.h.  Address to (Name, Flags, Scale, Unit)."""
+    text = open(path).read()
+    defines = {m.group(1): int(m.group(2), 16) for m in re.finditer(r"#define (\w+) (0x[0-9A-Fa-f]+)", text)}
+    registers = {}
+    for m in re.finditer(r'\{(\w+), "(\w+)", "[^"]*", ([\w| ]+), ([\d.]+), "([^"]*)"', text):
+        flags = 0
+        for flag in m.group(3).split("|"):
+            flag = flag.strip()
+            flags |= defines.get(flag, 0) if not flag.isdigit() else int(flag)
+        registers[defines[m.group(1)]] = (m.group(2), flags, float(m.group(4)), m.group(5))
+    return registers
+
+
+def decode_value(info, raw):
+    """Raw register value in its Unit, as RegisterDecode().  None if not a measurement."""
+    name, flags, scale, unit = info
+    if scale <= 0:
+        return None
+    if flags & REG_SIGNED:
+        value = raw - 0x10000 if raw & 0x8000 else raw
+    elif flags & REG_SIGNMAGNITUDE and raw & 0x8000:
+        value = -(raw & 0x7FFF)
+    else:
+        value = raw
+    return value * scale
+
+
+def find_trace(data):
+    """Trace dump data from a capture.  A framed 'dump trace' (GTEMDUMP, length, data, CRC32) or a bare /trace download."""
+    start = data.find(b"GTEMDUMP")
+    while start >= 0:
+        length, = struct.unpack_from("<I", data, start + 8)
+        body = data[start + 12:start + 12 + length]
+        if body[:4] == b"GTRC":
+            crc, = struct.unpack_from("<I", data, start + 12 + length)
+            if zlib.crc32(body) & 0xFFFFFFFF != crc:
+                sys.exit("Trace dump CRC error.  Capture again.")
+            return body
+        start = data.find(b"GTEMDUMP", start + 8)
+    if data[:4] == b"GTRC":
+        return data
+    sys.exit("No Register Trace found.  Capture the output of 'dump trace', or download /trace.")
+
+
+def parse_trace(body):
+    """Trace entries, oldest first, as (Time us, Read, Address, Value, Core)."""
+    magic, version, size, flags, count = struct.unpack_from("<4sBBBxI", body, 0)
+    if version != 1 or size != 8:
+        sys.exit("Unknown Trace format %d (entry size %d)" % (version, size))
+    entries = []
+    base = None
+    last = 0
+    for i in range(count):
+        time, address, eflags, value = struct.unpack_from("<IBBH", body, 12 + i * 8)
+        if base is None:
+            base = time
+        elapsed = (time - base) & 0xFFFFFFFF  # us since the first entry.  esp_timer low 32 bits, so wraps every 71 minutes
+        if elapsed < last:
+            elapsed += 1 << 32
+        last = elapsed
+        entries.append((elapsed, bool(address & 0x80), address & 0x7F, value, eflags & 0x01))
+    return entries, bool(flags & 0x01)
+
+
+def serial_capture(port, baud):
+    import serial  # pyserial
+
+    with serial.Serial(port, baud, timeout=5) as s:
+        s.reset_input_buffer()
+        s.write(b"dump trace\n")
+        data = b""
+        while True:
+            chunk = s.read(4096)
+            if not chunk:
+                return data
+            data += chunk
+
+
+def write_csv(entries, registers, out):
+    w = csv.writer(out)
+    w.writerow(["time_us", "op", "address", "register", "raw", "value", "unit", "core"])
+    for time, read, address, raw, core in entries:
+        info = registers.get(address, ("0x%02X" % address, 0, 0, ""))
+        value = decode_value(info, raw)
+        w.writerow([time, "R" if read else "W", "0x%02X" % address, info[0], "0x%04X" % raw, "" if value is None else "%g" % value, info[3], core])
+
+
+def write_summary(entries, registers, wrapped):
+    span = entries[-1][0] - entries[0][0] if len(entries) > 1 else 0
+    print("Entries %d over %.3f s%s" % (len(entries), span / 1e6, " (ring wrapped, oldest lost)" if wrapped else ""))
+    print("%-10s %8s %9s %12s %12s %12s %s" % ("Register", "Reads", "Reads/s", "Min", "Mean", "Max", "Unit"))
+    reads = {}
+    for time, read, address, raw, core in entries:
+        if read:
+            reads.setdefault(address, []).append(raw)
+    for address in sorted(reads):
+        info = registers.get(address, ("0x%02X" % address, 0, 0, ""))
+        values = [decode_value(info, raw) for raw in reads[address]]
+        rate = len(values) / (span / 1e6) if span else 0
+        if values[0] is None:
+            distinct = sorted(set(reads[address]))
+            shown = " ".join("0x%04X" % v for v in distinct[:6]) + (" ..." if len(distinct) > 6 else "")
+            print("%-10s %8d %9.1f %s" % (info[0], len(values), rate, shown))
+        else:
+            print("%-10s %8d %9.1f %12g %12g %12g %s" % (info[0], len(values), rate, min(values), sum(values) / len(values), max(values), info[3]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a GTEM Register Trace")
+    parser.add_argument("capture", nargs="?", help="Serial capture holding 'dump trace', or a /trace download")
+    parser.add_argument("--serial", help="Serial port to request 'dump trace' from")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--save", help="Save the raw capture from --serial")
+    parser.add_argument("--registers", default=REGISTERS_H, help="ATM90E26Registers.h")
+    parser.add_argument("--summary", action="store_true", help="Per register summary, not CSV")
+    parser.add_argument("-o", "--output", help="CSV file (default stdout)")
+    args = parser.parse_args()
+
+    if args.serial:
+        data = serial_capture(args.serial, args.baud)
+        if args.save:
+            open(args.save, "wb").write(data)
+    elif args.capture:
+        data = open(args.capture, "rb").read()
+    else:
+        parser.error("capture file or --serial needed")
+
+    registers = load_registers(args.registers)
+    entries, wrapped = parse_trace(find_trace(data))
+
+    if args.summary:
+        write_summary(entries, registers, wrapped)
+    elif args.output:
+        with open(args.output, "w", newline="") as out:
+            write_csv(entries, registers, out)
+    else:
+        write_csv(entries, registers, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
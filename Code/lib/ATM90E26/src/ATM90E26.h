@@ -0,0 +1,492 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Shared ATM90E26 driver library.  Used by both the Arduino and PlatformIO GTEM-1 test code.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+#ifndef GTEM_ATM90E26_H
+#define GTEM_ATM90E26_H
+
+// Libraries
+#include <Arduino.h>
+#include <SPI.h>
+#include <ATM90E26Registers.h> // Register Addresses and Register Table
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// SPI Transport.  Any struct with the same static functions may be used instead, i.e. one that wraps these with timing.
+// Lock and Unlock hold the ATM90E26 for a sequence of transfers, so another task's transfer cannot land in between.
+struct ATM90E26_SPITransport
+{
+  static void Begin(int cs)
+  {
+    if (Mutex() == NULL)
+      Mutex() = xSemaphoreCreateRecursiveMutex();
+
+    pinMode(cs, OUTPUT);
+
+    /* Enable SPI */
+    SPI.begin();
+    SPI.setBitOrder(MSBFIRST);
+    SPI.setDataMode(SPI_MODE3);
+    SPI.setClockDivider(SPI_CLOCK_DIV16);
+  }
+
+  static unsigned short Read(int cs, unsigned char address)
+  {
+    unsigned short val;
+
+    Select(cs, address | 0x80);
+    val = SPI.transfer(0x00) << 8; // MSB first
+    val |= SPI.transfer(0x00);
+    Deselect(cs);
+
+    return val;
+  }
+
+  // Recursive, so a locked sequence may call another.  Not held until Begin().
+  static void Lock(int cs)
+  {
+    if (Mutex() != NULL)
+      xSemaphoreTakeRecursive(Mutex(), portMAX_DELAY);
+  }
+
+  static void Unlock(int cs)
+  {
+    if (Mutex() != NULL)
+      xSemaphoreGiveRecursive(Mutex());
+  }
+
+  static SemaphoreHandle_t &Mutex()
+  {
+    static SemaphoreHandle_t mutex = NULL;
+    return mutex;
+  }
+
+  static void Write(int cs, unsigned char address, unsigned short val)
+  {
+    Select(cs, address & 0x7F);
+    SPI.transfer(val >> 8); // MSB first
+    SPI.transfer(val & 0xFF);
+    Deselect(cs);
+  }
+
+  // SPI interface rate is 200 to 160k bps. It Will need to be slowed down for EnergyIC
+  static void Select(int cs, unsigned char address)
+  {
+    SPI.beginTransaction(SPISettings(200000, MSBFIRST, SPI_MODE3));
+    digitalWrite(cs, LOW);
+    delayMicroseconds(10);
+    SPI.transfer(address);
+    /* Must wait 4 us for data to become valid */
+    delayMicroseconds(4);
+  }
+
+  static void Deselect(int cs)
+  {
+    digitalWrite(cs, HIGH);
+    delayMicroseconds(10);
+    SPI.endTransaction();
+  }
+};
+
+// Calibration Profile.  The GTEM-1 bring up defaults.  Derive from this and hide only the values to change.
+// Checksums are the ATM90E26 calculated CS1/CS2 for these values.  Change a value, and the Checksum needs to change with it.
+struct ATM90E26_Profile
+{
+  static constexpr unsigned short FunctionEnable = 0x0030;   // Voltage sag irq=1, report on warnout pin=1, energy dir change irq=0
+  static constexpr unsigned short SagThreshold = 0x17DD;     // Voltage sag threshhold 0x1F2F
+  static constexpr unsigned short MeteringMode = 0x9422;     // Metering Mode Configuration. All defaults. See pg 31 of datasheet.
+  static constexpr unsigned short PLConstantH = 0x05CD;      // PL Constant MSB 0x21 0x0525
+  static constexpr unsigned short PLConstantL = 0xBB1C;      // PL Constant LSB 0x22 0xFCB2
+  static constexpr unsigned short LineGain = 0x1D39;         // Line calibration gain 0x1D39
+  static constexpr unsigned short LineAngle = 0x0000;        // Line calibration angle
+  static constexpr unsigned short PStartThreshold = 0x08BD;  // Active Startup Power Threshold
+  static constexpr unsigned short PNoLoadThreshold = 0x0000; // Active No-Load Power Threshold
+  static constexpr unsigned short QStartThreshold = 0x0AEC;  // Reactive Startup Power Threshold
+  static constexpr unsigned short QNoLoadThreshold = 0x0000; // Reactive No-Load Power Threshold
+  static constexpr unsigned short VoltageGain = 0xA028;      // Voltage rms gain
+  static constexpr unsigned short CurrentGain = 0x7DFB;      // L line current gain
+  static constexpr unsigned short VoltageOffset = 0x0000;    // Voltage offset
+  static constexpr unsigned short CurrentOffset = 0x0000;    // L line current offset
+  static constexpr unsigned short PowerOffset = 0x0000;      // L line active power offset
+  static constexpr unsigned short ReactiveOffset = 0x0000;   // L line reactive power offset
+  static constexpr unsigned short Checksum1 = 0xAE70;        // Run the application. Take auto calculated values and update here
+  static constexpr unsigned short Checksum2 = 0x4BE5;        // Run the application. Take auto calculated values and update here
+
+  // Where the Checksums come from, before being written.  Default is the constants above.
+  static void LoadChecksums(unsigned short &crc1, unsigned short &crc2) {}
+
+  // Checksum Error after InitEnergyIC.  Default displays the values to update above.
+  // Return true to write the Register Defaults again, i.e. after crc1/crc2 are changed to the calculated cs1/cs2.
+  static bool ChecksumError(unsigned short status, unsigned short &crc1, unsigned short cs1, unsigned short &crc2, unsigned short cs2)
+  {
+    if (status & 0xC000) // Checksum 1 Error
+    {
+      Serial.println("");
+      Serial.print("Checksum 1 Error!! Currently: 0x");
+      Serial.print(crc1, HEX);
+      Serial.print("\tPlease change Checksum1 to: 0x");
+      Serial.println(cs1, HEX);
+    }
+    if (status & 0x3000) // Checksum 2 Error
+    {
+      Serial.println("");
+      Serial.print("Checksum 2 Error!! Currently: 0x");
+      Serial.print(crc2, HEX);
+      Serial.print("\tPlease change Checksum2 to: 0x");
+      Serial.println(cs2, HEX);
+    }
+    return false;
+  }
+};
+
+// Health Check Faults.  Bits of CheckHealth()
+enum ATM90E26Fault
+{
+  FAULT_StuckBus = 0x01, // Status or Register read as all 0s or all 1s.  MISO stuck, or no ATM90E26
+  FAULT_Echo = 0x02,     // LastData did not echo the Register just read.  Corrupt transfer
+  FAULT_Checksum = 0x04, // CS1/CS2 error bits set in System Status
+  FAULT_Config = 0x08,   // Ugain not as written.  ATM90E26 has reset, and lost its calibration
+  FAULT_Count = 4
+};
+
+// **************** FUNCTIONS / ROUTINES / CLASSES ****************
+
+// Transport Lock, for the scope it is declared in
+template <class Transport>
+class ATM90E26_Lock
+{
+public:
+  ATM90E26_Lock(int cs) : _cs(cs) { Transport::Lock(cs); }
+  ~ATM90E26_Lock() { Transport::Unlock(_cs); }
+
+private:
+  int _cs;
+};
+
+// ATM90E26 Driver.  CS pin, Transport and Calibration Profile are fixed at compile time, so each board build
+// only carries the code paths it uses.  i.e. ATM90E26<5, ATM90E26_SPITransport, ATM90E26_Profile> eic;
+template <int CS, class Transport = ATM90E26_SPITransport, class Profile = ATM90E26_Profile>
+class ATM90E26
+{
+public:
+  ATM90E26()
+  {
+    _funcen = Profile::FunctionEnable;
+    _mmode = Profile::MeteringMode;
+    _plconsth = Profile::PLConstantH;
+    _plconstl = Profile::PLConstantL;
+    _lgain = Profile::LineGain;
+    _ugain = Profile::VoltageGain;
+    _igain = Profile::CurrentGain;
+    _lphi = Profile::LineAngle;
+    _uoffset = Profile::VoltageOffset;
+    _ioffset = Profile::CurrentOffset;
+    _poffset = Profile::PowerOffset;
+    _qoffset = Profile::ReactiveOffset;
+    _crc1 = Profile::Checksum1;
+    _crc2 = Profile::Checksum2;
+    _importtotal = 0;
+    _exporttotal = 0;
+    _events = 0;
+  }
+
+  double GetLineVoltage() { return ReadRegister<Urms>(); }
+  double GetLineCurrent() { return ReadRegister<Irms>(); }
+  double GetActivePower() { return ReadRegister<Pmean>(); }
+  double GetFrequency() { return ReadRegister<Freq>(); }
+  double GetPowerFactor() { return ReadRegister<PowerF>(); }
+
+  double GetImportPower()
+  {
+    double apower = ReadRegister<Pmean>();
+    return apower > 0 ? apower : 0;
+  }
+
+  double GetExportPower()
+  {
+    double apower = ReadRegister<Pmean>();
+    return apower < 0 ? -apower : 0;
+  }
+
+  // Energy Registers are cleared after reading.  Returns kWh if PL constant set to 1000imp/kWh
+  // The read and the running total are locked together, so no Energy is lost or counted twice between tasks.  Any
+  // reader adds to the total, so one that needs the Energy since it last looked should use the totals, not the return.
+  double GetImportEnergy()
+  {
+    ATM90E26_Lock<Transport> lock(CS);
+    double ienergy = ReadRegister<APenergy>();
+    _importtotal += ienergy;
+    return ienergy;
+  }
+
+  double GetExportEnergy()
+  {
+    ATM90E26_Lock<Transport> lock(CS);
+    double eenergy = ReadRegister<ANenergy>();
+    _exporttotal += eenergy;
+    return eenergy;
+  }
+
+  double GetAbsActiveEnergy() { return ReadRegister<ATenergy>(); }
+  double GetAbsReactiveEnergy() { return ReadRegister<Rtenergy>(); }
+  double GetReactivefwdEnergy() { return ReadRegister<RPenergy>(); }
+
+  // Totals of every Import/Export Energy read since boot, whoever made it.  Does not read the ATM90E26.
+  double GetImportEnergyTotal()
+  {
+    ATM90E26_Lock<Transport> lock(CS);
+    return _importtotal;
+  }
+
+  double GetExportEnergyTotal()
+  {
+    ATM90E26_Lock<Transport> lock(CS);
+    return _exporttotal;
+  }
+
+  void SetFunctionEnable(unsigned short funcen) { _funcen = funcen; }
+  void SetMMode(unsigned short mmode) { _mmode = mmode; }
+  void SetPLConstant(unsigned long plconst)
+  {
+    _plconsth = plconst >> 16;
+    _plconstl = plconst & 0xFFFF;
+  }
+  void SetUGain(unsigned short ugain) { _ugain = ugain; }
+  void SetLGain(unsigned short lgain) { _lgain = lgain; }
+  void SetIGain(unsigned short igain) { _igain = igain; }
+  void SetLPhi(unsigned short lphi) { _lphi = lphi; }
+  void SetUOffset(unsigned short uoffset) { _uoffset = uoffset; }
+  void SetIOffset(unsigned short ioffset) { _ioffset = ioffset; }
+  void SetPOffset(unsigned short poffset) { _poffset = poffset; }
+  void SetQOffset(unsigned short qoffset) { _qoffset = qoffset; }
+  void SetCRC1(unsigned short crc1) { _crc1 = crc1; }
+  void SetCRC2(unsigned short crc2) { _crc2 = crc2; }
+
+  // System Status clears on read, so its event bits (STATUS_Events) are latched here for TakeStatusEvents(), whoever read it.
+  unsigned short GetSysStatus()
+  {
+    unsigned short status = Read(SysStatus);
+    if (status != 0xFFFF)
+      __atomic_fetch_or(&_events, status & STATUS_Events, __ATOMIC_RELAXED);
+    return status;
+  }
+
+  // Event bits latched by GetSysStatus() since the last call.  Clears them.
+  unsigned short TakeStatusEvents() { return __atomic_exchange_n(&_events, 0, __ATOMIC_RELAXED); }
+
+  unsigned short GetFunctionEnable() { return Read(FuncEn); }
+  unsigned short GetFunctionEnableSetting() { return _funcen; } // As set, and written by InitEnergyIC() and Recover().  No read
+  unsigned short GetMeterStatus() { return Read(EnStatus); }
+  unsigned short GetCalStartStatus() { return Read(CalStart); }
+  unsigned short GetLSBStatus() { return Read(LSB); }
+  unsigned short GetMModeStatus() { return Read(MMode); }
+  unsigned long GetPLConstant() { return ((unsigned long)Read(PLconstH) << 16) | Read(PLconstL); }
+  unsigned short GetCS1Status() { return _crc1; }
+  unsigned short GetCS2Status() { return _crc2; }
+  unsigned short GetCS1Calculated() { return Read(CSOne); }
+  unsigned short GetCS2Calculated() { return Read(CSTwo); }
+  unsigned short GetUGain() { return Read(Ugain); }
+  unsigned short GetLGain() { return Read(Lgain); }
+  unsigned short GetIGain() { return Read(IgainL); }
+  unsigned short GetLPhi() { return Read(Lphi); }
+  unsigned short GetUOffset() { return Read(Uoffset); }
+  unsigned short GetIOffset() { return Read(IoffsetL); }
+  unsigned short GetPOffset() { return Read(PoffsetL); }
+  unsigned short GetQOffset() { return Read(QoffsetL); }
+
+  // Any Register, i.e. for diagnostic dumps.  Note the Energy registers (0x40 to 0x45) clear on read.
+  // System Status goes through GetSysStatus(), so a dump does not take an event from TakeStatusEvents().
+  unsigned short GetRegister(unsigned char address) { return address == SysStatus ? GetSysStatus() : Read(address); }
+
+  // Register in its Unit, per the Register Table.  i.e. eic.ReadRegister<Urms>() is Volts.
+  // The Table entry is found at compile time, so only the SPI read and one multiply remain.
+  template <uint8_t Address>
+  double ReadRegister()
+  {
+    static_assert(RegisterIndex(Address) >= 0, "Register not in ATM90E26Registers");
+    constexpr uint8_t Flags = ATM90E26Registers[RegisterIndex(Address)].Flags;
+    constexpr double Scale = ATM90E26Registers[RegisterIndex(Address)].Scale;
+    static_assert(Scale > 0, "Register has no Scale");
+
+    return RegisterSigned(Flags, Read(Address)) * Scale;
+  }
+
+  // Register Defaults, from the Calibration Profile
+  void InitEnergyIC()
+  {
+    Profile::LoadChecksums(_crc1, _crc2);
+
+    Transport::Begin(CS);
+    Configure();
+
+    Serial.println("");
+
+    // Checksums.  See Calibration Profile
+    unsigned short status = GetSysStatus();
+    if (status & 0xF000)
+    {
+      if (Profile::ChecksumError(status, _crc1, GetCS1Calculated(), _crc2, GetCS2Calculated()))
+        Configure();
+    }
+
+    Serial.println("");
+  }
+
+  // Health Check.  Three reads: status (or pass the one just read), Ugain and LastData.  Returns ATM90E26Fault bits, 0 if healthy.
+  uint8_t CheckHealth() { return CheckHealth(GetSysStatus()); }
+
+  uint8_t CheckHealth(unsigned short status)
+  {
+    uint8_t faults = 0;
+
+    if (status == 0xFFFF)
+      faults |= FAULT_StuckBus;
+    else if (status & 0xF000)
+      faults |= FAULT_Checksum;
+
+    // Locked together, so another task's transfer cannot land between them and change LastData
+    unsigned short gain;
+    unsigned short last;
+    {
+      ATM90E26_Lock<Transport> lock(CS);
+      gain = Read(Ugain);
+      last = Read(LastData);
+    }
+
+    if (gain == 0xFFFF || gain == 0x0000)
+      faults |= FAULT_StuckBus;
+    else if (gain != _ugain)
+      faults |= FAULT_Config;
+
+    if (last != gain)
+      faults |= FAULT_Echo;
+
+    return faults;
+  }
+
+  // Recover in place.  Soft reset and the Register Defaults again, with the Checksums in use.  Returns the faults remaining.
+  // The Energy registers are cleared by the soft reset.
+  uint8_t Recover()
+  {
+    Configure();
+    return CheckHealth();
+  }
+
+  // Calibration, written live.  The block is put in calibration mode, which returns all its registers to their power-on
+  // values, so every value is written again, then the checksum the ATM90E26 calculates for them is written back, so the
+  // block passes its check and metering carries on.  No soft reset, so the Energy registers are kept.
+  // Set the values first, i.e. SetUGain().
+  // Measurement Calibration (Ugain, IgainL and the Offsets).  Returns the new CS2.
+  unsigned short ApplyMeasurementCalibration()
+  {
+    Write(AdjStart, 0x5678);
+    WriteMeasurementCalibration();
+    _crc2 = Read(CSTwo);
+    Write(CSTwo, _crc2);
+    Write(AdjStart, 0x8765);
+    return _crc2;
+  }
+
+  // Metering Calibration (MMode, PL Constant, Lgain, Lphi and the Thresholds).  Returns the new CS1.
+  unsigned short ApplyMeteringCalibration()
+  {
+    Write(CalStart, 0x5678);
+    WriteMeteringCalibration();
+    _crc1 = Read(CSOne);
+    Write(CSOne, _crc1);
+    Write(CalStart, 0x8765);
+    return _crc1;
+  }
+
+  // Function Enable, written live.  Not in either checksum block, so metering carries on.  Set it first, i.e. SetFunctionEnable().
+  void ApplyFunctionEnable() { Write(FuncEn, _funcen); }
+
+  // Small-Power Mode.  Power registers read in finer units, for the Power Offset calibration.  Not for metering.
+  // Power in normal mode = Power in small-power mode x Ugain x IgainL / (100000 x 2^22)
+  void SetSmallPowerMode(bool on) { Write(SmallPMod, on ? 0xA987 : 0x0000); }
+
+private:
+  unsigned short Read(unsigned char address) { return Transport::Read(CS, address); }
+  void Write(unsigned char address, unsigned short val) { Transport::Write(CS, address, val); }
+
+  // Soft Reset, then write the Register Defaults
+  void Configure()
+  {
+    Write(SoftReset, 0x789A); // Perform soft reset
+
+    Write(FuncEn, _funcen);
+    Write(SagTh, Profile::SagThreshold);
+
+    // Set metering calibration values
+    // Write(CalStart, 0x8765);  // RUNNING Metering calibration startup command. Register 21 to 2B need to be set
+    Write(CalStart, 0x5678); // CAL Metering calibration startup command. Register 21 to 2B need to be set
+    WriteMeteringCalibration();
+    Write(CSOne, _crc1); // Write CSOne, as self calculated
+
+    // Set measurement calibration values
+    Write(AdjStart, 0x5678); // Measurement calibration startup command, registers 31-3A
+    WriteMeasurementCalibration();
+    Write(CSTwo, _crc2); // Write CSTwo, as self calculated
+
+    Write(CalStart, 0x8765); // Checks correctness of 21-2B registers and starts normal metering if ok
+    Write(AdjStart, 0x8765); // Checks correctness of 31-3A registers and starts normal measurement  if ok
+  }
+
+  // Metering calibration values, registers 21-2B.  In calibration mode.
+  void WriteMeteringCalibration()
+  {
+    Write(MMode, _mmode);
+
+    Write(PLconstH, _plconsth);
+    Write(PLconstL, _plconstl); // PLconstH takes effect once PLconstL is written
+
+    Write(Lgain, _lgain);
+    Write(Lphi, _lphi);
+    Write(PStartTh, Profile::PStartThreshold);
+    Write(PNolTh, Profile::PNoLoadThreshold);
+    Write(QStartTh, Profile::QStartThreshold);
+    Write(QNolTh, Profile::QNoLoadThreshold);
+  }
+
+  // Measurement calibration values, registers 31-3A.  In calibration mode.
+  void WriteMeasurementCalibration()
+  {
+    Write(Ugain, _ugain);
+    Write(IgainL, _igain);
+    Write(Uoffset, _uoffset);
+    Write(IoffsetL, _ioffset);
+    Write(PoffsetL, _poffset);
+    Write(QoffsetL, _qoffset);
+  }
+
+  unsigned short _funcen;
+  unsigned short _mmode;
+  unsigned short _plconsth;
+  unsigned short _plconstl;
+  unsigned short _lgain;
+  unsigned short _ugain;
+  unsigned short _igain;
+  unsigned short _lphi;
+  unsigned short _uoffset;
+  unsigned short _ioffset;
+  unsigned short _poffset;
+  unsigned short _qoffset;
+  unsigned short _crc1;
+  unsigned short _crc2;
+  double _importtotal; // Running total of Import Energy reads, kWh
+  double _exporttotal; // Running total of Export Energy reads, kWh
+  unsigned int _events; // SysStatus event bits latched by GetSysStatus()
+};
+
+#endif
@@ -0,0 +1,282 @@
+/*
+  Dave Williams, DitroniX 2019-2023 (ditronix.net)
+  GTEM-1 ATM90E26 Energy Monitoring Energy Monitor  v1.0
+  Features include ESP32 GTEM ATM90E26 16bit ADC EEPROM OPTO CT-Clamp Current Voltage Frequency Power Factor GPIO I2C OLED SMPS D1 USB
+  PCA 1.2212-105 - Test Code Firmware v1
+
+  Shared ATM90E26 driver library.  Used by both the Arduino and PlatformIO GTEM-1 test code.
+
+  This test code is OPEN SOURCE and formatted for easier viewing.  Although is is not intended for real world use, it may be freely used, or modified as needed.
+  It is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+
+  Further information, details and examples can be found on our website wiki pages ditronix.net/wiki and also github.com/DitroniX
+*/
+
+
+#ifndef GTEM_ATM90E26_REGISTERS_H
+#define GTEM_ATM90E26_REGISTERS_H
+
+// Libraries
+#include <Arduino.h>
+
+// ****************  VARIABLES / DEFINES / STATIC / STRUCTURES / CONSTANTS ****************
+
+// Registers
+#define SoftReset 0x00 // Software Reset
+#define SysStatus 0x01 // System Status
+#define FuncEn 0x02    // Function Enable
+#define SagTh 0x03     // Voltage Sag Threshold
+#define SmallPMod 0x04 // Small-Power Mode
+#define LastData 0x06  // Last Read/Write SPI/UART Value
+#define LSB 0x08       // RMS/Power 16-bit LSB
+#define CalStart 0x20  // Calibration Start Command
+#define PLconstH 0x21  // High Word of PL_Constant
+#define PLconstL 0x22  // Low Word of PL_Constant
+#define Lgain 0x23     // L Line Calibration Gain
+#define Lphi 0x24      // L Line Calibration Angle
+#define Ngain 0x25     // N Line Calibration Gain
+#define Nphi 0x26      // N Line Calibration Angle
+#define PStartTh 0x27  // Active Startup Power Threshold
+#define PNolTh 0x28    // Active No-Load Power Threshold
+#define QStartTh 0x29  // Reactive Startup Power Threshold
+#define QNolTh 0x2A    // Reactive No-Load Power Threshold
+#define MMode 0x2B     // Metering Mode Configuration
+#define CSOne 0x2C     // Checksum 1
+#define AdjStart 0x30  // Measurement Calibration Start Command
+#define Ugain 0x31     // Voltage RMS Gain
+#define IgainL 0x32    // L Line Current RMS Gain
+#define IgainN 0x33    // N Line Current RMS Gain
+#define Uoffset 0x34   // Voltage Offset
+#define IoffsetL 0x35  // L Line Current Offset
+#define IoffsetN 0x36  // N Line Current Offse
+#define PoffsetL 0x37  // L Line Active Power Offset
+#define QoffsetL 0x38  // L Line Reactive Power Offset
+#define PoffsetN 0x39  // N Line Active Power Offset
+#define QoffsetN 0x3A  // N Line Reactive Power Offset
+#define CSTwo 0x3B     // Checksum 2
+#define APenergy 0x40  // Forward Active Energy
+#define ANenergy 0x41  // Reverse Active Energy
+#define ATenergy 0x42  // Absolute Active Energy
+#define RPenergy 0x43  // Forward (Inductive) Reactive Energy
+#define Rnenerg 0x44   // Reverse (Capacitive) Reactive Energy
+#define Rtenergy 0x45  // Absolute Reactive Energy
+#define EnStatus 0x46  // Metering Status
+#define Irms 0x48      // L Line Current RMS
+#define Urms 0x49      // Line Voltage RMS
+#define Pmean 0x4A     // L Line Mean Active Power
+#define Qmean 0x4B     // L Line Mean Reactive Power
+#define Freq 0x4C      // Line Voltage Frequency
+#define PowerF 0x4D    // L Line Power Factor
+#define Pangle 0x4E    // Phase Angle between Voltage and L Line Current
+#define Smean 0x4F     // L Line Mean Apparent Power
+#define IrmsTwo 0x68   // N Line Current rms
+#define PmeanTwo 0x6A  // N Line Mean Active Power
+#define QmeanTwo 0x6B  // N Line Mean Reactive Power
+#define PowerFTwo 0x6D // N Line Power Factor
+#define PangleTwo 0x6E // Phase Angle between Voltage and N Line Current
+#define SmeanTwo 0x6F  // N Line Mean Apparent Power
+
+// Function Enable (FuncEn) bits
+#define FUNC_RevPEn 0x0004 // Active energy direction change IRQ
+#define FUNC_RevQEn 0x0008 // Reactive energy direction change IRQ
+#define FUNC_SagWo 0x0010  // Voltage sag reported on the WarnOut pin
+#define FUNC_SagEn 0x0020  // Voltage sag IRQ
+
+// System Status (SysStatus) event bits.  Any of them asserts the IRQ pin, until SysStatus is read.
+#define STATUS_SagWarn 0x0002  // Voltage sag
+#define STATUS_RevPchg 0x0020  // Active energy direction changed
+#define STATUS_RevQchg 0x0040  // Reactive energy direction changed
+#define STATUS_LNchange 0x0080 // Metering line changed (Anti-tamper)
+#define STATUS_Events 0x00E2
+
+// Register Table.  One entry per register, giving how it is read, scaled and shown.  The driver getters, the console
+// 'regs' and binary dump, and the Diagnostic Report all work from this table, so a new register needs one entry only.
+// Lookups by address are resolved at compile time (RegisterIndex), so a getter costs no more than a hand written one.
+
+// Register Flags
+#define REG_SIGNED 0x01        // Two's complement
+#define REG_SIGNMAGNITUDE 0x02 // MSB is the sign, the rest the magnitude
+#define REG_READCLEAR 0x04     // Cleared by a read (Energy).  Left out of dumps.
+#define REG_WRITEONLY 0x08     // Reads nothing useful.  Left out of dumps.
+#define REG_REPORT 0x10        // Shown in the Diagnostic Report register block
+
+// Bitfield.  Values holds a name for each of the (1 << Width) values.  NULL names are not shown.
+struct RegisterField
+{
+  const char *Name; // Shown before the value name, i.e. "LNMode.FixedL"
+  uint8_t Shift;
+  uint8_t Width;
+  const char *const *Values;
+};
+
+// Known whole register value
+struct RegisterNote
+{
+  uint16_t Value;
+  const char *Text;
+};
+
+struct RegisterInfo
+{
+  uint8_t Address;
+  const char *Name; // Datasheet name
+  const char *Description;
+  uint8_t Flags;
+  double Scale;     // Value = Raw * Scale.  0 if not a measurement.
+  const char *Unit;
+  const RegisterField *Fields;
+  uint8_t FieldCount;
+  const RegisterNote *Notes;
+  uint8_t NoteCount;
+};
+
+#define REG_LIST(List) List, sizeof(List) / sizeof(List[0])
+#define REG_NONE NULL, 0
+
+// SysStatus
+constexpr const char *SagWarnNames[] = {NULL, "Enabled"};
+constexpr const char *RevPchgNames[] = {NULL, "ActiveDirectionChanged"};
+constexpr const char *RevQchgNames[] = {NULL, "ReactiveDirectionChanged"};
+constexpr const char *LNchangeNames[] = {NULL, "MeteringLineChanged"};
+constexpr const char *AdjErrNames[] = {NULL, NULL, NULL, "CS2"};
+constexpr const char *CalErrNames[] = {NULL, NULL, NULL, "CS1"};
+constexpr RegisterField SysStatusFields[] = {{"SagWarn", 1, 1, SagWarnNames}, {"RevPchg", 5, 1, RevPchgNames}, {"RevQchg", 6, 1, RevQchgNames},
+                                             {"LNchange", 7, 1, LNchangeNames}, {"CheckSumError", 12, 2, AdjErrNames}, {"CheckSumError", 14, 2, CalErrNames}};
+constexpr RegisterNote SysStatusNotes[] = {{0x0000, "#0000 System Status Default Value"}, {0xFFFF, "#FFFF Failed | Fault on ATM | Reinitialise Needed"}};
+
+// CalStart and AdjStart
+constexpr RegisterNote StartNotes[] = {
+    {0x6886, "Power-On Value. Metering Function is Disabled"},
+    {0x5678, "CALIBRATION | Meter Calibration Startup Command"},
+    {0x8765, "RUNNING | Normal Metering Mode"}};
+
+// Ugain
+constexpr const char *UgainErrorNames[] = {NULL, "PossibleValueError"};
+constexpr RegisterField UgainFields[] = {{"UGain", 15, 1, UgainErrorNames}};
+
+// MMode
+constexpr const char *ZXConNames[] = {"PositiveZeroCrossing", "NegativeZeroCrossing", "AllZeroCrossing", "NoZeroCrossing"};
+constexpr const char *LNSelNames[] = {"NLine", "LLine(Default)"};
+constexpr const char *NGainNames[] = {"CurrentGain2", "CurrentGain4", "CurrentGain1", "CurrentGain1"};
+constexpr const char *LGainNames[] = {"CurrentChannelGain4", "CurrentChannelGain8", "CurrentChannelGain16", "CurrentChannelGain24",
+                                      "CurrentChannelGain1", "CurrentChannelGain1", "CurrentChannelGain1", "CurrentChannelGain1"};
+constexpr RegisterField MModeFields[] = {{"MMode", 4, 2, ZXConNames}, {"MMode.LNSel", 10, 1, LNSelNames}, {"MMode.NLine", 11, 2, NGainNames}, {"MMode.LGain", 13, 3, LGainNames}};
+constexpr RegisterNote MModeNotes[] = {{0x9422, "#9422 MMode Default Value"}};
+
+// EnStatus
+constexpr const char *LNModeNames[] = {"AntiTamper", "FixedL", "LN", "Flexible"};
+constexpr const char *LlineNames[] = {"AntiTamperN", "AntiTamperL"};
+constexpr const char *RevPNames[] = {"CF1ActiveForward", "CF1ActiveReverse"};
+constexpr const char *RevQNames[] = {"CF2ReActiveForward", "CF2ReActiveReverse"};
+constexpr const char *PnoloadNames[] = {"NoLoadNotActive", "NoLoadActive"};
+constexpr const char *QnoloadNames[] = {"NotReactiveNoLoad", "ReactiveNoLoad"};
+constexpr RegisterField EnStatusFields[] = {{"LNMode", 0, 2, LNModeNames}, {"Lline", 11, 1, LlineNames}, {"RevP", 12, 1, RevPNames},
+                                            {"RevQ", 13, 1, RevQNames}, {"Pnoload", 14, 1, PnoloadNames}, {"Qnoload", 15, 1, QnoloadNames}};
+constexpr RegisterNote EnStatusNotes[] = {
+    {0x2801, "#2801 Accumulator Populated"},
+    {0xC801, "#C801 Accumulator Not Running"},
+    {0xC800, "#C800 Meter Status Default Value"},
+    {0xFFFF, "#FFFF Failed | Fault on ATM | Reinitialise Needed"},
+    {0x0000, "#0000 ERROR!: Possible ATM Hardware Issue"}};
+
+constexpr RegisterInfo ATM90E26Registers[] = {
+    {SoftReset, "SoftReset", "Software Reset", REG_WRITEONLY, 0, "", REG_NONE, REG_NONE},
+    {SysStatus, "SysStatus", "System Status", REG_REPORT, 0, "", REG_LIST(SysStatusFields), REG_LIST(SysStatusNotes)},
+    {FuncEn, "FuncEn", "Function Enable", 0, 0, "", REG_NONE, REG_NONE},
+    {SagTh, "SagTh", "Voltage Sag Threshold", 0, 0, "", REG_NONE, REG_NONE},
+    {SmallPMod, "SmallPMod", "Small-Power Mode", 0, 0, "", REG_NONE, REG_NONE},
+    {LastData, "LastData", "Last Read/Write SPI Value", 0, 0, "", REG_NONE, REG_NONE},
+    {LSB, "LSB", "RMS/Power 16-bit LSB", 0, 0, "", REG_NONE, REG_NONE},
+    {CalStart, "CalStart", "Calibration Start Command", REG_REPORT, 0, "", REG_NONE, REG_LIST(StartNotes)},
+    {PLconstH, "PLconstH", "High Word of PL_Constant", 0, 0, "", REG_NONE, REG_NONE},
+    {PLconstL, "PLconstL", "Low Word of PL_Constant", 0, 0, "", REG_NONE, REG_NONE},
+    {Lgain, "Lgain", "L Line Calibration Gain", REG_REPORT, 0, "", REG_NONE, REG_NONE},
+    {Lphi, "Lphi", "L Line Calibration Angle", 0, 0, "", REG_NONE, REG_NONE},
+    {Ngain, "Ngain", "N Line Calibration Gain", 0, 0, "", REG_NONE, REG_NONE},
+    {Nphi, "Nphi", "N Line Calibration Angle", 0, 0, "", REG_NONE, REG_NONE},
+    {PStartTh, "PStartTh", "Active Startup Power Threshold", 0, 0, "", REG_NONE, REG_NONE},
+    {PNolTh, "PNolTh", "Active No-Load Power Threshold", 0, 0, "", REG_NONE, REG_NONE},
+    {QStartTh, "QStartTh", "Reactive Startup Power Threshold", 0, 0, "", REG_NONE, REG_NONE},
+    {QNolTh, "QNolTh", "Reactive No-Load Power Threshold", 0, 0, "", REG_NONE, REG_NONE},
+    {MMode, "MMode", "Metering Mode Configuration", REG_REPORT, 0, "", REG_LIST(MModeFields), REG_LIST(MModeNotes)},
+    {CSOne, "CSOne", "Checksum 1", 0, 0, "", REG_NONE, REG_NONE},
+    {AdjStart, "AdjStart", "Measurement Calibration Start Command", 0, 0, "", REG_NONE, REG_LIST(StartNotes)},
+    {Ugain, "Ugain", "Voltage RMS Gain", REG_REPORT, 0, "", REG_LIST(UgainFields), REG_NONE},
+    {IgainL, "IgainL", "L Line Current RMS Gain", REG_REPORT, 0, "", REG_NONE, REG_NONE},
+    {IgainN, "IgainN", "N Line Current RMS Gain", 0, 0, "", REG_NONE, REG_NONE},
+    {Uoffset, "Uoffset", "Voltage Offset", 0, 0, "", REG_NONE, REG_NONE},
+    {IoffsetL, "IoffsetL", "L Line Current Offset", 0, 0, "", REG_NONE, REG_NONE},
+    {IoffsetN, "IoffsetN", "N Line Current Offset", 0, 0, "", REG_NONE, REG_NONE},
+    {PoffsetL, "PoffsetL", "L Line Active Power Offset", 0, 0, "", REG_NONE, REG_NONE},
+    {QoffsetL, "QoffsetL", "L Line Reactive Power Offset", 0, 0, "", REG_NONE, REG_NONE},
+    {PoffsetN, "PoffsetN", "N Line Active Power Offset", 0, 0, "", REG_NONE, REG_NONE},
+    {QoffsetN, "QoffsetN", "N Line Reactive Power Offset", 0, 0, "", REG_NONE, REG_NONE},
+    {CSTwo, "CSTwo", "Checksum 2", 0, 0, "", REG_NONE, REG_NONE},
+    {APenergy, "APenergy", "Forward Active Energy", REG_READCLEAR, 0.0001, "kWh", REG_NONE, REG_NONE},
+    {ANenergy, "ANenergy", "Reverse Active Energy", REG_READCLEAR, 0.0001, "kWh", REG_NONE, REG_NONE},
+    {ATenergy, "ATenergy", "Absolute Active Energy", REG_READCLEAR, 0.0001, "kWh", REG_NONE, REG_NONE},
+    {RPenergy, "RPenergy", "Forward (Inductive) Reactive Energy", REG_READCLEAR, 0.0001, "kvarh", REG_NONE, REG_NONE},
+    {Rnenerg, "RNenergy", "Reverse (Capacitive) Reactive Energy", REG_READCLEAR, 0.0001, "kvarh", REG_NONE, REG_NONE},
+    {Rtenergy, "RTenergy", "Absolute Reactive Energy", REG_READCLEAR, 0.0001, "kvarh", REG_NONE, REG_NONE},
+    {EnStatus, "EnStatus", "Metering Status", REG_REPORT, 0, "", REG_LIST(EnStatusFields), REG_LIST(EnStatusNotes)},
+    {Irms, "Irms", "L Line Current RMS", 0, 0.001, "A", REG_NONE, REG_NONE},
+    {Urms, "Urms", "Line Voltage RMS", 0, 0.01, "V", REG_NONE, REG_NONE},
+    {Pmean, "Pmean", "L Line Mean Active Power", REG_SIGNED, 1, "W", REG_NONE, REG_NONE},
+    {Qmean, "Qmean", "L Line Mean Reactive Power", REG_SIGNED, 1, "var", REG_NONE, REG_NONE},
+    {Freq, "Freq", "Line Voltage Frequency", 0, 0.01, "Hz", REG_NONE, REG_NONE},
+    {PowerF, "PowerF", "L Line Power Factor", REG_SIGNMAGNITUDE, 0.001, "", REG_NONE, REG_NONE},
+    {Pangle, "Pangle", "Phase Angle, Voltage to L Line Current", REG_SIGNMAGNITUDE, 0.1, "deg", REG_NONE, REG_NONE},
+    {Smean, "Smean", "L Line Mean Apparent Power", REG_SIGNED, 1, "VA", REG_NONE, REG_NONE},
+    {IrmsTwo, "IrmsTwo", "N Line Current RMS", 0, 0.001, "A", REG_NONE, REG_NONE},
+    {PmeanTwo, "PmeanTwo", "N Line Mean Active Power", REG_SIGNED, 1, "W", REG_NONE, REG_NONE},
+    {QmeanTwo, "QmeanTwo", "N Line Mean Reactive Power", REG_SIGNED, 1, "var", REG_NONE, REG_NONE},
+    {PowerFTwo, "PowerFTwo", "N Line Power Factor", REG_SIGNMAGNITUDE, 0.001, "", REG_NONE, REG_NONE},
+    {PangleTwo, "PangleTwo", "Phase Angle, Voltage to N Line Current", REG_SIGNMAGNITUDE, 0.1, "deg", REG_NONE, REG_NONE},
+    {SmeanTwo, "SmeanTwo", "N Line Mean Apparent Power", REG_SIGNED, 1, "VA", REG_NONE, REG_NONE}};
+
+constexpr int ATM90E26RegisterCount = sizeof(ATM90E26Registers) / sizeof(RegisterInfo);
+
+// **************** FUNCTIONS AND ROUTINES ****************
+
+// Table index of a register, or -1.  Compile time when Address is a constant.
+constexpr int RegisterIndex(uint8_t Address, int Index = 0)
+{
+  return Index >= ATM90E26RegisterCount ? -1 : ATM90E26Registers[Index].Address == Address ? Index : RegisterIndex(Address, Index + 1);
+}
+
+// Raw register value as a signed number, per the Flags
+constexpr double RegisterSigned(uint8_t Flags, uint16_t Raw)
+{
+  return Flags & REG_SIGNED ? (double)(int16_t)Raw : Flags & REG_SIGNMAGNITUDE && Raw & 0x8000 ? -(double)(Raw & 0x7FFF) : (double)Raw;
+}
+
+// Raw register value in its Unit
+constexpr double RegisterDecode(const RegisterInfo &Info, uint16_t Raw)
+{
+  return RegisterSigned(Info.Flags, Raw) * Info.Scale;
+}
+
+// Decimal places the Scale gives
+constexpr int RegisterDecimals(double Scale)
+{
+  return Scale >= 1 || Scale <= 0 ? 0 : 1 + RegisterDecimals(Scale * 10);
+}
+
+// Value of a Bitfield
+constexpr uint16_t RegisterFieldValue(const RegisterField &Field, uint16_t Raw)
+{
+  return (Raw >> Field.Shift) & ((1 << Field.Width) - 1);
+}
+
+// Text of a known whole value, or NULL
+inline const char *RegisterNoteText(const RegisterInfo &Info, uint16_t Raw)
+{
+  for (int i = 0; i < Info.NoteCount; i++)
+  {
+    if (Info.Notes[i].Value == Raw)
+      return Info.Notes[i].Text;
+  }
+  return NULL;
+}
+
+#endif